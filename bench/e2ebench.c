@@ -0,0 +1,739 @@
+#include "wm.h"
+#include "swizzle.h"
+#include "raymath.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_WINDOWS 256
+#define MAX_VARIANTS 16
+// Draw times kept per window, by frame counter
+#define STAMP_RING 256
+// Each window paints its frame counter into a solid block this big in its
+// top-left corner, so it survives being captured at the smallest level
+#define COUNTER_BLOCK (1 << SWIZZLE_MAX_LOD)
+
+// Scripted camera: once around the windows every ORBIT_FRAMES, selecting the
+// next window every SELECT_FRAMES
+#define ORBIT_FRAMES 600
+#define ORBIT_RADIUS 8.0f
+#define SELECT_FRAMES 60
+
+// Idle phase: every window stops drawing and the loop only draws on demand,
+// then the first window draws POKE_HZ times a second to time how long the
+// sleeping loop takes to show it
+#define SETTLE_SECONDS 0.5
+#define POKE_HZ 4.0f
+#define MAX_WAKES 1024
+
+// Restart phase: 3dwm is shut down and started again over the same windows,
+// once from nothing and once from the session the shutdown saved, giving up
+// on a start after RESTART_TIMEOUT seconds
+#define RESTART_TIMEOUT 10.0
+
+typedef enum {
+    SPAWNER_RUN,   // every window at its rate
+    SPAWNER_PAUSE, // nothing draws
+    SPAWNER_POKE,  // only the first window, at POKE_HZ
+} SpawnerMode;
+
+typedef struct {
+    int window_count;
+    int sizes[MAX_VARIANTS][2];
+    int size_count;
+    float rates[MAX_VARIANTS];
+    int rate_count;
+    int frames;
+    int warmup;
+    double idle_seconds; // of each idle measurement, 0 to skip them
+    bool restart;        // measure restarts
+    const char *display; // NULL to start an Xvfb
+    const char *output;  // NULL for stdout
+    WMOptions wm;
+} BenchOptions;
+
+// Synthetic clients on their own connection and thread
+typedef struct {
+    Display *display;
+    GC gc;
+    int count;
+    Window windows[MAX_WINDOWS];
+    int sizes[MAX_WINDOWS][2];
+    float hz[MAX_WINDOWS];
+    double next_draw[MAX_WINDOWS];
+    uint32_t counter[MAX_WINDOWS];
+    pthread_t thread;
+    atomic_bool stop;
+    atomic_int mode;
+
+    atomic_uint_least32_t latest[MAX_WINDOWS];
+    atomic_uint_least64_t drawn_ns[MAX_WINDOWS][STAMP_RING];
+} Spawner;
+
+typedef struct {
+    WMState *wm;
+    Spawner *spawner;
+    bool measuring;
+    uint32_t seen[MAX_WINDOWS];
+
+    // Uploads this frame, waiting for it to be presented
+    uint64_t pending[MAX_WINDOWS];
+    int pending_count;
+
+    double *frame_ms;
+    int frame_count;
+    double *latency_ms;
+    int latency_count;
+    int latency_capacity;
+    long updates;
+
+    bool waking; // idle phase: uploads go to wake_ms instead
+    double wake_ms[MAX_WAKES];
+    int wake_count;
+    int idle_frames;
+    int idle_wakeups;
+
+    bool live[MAX_WINDOWS]; // a frame was uploaded since the last start
+} Bench;
+
+// How long a start took until
+typedef struct {
+    double shown_ms; // a frame was drawn with every window in it, showing something
+    double live_ms;  // every window showed a frame captured since the start
+} RestartTimes;
+
+static uint64_t NowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double Now(void) {
+    return NowNs() / 1e9;
+}
+
+// A solid background that changes every frame, so the whole window is
+// damaged like a video would be, and the counter on top
+static void DrawSynthetic(Spawner *sp, int w) {
+    int width = sp->sizes[w][0];
+    int height = sp->sizes[w][1];
+    uint32_t counter = ++sp->counter[w];
+    unsigned long shade = (counter * 8) & 0xff;
+    XSetForeground(sp->display, sp->gc, shade * 0x010101);
+    XFillRectangle(sp->display, sp->windows[w], sp->gc, 0, 0, width, height);
+    XSetForeground(sp->display, sp->gc, counter & 0xffffff);
+    XFillRectangle(sp->display, sp->windows[w], sp->gc, 0, 0, COUNTER_BLOCK, COUNTER_BLOCK);
+
+    atomic_store(&sp->drawn_ns[w][counter % STAMP_RING], NowNs());
+    atomic_store(&sp->latest[w], counter);
+}
+
+static float SpawnerRate(const Spawner *sp, int w, SpawnerMode mode) {
+    switch (mode) {
+        case SPAWNER_RUN: return sp->hz[w];
+        case SPAWNER_POKE: return w == 0 ? POKE_HZ : 0.0f;
+        default: return 0.0f;
+    }
+}
+
+static void *SpawnerMain(void *arg) {
+    Spawner *sp = arg;
+    while (!atomic_load(&sp->stop)) {
+        SpawnerMode mode = atomic_load(&sp->mode);
+        double now = Now();
+        double wake = now + 0.1;
+        for (int w = 0; w < sp->count; w++) {
+            float hz = SpawnerRate(sp, w, mode);
+            if (hz <= 0.0f) continue;
+            if (now >= sp->next_draw[w]) {
+                DrawSynthetic(sp, w);
+                // Don't try to catch up after a stall
+                sp->next_draw[w] += 1.0 / hz;
+                if (sp->next_draw[w] < now) sp->next_draw[w] = now + 1.0 / hz;
+            }
+            if (sp->next_draw[w] < wake) wake = sp->next_draw[w];
+        }
+        XFlush(sp->display);
+
+        double wait = wake - Now();
+        if (wait > 0) {
+            struct timespec ts = {(time_t)wait, (long)((wait - (time_t)wait) * 1e9)};
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+static Spawner *SpawnerStart(const BenchOptions *options) {
+    Spawner *sp = calloc(1, sizeof(Spawner));
+    if (sp == NULL) {
+        fprintf(stderr, "Failed to allocate memory for synthetic windows\n");
+        return NULL;
+    }
+    sp->display = XOpenDisplay(NULL);
+    if (sp->display == NULL) {
+        fprintf(stderr, "Unable to open X display for synthetic windows\n");
+        free(sp);
+        return NULL;
+    }
+
+    // Tiled across the screen, overlapping once it's full
+    int screen = DefaultScreen(sp->display);
+    Window root = RootWindow(sp->display, screen);
+    int screen_width = DisplayWidth(sp->display, screen);
+    int screen_height = DisplayHeight(sp->display, screen);
+    int x = 0, y = 0, row_height = 0;
+    sp->count = options->window_count;
+    for (int w = 0; w < sp->count; w++) {
+        int width = options->sizes[w % options->size_count][0];
+        int height = options->sizes[w % options->size_count][1];
+        if (x + width > screen_width) {
+            x = 0;
+            y += row_height;
+            row_height = 0;
+        }
+        if (y + height > screen_height) y = 0;
+
+        sp->windows[w] = XCreateSimpleWindow(sp->display, root, x, y, width, height, 0, 0, 0);
+        XStoreName(sp->display, sp->windows[w], "e2ebench");
+        XMapWindow(sp->display, sp->windows[w]);
+        sp->sizes[w][0] = width;
+        sp->sizes[w][1] = height;
+        sp->hz[w] = options->rates[w % options->rate_count];
+        x += width;
+        if (height > row_height) row_height = height;
+    }
+    sp->gc = XCreateGC(sp->display, root, 0, NULL);
+    XSync(sp->display, False);
+
+    atomic_init(&sp->stop, false);
+    atomic_init(&sp->mode, SPAWNER_RUN);
+    if (pthread_create(&sp->thread, NULL, SpawnerMain, sp) != 0) {
+        fprintf(stderr, "Unable to start synthetic window thread\n");
+        XCloseDisplay(sp->display);
+        free(sp);
+        return NULL;
+    }
+    return sp;
+}
+
+static void SpawnerStop(Spawner *sp) {
+    atomic_store(&sp->stop, true);
+    pthread_join(sp->thread, NULL);
+    for (int w = 0; w < sp->count; w++) {
+        XDestroyWindow(sp->display, sp->windows[w]);
+    }
+    XFreeGC(sp->display, sp->gc);
+    XCloseDisplay(sp->display);
+    free(sp);
+}
+
+// Start an Xvfb on a free display and point DISPLAY at it
+static pid_t StartXvfb(char *display, size_t size) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        char fd[16];
+        snprintf(fd, sizeof(fd), "%d", fds[1]);
+        execlp("Xvfb", "Xvfb", "-displayfd", fd, "-screen", "0", "1920x1080x24", "-nolisten", "tcp", (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return -1;
+    }
+
+    // Xvfb writes the display number once it's ready for clients
+    char number[16] = {0};
+    size_t length = 0;
+    while (length < sizeof(number) - 1) {
+        ssize_t n = read(fds[0], number + length, 1);
+        if (n <= 0 || number[length] == '\n') break;
+        length++;
+    }
+    close(fds[0]);
+    number[length] = '\0';
+    if (length == 0 || !isdigit((unsigned char)number[0])) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+
+    snprintf(display, size, ":%s", number);
+    setenv("DISPLAY", display, 1);
+    return pid;
+}
+
+static int FindSynthetic(const Spawner *sp, Window window) {
+    for (int w = 0; w < sp->count; w++) {
+        if (sp->windows[w] == window) return w;
+    }
+    return -1;
+}
+
+// The pixel at the window's top-left corner, if the frame has it
+static const unsigned char *CounterPixel(const CaptureFrame *frame) {
+    if (frame->pixels == NULL) return NULL;
+    if (frame->rect_count == CAPTURE_FULL) return frame->pixels;
+
+    const unsigned char *found = NULL;
+    size_t offset = 0;
+    for (int r = 0; r < frame->rect_count; r++) {
+        XRectangle rect = frame->rects[r];
+        if (rect.x == 0 && rect.y == 0) found = frame->pixels + offset;
+        offset += (size_t)(rect.width >> frame->lod) * (rect.height >> frame->lod) * 4;
+    }
+    return found;
+}
+
+static void OnUpload(void *data, int index, const CaptureFrame *frame) {
+    Bench *bench = data;
+    if (bench->measuring) bench->updates++;
+
+    int w = FindSynthetic(bench->spawner, GetWindowResources(bench->wm, index)->window);
+    if (w < 0) return;
+    bench->live[w] = true;
+
+    const unsigned char *pixel = CounterPixel(frame);
+    if (pixel == NULL) return;
+
+    uint32_t counter = (uint32_t)pixel[0] << 16 | (uint32_t)pixel[1] << 8 | pixel[2];
+    if (counter <= bench->seen[w]) return;
+    bench->seen[w] = counter;
+
+    // Too old, its stamp was already reused
+    uint32_t latest = atomic_load(&bench->spawner->latest[w]);
+    if (latest - counter >= STAMP_RING) return;
+
+    uint64_t drawn = atomic_load(&bench->spawner->drawn_ns[w][counter % STAMP_RING]);
+    if (drawn != 0 && (bench->measuring || bench->waking) && bench->pending_count < MAX_WINDOWS) {
+        bench->pending[bench->pending_count++] = drawn;
+    }
+}
+
+static void AddLatency(Bench *bench, double ms) {
+    if (bench->latency_count == bench->latency_capacity) {
+        int capacity = bench->latency_capacity == 0 ? 4096 : bench->latency_capacity * 2;
+        double *grown = realloc(bench->latency_ms, capacity * sizeof(double));
+        if (grown == NULL) return;
+        bench->latency_ms = grown;
+        bench->latency_capacity = capacity;
+    }
+    bench->latency_ms[bench->latency_count++] = ms;
+}
+
+// Stand in for MyUpdateCamera and the cursor: orbit the windows, select them
+// in turn and pick through the middle of the screen
+static void ScriptFrame(WMState *wm, int frame) {
+    float angle = 2.0f * PI * frame / ORBIT_FRAMES;
+    Vector3 center = {0.0f, 2.0f, -2.0f};
+    wm->camera.target = center;
+    wm->camera.position = (Vector3){
+        center.x + sinf(angle) * ORBIT_RADIUS,
+        center.y + 1.0f + sinf(2.0f * angle),
+        center.z + cosf(angle) * ORBIT_RADIUS,
+    };
+
+    WindowRegistry *reg = &wm->windows;
+    if (reg->count > 0) {
+        wm->selected = WindowRegistryHandle(reg, (frame / SELECT_FRAMES) % reg->count);
+    }
+
+    Vector2 middle = {GetScreenWidth() / 2.0f, GetScreenHeight() / 2.0f};
+    wm->ray = GetScreenToWorldRay(middle, wm->camera);
+    PickIndexCast(&wm->pick, wm->ray, &wm->collision);
+}
+
+static double CpuSeconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// One pass of the on-demand loop in main, without the input
+static void IdleFrame(Bench *bench) {
+    WMState *wm = bench->wm;
+    if (wm->idle != NULL) IdleRearm(wm->idle);
+    WMSyncWindows(wm);
+    WMBillboardWindows(wm);
+    WMScheduleUpdates(wm);
+
+    if (!WMNeedsDraw(wm)) {
+        WMWait(wm);
+        bench->idle_wakeups++;
+        return;
+    }
+    BeginDrawing();
+    WMDraw(wm);
+    EndDrawing();
+    bench->idle_frames++;
+
+    // As in the measured frames, what was uploaded is on screen now
+    uint64_t now = NowNs();
+    for (int p = 0; p < bench->pending_count && bench->waking; p++) {
+        if (bench->wake_count < MAX_WAKES) {
+            bench->wake_ms[bench->wake_count++] = (now - bench->pending[p]) / 1e6;
+        }
+    }
+    bench->pending_count = 0;
+}
+
+static void RunIdle(Bench *bench, double seconds) {
+    double end = Now() + seconds;
+    while (Now() < end && !WindowShouldClose()) {
+        IdleFrame(bench);
+    }
+}
+
+// Synthetic windows that are in the scene with a texture, and that have had
+// a frame uploaded since the start
+static void CountShown(const Bench *bench, int *shown, int *live) {
+    const WindowRegistry *reg = &bench->wm->windows;
+    *shown = *live = 0;
+    for (int i = 0; i < reg->count; i++) {
+        int w = FindSynthetic(bench->spawner, GetWindowResources(bench->wm, i)->window);
+        if (w < 0 || reg->texture[i].id == 0) continue;
+        (*shown)++;
+        *live += bench->live[w];
+    }
+}
+
+// Start 3dwm over the running windows and time it until they're all shown
+// and all live. Times are -1 for whatever didn't happen in time.
+static WMState *Restart(Bench *bench, const BenchOptions *options, const char *session, RestartTimes *times) {
+    WMOptions wm_options = options->wm;
+    wm_options.session_path = session;
+    memset(bench->live, 0, sizeof(bench->live));
+    *times = (RestartTimes){-1.0, -1.0};
+
+    double start = Now();
+    WMState *wm = WMInit(&wm_options);
+    if (wm == NULL) return NULL;
+    wm->show_controls = false;
+    wm->on_upload = OnUpload;
+    wm->on_upload_data = bench;
+    bench->wm = wm;
+
+    int count = bench->spawner->count;
+    while (times->live_ms < 0.0 && Now() - start < RESTART_TIMEOUT && !WindowShouldClose()) {
+        WMSyncWindows(wm);
+        WMBillboardWindows(wm);
+        WMScheduleUpdates(wm);
+        BeginDrawing();
+        WMDraw(wm);
+        EndDrawing();
+
+        double ms = (Now() - start) * 1000.0;
+        int shown, live;
+        CountShown(bench, &shown, &live);
+        if (times->shown_ms < 0.0 && shown >= count) times->shown_ms = ms;
+        if (live >= count) times->live_ms = ms;
+    }
+    bench->pending_count = 0;
+    return wm;
+}
+
+static int CompareDouble(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static void PrintPercentiles(FILE *out, const char *name, double *values, int count) {
+    if (count == 0) {
+        fprintf(out, "  \"%s\": {\"samples\": 0},\n", name);
+        return;
+    }
+    qsort(values, count, sizeof(double), CompareDouble);
+    fprintf(out, "  \"%s\": {\"samples\": %d, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n", name,
+            count, values[count / 2], values[(count * 9) / 10], values[(count * 99) / 100], values[count - 1]);
+}
+
+static const char *CompositeName(CompositeMode mode) {
+    switch (mode) {
+        case COMPOSITE_PIXMAP: return "pixmap";
+        case COMPOSITE_COPY: return "copy";
+        default: return "off";
+    }
+}
+
+static bool ParseList(const char *text, bool sizes, BenchOptions *options) {
+    int count = 0;
+    while (*text != '\0' && count < MAX_VARIANTS) {
+        char *end;
+        if (sizes) {
+            int width = (int)strtol(text, &end, 10);
+            if (*end != 'x') return false;
+            int height = (int)strtol(end + 1, &end, 10);
+            if (width < COUNTER_BLOCK || height < COUNTER_BLOCK) return false;
+            options->sizes[count][0] = width;
+            options->sizes[count][1] = height;
+        }
+        else {
+            options->rates[count] = strtof(text, &end);
+            if (end == text || options->rates[count] < 0.0f) return false;
+        }
+        count++;
+        if (*end == ',') end++;
+        else if (*end != '\0') return false;
+        text = end;
+    }
+    if (count == 0) return false;
+    if (sizes) options->size_count = count;
+    else options->rate_count = count;
+    return true;
+}
+
+static void PrintUsage(const char *program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --windows=N             synthetic windows (default 8, at most %d)\n", MAX_WINDOWS);
+    printf("  --size=WxH[,WxH...]     their sizes, round robin (default 640x480)\n");
+    printf("  --hz=F[,F...]           how often they redraw, round robin (default 30)\n");
+    printf("  --frames=N              frames measured (default 600)\n");
+    printf("  --warmup=N              frames run first and not measured (default 120)\n");
+    printf("  --idle-seconds=F        length of the idle and wake up measurements (default 2, 0 skips)\n");
+    printf("  --restart=on|off        time restarts with and without a session (default on)\n");
+    printf("  --display=NAME          use a running X server instead of starting Xvfb\n");
+    printf("  --output=PATH           write the results there instead of stdout\n");
+    printf("  --composite=copy|pixmap|off, --capture=xlib|xcb, --upload=pbo|sync\n");
+    printf("                          as for 3dwm; latency needs pixels, so copy is the default\n");
+}
+
+static bool ParseOptions(int argc, char **argv, BenchOptions *options) {
+    memset(options, 0, sizeof(BenchOptions));
+    options->window_count = 8;
+    options->sizes[0][0] = 640;
+    options->sizes[0][1] = 480;
+    options->size_count = 1;
+    options->rates[0] = 30.0f;
+    options->rate_count = 1;
+    options->frames = 600;
+    options->warmup = 120;
+    options->idle_seconds = 2.0;
+    options->restart = true;
+    options->wm.composite = COMPOSITE_COPY;
+    options->wm.uncapped = true;
+    options->wm.schedule.focused_hz = 60.0f;
+    options->wm.schedule.background_hz = 10.0f;
+    options->wm.schedule.budget_ms = 4.0f;
+    options->wm.schedule.max_lod = SWIZZLE_MAX_LOD;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool ok = true;
+        if (strncmp(arg, "--windows=", 10) == 0) {
+            options->window_count = atoi(arg + 10);
+            ok = options->window_count > 0 && options->window_count <= MAX_WINDOWS;
+        }
+        else if (strncmp(arg, "--size=", 7) == 0) ok = ParseList(arg + 7, true, options);
+        else if (strncmp(arg, "--hz=", 5) == 0) ok = ParseList(arg + 5, false, options);
+        else if (strncmp(arg, "--frames=", 9) == 0) ok = (options->frames = atoi(arg + 9)) > 0;
+        else if (strncmp(arg, "--warmup=", 9) == 0) options->warmup = atoi(arg + 9);
+        else if (strncmp(arg, "--idle-seconds=", 15) == 0) ok = (options->idle_seconds = atof(arg + 15)) >= 0.0;
+        else if (strcmp(arg, "--restart=on") == 0) options->restart = true;
+        else if (strcmp(arg, "--restart=off") == 0) options->restart = false;
+        else if (strncmp(arg, "--display=", 10) == 0) options->display = arg + 10;
+        else if (strncmp(arg, "--output=", 9) == 0) options->output = arg + 9;
+        else if (strcmp(arg, "--composite=copy") == 0) options->wm.composite = COMPOSITE_COPY;
+        else if (strcmp(arg, "--composite=pixmap") == 0) options->wm.composite = COMPOSITE_PIXMAP;
+        else if (strcmp(arg, "--composite=off") == 0) options->wm.composite = COMPOSITE_OFF;
+        else if (strcmp(arg, "--capture=xlib") == 0) options->wm.capture = CAPTURE_BACKEND_XLIB;
+        else if (strcmp(arg, "--capture=xcb") == 0) options->wm.capture = CAPTURE_BACKEND_XCB;
+        else if (strcmp(arg, "--upload=pbo") == 0) options->wm.sync_upload = false;
+        else if (strcmp(arg, "--upload=sync") == 0) options->wm.sync_upload = true;
+        else ok = false;
+
+        if (!ok) {
+            if (strcmp(arg, "--help") != 0) {
+                fprintf(stderr, "Bad option: %s\n", arg);
+            }
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, &options)) {
+        return 1;
+    }
+
+    char display[32];
+    pid_t xvfb = -1;
+    if (options.display != NULL) {
+        snprintf(display, sizeof(display), "%s", options.display);
+        setenv("DISPLAY", display, 1);
+    }
+    else {
+        xvfb = StartXvfb(display, sizeof(display));
+        if (xvfb < 0) {
+            fprintf(stderr, "Unable to start Xvfb\n");
+            return 1;
+        }
+    }
+    // No GPU needed: let Mesa render on the CPU unless told otherwise
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+
+    SetTraceLogLevel(LOG_WARNING);
+    WMState *wm = WMInit(&options.wm);
+    if (wm == NULL) {
+        fprintf(stderr, "Failed to initialize window manager\n");
+        if (xvfb > 0) kill(xvfb, SIGTERM);
+        return 1;
+    }
+    wm->show_controls = false;
+
+    Bench bench = {.wm = wm};
+    bench.frame_ms = malloc(options.frames * sizeof(double));
+    bench.spawner = SpawnerStart(&options);
+    if (bench.frame_ms == NULL || bench.spawner == NULL) {
+        WMShutdown(wm);
+        if (xvfb > 0) kill(xvfb, SIGTERM);
+        return 1;
+    }
+    wm->on_upload = OnUpload;
+    wm->on_upload_data = &bench;
+
+    int total = options.warmup + options.frames;
+    uint64_t last = NowNs();
+    uint64_t start = 0;
+    for (int frame = 0; frame < total && !WindowShouldClose(); frame++) {
+        bench.measuring = frame >= options.warmup;
+        if (frame == options.warmup) start = last;
+
+        WMSyncWindows(wm);
+        ScriptFrame(wm, frame);
+        WMBillboardWindows(wm);
+        WMScheduleUpdates(wm);
+
+        BeginDrawing();
+        WMDraw(wm);
+        EndDrawing();
+
+        // Anything uploaded this frame is on screen now
+        uint64_t now = NowNs();
+        if (bench.measuring) {
+            bench.frame_ms[bench.frame_count++] = (now - last) / 1e6;
+            for (int p = 0; p < bench.pending_count; p++) {
+                AddLatency(&bench, (now - bench.pending[p]) / 1e6);
+            }
+        }
+        bench.pending_count = 0;
+        last = now;
+    }
+    double seconds = (last - start) / 1e9;
+    int shown = wm->windows.count;
+    bench.measuring = false;
+    bench.pending_count = 0;
+
+    // Nothing changes: how much does the loop still cost?
+    double idle_cpu = 0.0, idle_render_cpu = 0.0;
+    int idle_frames = 0, idle_wakeups = 0;
+    if (options.idle_seconds > 0.0) {
+        wm->options.on_demand = true;
+        atomic_store(&bench.spawner->mode, SPAWNER_PAUSE);
+        RunIdle(&bench, SETTLE_SECONDS);
+
+        bench.idle_frames = bench.idle_wakeups = 0;
+        double cpu = CpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+        double render_cpu = CpuSeconds(CLOCK_THREAD_CPUTIME_ID);
+        double idle_start = Now();
+        RunIdle(&bench, options.idle_seconds);
+        double idle_wall = Now() - idle_start;
+        idle_cpu = 100.0 * (CpuSeconds(CLOCK_PROCESS_CPUTIME_ID) - cpu) / idle_wall;
+        idle_render_cpu = 100.0 * (CpuSeconds(CLOCK_THREAD_CPUTIME_ID) - render_cpu) / idle_wall;
+        idle_frames = bench.idle_frames;
+        idle_wakeups = bench.idle_wakeups;
+
+        // And how long does it take to wake up for a window that draws?
+        bench.waking = true;
+        atomic_store(&bench.spawner->mode, SPAWNER_POKE);
+        RunIdle(&bench, options.idle_seconds);
+        bench.waking = false;
+    }
+
+    // Starting over with every window already open: from nothing, and from
+    // the session the shutdown before it saves
+    RestartTimes cold = {-1.0, -1.0}, warm = {-1.0, -1.0};
+    char session[] = "/tmp/3dwm-session-XXXXXX";
+    int session_fd = options.restart ? mkstemp(session) : -1;
+    if (session_fd >= 0) {
+        close(session_fd);
+        atomic_store(&bench.spawner->mode, SPAWNER_RUN);
+        wm->on_upload = NULL;
+        wm->options.session_path = session;
+        WMShutdown(wm);
+        wm = Restart(&bench, &options, NULL, &cold);
+        if (wm != NULL) {
+            wm->on_upload = NULL;
+            WMShutdown(wm);
+            wm = Restart(&bench, &options, session, &warm);
+        }
+    }
+
+    if (wm != NULL) {
+        wm->on_upload = NULL;
+    }
+    SpawnerStop(bench.spawner);
+    if (wm != NULL) {
+        WMShutdown(wm);
+    }
+    if (session_fd >= 0) {
+        unlink(session);
+    }
+    if (xvfb > 0) {
+        kill(xvfb, SIGTERM);
+        waitpid(xvfb, NULL, 0);
+    }
+
+    FILE *out = options.output != NULL ? fopen(options.output, "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "Unable to write %s\n", options.output);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"display\": \"%s\",\n", display);
+    fprintf(out, "  \"windows\": %d,\n", options.window_count);
+    fprintf(out, "  \"windows_shown\": %d,\n", shown);
+    fprintf(out, "  \"composite\": \"%s\",\n", CompositeName(options.wm.composite));
+    fprintf(out, "  \"capture\": \"%s\",\n", options.wm.capture == CAPTURE_BACKEND_XCB ? "xcb" : "xlib");
+    fprintf(out, "  \"upload\": \"%s\",\n", options.wm.sync_upload ? "sync" : "pbo");
+    fprintf(out, "  \"frames\": %d,\n", bench.frame_count);
+    fprintf(out, "  \"seconds\": %.3f,\n", seconds);
+    fprintf(out, "  \"fps\": %.2f,\n", seconds > 0 ? bench.frame_count / seconds : 0.0);
+    fprintf(out, "  \"updates_per_second\": %.2f,\n", seconds > 0 ? bench.updates / seconds : 0.0);
+    PrintPercentiles(out, "frame_ms", bench.frame_ms, bench.frame_count);
+    PrintPercentiles(out, "latency_ms", bench.latency_ms, bench.latency_count);
+    fprintf(out, "  \"idle_cpu_percent\": %.2f,\n", idle_cpu);
+    fprintf(out, "  \"idle_render_cpu_percent\": %.2f,\n", idle_render_cpu);
+    fprintf(out, "  \"idle_frames\": %d,\n", idle_frames);
+    fprintf(out, "  \"idle_wakeups\": %d,\n", idle_wakeups);
+    PrintPercentiles(out, "wake_latency_ms", bench.wake_ms, bench.wake_count);
+    fprintf(out, "  \"restart_shown_ms\": %.1f,\n", cold.shown_ms);
+    fprintf(out, "  \"restart_live_ms\": %.1f,\n", cold.live_ms);
+    fprintf(out, "  \"restart_session_shown_ms\": %.1f,\n", warm.shown_ms);
+    fprintf(out, "  \"restart_session_live_ms\": %.1f,\n", warm.live_ms);
+    fprintf(out, "  \"ok\": %s\n", shown >= options.window_count ? "true" : "false");
+    fprintf(out, "}\n");
+    if (out != stdout) fclose(out);
+
+    free(bench.frame_ms);
+    free(bench.latency_ms);
+    return shown >= options.window_count ? 0 : 1;
+}
@@ -0,0 +1,912 @@
+#include "billboard.h"
+#include "da.h"
+#include "occlusion.h"
+#include "picking.h"
+#include "registry.h"
+#include "swizzle.h"
+#include "tiles.h"
+
+#include "raymath.h"
+
+#include <time.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES 1
+// Reference cycles, at the TSC's fixed rate rather than the core's clock
+static uint64_t Cycles(void) { return __rdtsc(); }
+#else
+#define HAVE_CYCLES 0
+static uint64_t Cycles(void) { return 0; }
+#endif
+
+#define MAX_PARAMS 16
+// Rects a diff may come back as, as in capture.h
+#define CAPTURE_RECTS 16
+
+typedef struct {
+    int sizes[MAX_PARAMS][2];
+    int size_count;
+    int windows[MAX_PARAMS];
+    int window_count;
+    double seconds; // per measurement
+} Options;
+
+static Options options = {
+    .sizes = {{640, 480}, {1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}},
+    .size_count = 5,
+    .windows = {16, 64, 256, 1024},
+    .window_count = 4,
+    .seconds = 0.25,
+};
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    double ns;     // per call
+    double cycles; // per call, 0 where there's no cycle counter
+} Timing;
+
+// Call run(ctx) until options.seconds have gone by, after one call to warm
+// caches and allocations up
+static Timing Measure(void (*run)(void *ctx), void *ctx) {
+    run(ctx);
+
+    long iterations = 0;
+    double start = Now();
+    uint64_t start_cycles = Cycles();
+    double elapsed = 0.0;
+    do {
+        run(ctx);
+        iterations++;
+        elapsed = Now() - start;
+    } while (elapsed < options.seconds);
+    uint64_t cycles = Cycles() - start_cycles;
+
+    return (Timing){elapsed * 1e9 / iterations, (double)cycles / iterations};
+}
+
+static void ReportHeader(void) {
+    printf("%-14s %-8s %-10s %14s %10s %12s %s\n",
+           "kernel", "variant", "param", "ns/op", "MB/s", "cycles/item", "item");
+}
+
+// One line per measurement in fixed columns, so runs can be diffed or fed
+// to a script. bytes is what one call touches, 0 where a rate means
+// nothing; items is what cycles are counted per.
+static void Report(const char *kernel, const char *variant, const char *param,
+                   Timing t, double bytes, double items, const char *item) {
+    char rate[32] = "-";
+    char cycles[32] = "-";
+    if (bytes > 0) snprintf(rate, sizeof(rate), "%.1f", bytes * 1e3 / t.ns);
+    if (HAVE_CYCLES) snprintf(cycles, sizeof(cycles), "%.3f", t.cycles / items);
+    printf("%-14s %-8s %-10s %14.1f %10s %12s %s\n",
+           kernel, variant, param, t.ns, rate, cycles, item);
+    fflush(stdout);
+}
+
+static float Random(unsigned int *seed, float min, float max) {
+    *seed = *seed * 1103515245u + 12345u;
+    return min + (max - min) * ((*seed >> 8) & 0xFFFF) / 65535.0f;
+}
+
+static void FillPattern(unsigned char *data, size_t size, unsigned int seed) {
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (unsigned char)(seed >> 16);
+    }
+}
+
+// Compare a kernel against the scalar path, both as a copy into a padded
+// destination and in place, for widths that exercise every tail length
+static bool CheckSwizzle(SwizzleKernel kernel) {
+    const int widths[] = {1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 641};
+    const int pads[] = {0, 4, 12, 60};
+    const int height = 3;
+
+    for (size_t wi = 0; wi < sizeof(widths) / sizeof(widths[0]); wi++) {
+        for (size_t pi = 0; pi < sizeof(pads) / sizeof(pads[0]); pi++) {
+            int width = widths[wi];
+            size_t src_stride = width * 4 + pads[pi];
+            size_t dst_stride = width * 4 + pads[(pi + 1) % 4];
+            size_t src_size = src_stride * height;
+            size_t dst_size = dst_stride * height;
+
+            unsigned char *src = malloc(src_size);
+            unsigned char *expect = malloc(dst_size);
+            unsigned char *got = malloc(dst_size);
+            unsigned char *inplace = malloc(src_size);
+            FillPattern(src, src_size, width * 31 + pads[pi]);
+            memset(expect, 0xAB, dst_size);
+            memset(got, 0xAB, dst_size);
+            memcpy(inplace, src, src_size);
+
+            SwizzleSetKernel(SWIZZLE_SCALAR);
+            SwizzleBGRAToRGBA(expect, dst_stride, src, src_stride, width, height);
+            SwizzleSetKernel(kernel);
+            SwizzleBGRAToRGBA(got, dst_stride, src, src_stride, width, height);
+            SwizzleBGRAToRGBA(inplace, src_stride, inplace, src_stride, width, height);
+
+            // Padding in the destination must be left alone too
+            bool ok = memcmp(expect, got, dst_size) == 0;
+            for (int y = 0; ok && y < height; y++) {
+                ok = memcmp(expect + y * dst_stride, inplace + y * src_stride, width * 4) == 0;
+            }
+
+            free(src);
+            free(expect);
+            free(got);
+            free(inplace);
+
+            if (!ok) {
+                fprintf(stderr, "swizzle %s mismatch: width %d, pad %d\n",
+                        SwizzleKernelName(kernel), width, pads[pi]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Straightforward box filter to check the downsampler against
+static void DownsampleReference(unsigned char *dst, size_t dst_stride,
+                                const unsigned char *src, size_t src_stride,
+                                int width, int height, int lod) {
+    int block = 1 << lod;
+    for (int y = 0; y < height >> lod; y++) {
+        for (int x = 0; x < width >> lod; x++) {
+            unsigned int sum[4] = {0};
+            for (int by = 0; by < block; by++) {
+                for (int bx = 0; bx < block; bx++) {
+                    const unsigned char *p = src + (size_t)(y * block + by) * src_stride + (size_t)(x * block + bx) * 4;
+                    for (int c = 0; c < 4; c++) sum[c] += p[c];
+                }
+            }
+            unsigned char *out = dst + (size_t)y * dst_stride + (size_t)x * 4;
+            unsigned int round = block * block / 2;
+            out[0] = (sum[2] + round) / (block * block);
+            out[1] = (sum[1] + round) / (block * block);
+            out[2] = (sum[0] + round) / (block * block);
+            out[3] = (sum[3] + round) / (block * block);
+        }
+    }
+}
+
+static bool CheckDownsample(SwizzleKernel kernel) {
+    const int widths[] = {1, 2, 3, 17, 33, 255, 256, 257, 600};
+    const int height = 35;
+    SwizzleSetKernel(kernel);
+
+    for (int lod = 0; lod <= SWIZZLE_MAX_LOD; lod++) {
+        for (size_t wi = 0; wi < sizeof(widths) / sizeof(widths[0]); wi++) {
+            int width = widths[wi];
+            size_t src_stride = width * 4 + 12;
+            size_t dst_stride = (width >> lod) * 4 + 4;
+            size_t dst_size = dst_stride * (height >> lod);
+
+            unsigned char *src = malloc(src_stride * height);
+            unsigned char *expect = malloc(dst_size + 1);
+            unsigned char *got = malloc(dst_size + 1);
+            FillPattern(src, src_stride * height, width * 7 + lod);
+            memset(expect, 0xAB, dst_size + 1);
+            memset(got, 0xAB, dst_size + 1);
+
+            DownsampleReference(expect, dst_stride, src, src_stride, width, height, lod);
+            SwizzleDownsampleBGRAToRGBA(got, dst_stride, src, src_stride, width, height, lod);
+            bool ok = memcmp(expect, got, dst_size + 1) == 0;
+
+            free(src);
+            free(expect);
+            free(got);
+
+            if (!ok) {
+                fprintf(stderr, "downsample %s mismatch: width %d, lod %d\n",
+                        SwizzleKernelName(kernel), width, lod);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    unsigned char *src;
+    unsigned char *dst;
+    size_t src_stride;
+    size_t dst_stride;
+    int width;
+    int height;
+    int lod;
+} ImageJob;
+
+static void RunSwizzle(void *ctx) {
+    ImageJob *job = ctx;
+    SwizzleBGRAToRGBA(job->dst, job->dst_stride, job->src, job->src_stride, job->width, job->height);
+}
+
+static void RunDownsample(void *ctx) {
+    ImageJob *job = ctx;
+    SwizzleDownsampleBGRAToRGBA(job->dst, job->dst_stride, job->src, job->src_stride,
+                                job->width, job->height, job->lod);
+}
+
+static void BenchSwizzle(SwizzleKernel kernel, int width, int height) {
+    // X pads rows to the scanline unit; a few extra bytes keep that honest
+    ImageJob job = {
+        .src_stride = width * 4 + 64,
+        .dst_stride = width * 4,
+        .width = width,
+        .height = height,
+    };
+    job.src = malloc(job.src_stride * height);
+    job.dst = malloc(job.dst_stride * height);
+    FillPattern(job.src, job.src_stride * height, 1);
+    SwizzleSetKernel(kernel);
+
+    char param[32];
+    snprintf(param, sizeof(param), "%dx%d", width, height);
+    double pixels = (double)width * height;
+    Report("swizzle", SwizzleKernelName(kernel), param, Measure(RunSwizzle, &job),
+           pixels * 8, pixels, "px");
+
+    free(job.src);
+    free(job.dst);
+}
+
+static void BenchDownsample(SwizzleKernel kernel, int width, int height, int lod) {
+    ImageJob job = {
+        .src_stride = width * 4 + 64,
+        .dst_stride = (width >> lod) * 4,
+        .width = width,
+        .height = height,
+        .lod = lod,
+    };
+    job.src = malloc(job.src_stride * height);
+    job.dst = malloc(job.dst_stride * (height >> lod));
+    FillPattern(job.src, job.src_stride * height, 1);
+    SwizzleSetKernel(kernel);
+
+    // Rates are for the source pixels read, which is where the time goes
+    char name[32];
+    char param[32];
+    snprintf(name, sizeof(name), "downsample/%d", 1 << lod);
+    snprintf(param, sizeof(param), "%dx%d", width, height);
+    double pixels = (double)width * height;
+    Report(name, SwizzleKernelName(kernel), param, Measure(RunDownsample, &job),
+           pixels * 4, pixels, "px");
+
+    free(job.src);
+    free(job.dst);
+}
+
+typedef struct {
+    TileHashes tiles;
+    unsigned char *pixels;
+    int width;
+    int height;
+    bool poke; // change a tile before every diff
+    XRectangle rects[CAPTURE_RECTS];
+} TileJob;
+
+static void RunTiles(void *ctx) {
+    TileJob *job = ctx;
+    if (job->poke) {
+        size_t middle = ((size_t)(job->height / 2) * job->width + job->width / 2) * 4;
+        job->pixels[middle] ^= 0xFF;
+    }
+    TileHashesDiff(&job->tiles, job->pixels, job->width, job->height, job->rects, CAPTURE_RECTS);
+}
+
+// A first frame has nothing to compare with, the same frame again has
+// nothing changed, and one changed pixel is its tile and nothing else
+static bool CheckTiles(void) {
+    const int width = 300;
+    const int height = 200;
+    unsigned char *pixels = malloc((size_t)width * height * 4);
+    FillPattern(pixels, (size_t)width * height * 4, 3);
+    TileHashes tiles = {0};
+    XRectangle rects[CAPTURE_RECTS];
+
+    int first = TileHashesDiff(&tiles, pixels, width, height, rects, CAPTURE_RECTS);
+    int same = TileHashesDiff(&tiles, pixels, width, height, rects, CAPTURE_RECTS);
+    pixels[((size_t)70 * width + 270) * 4] ^= 0xFF;
+    int changed = TileHashesDiff(&tiles, pixels, width, height, rects, CAPTURE_RECTS);
+    bool ok = first == -1 && same == 0 && changed == 1 &&
+              rects[0].x == 256 && rects[0].y == 64 &&
+              rects[0].width == width - 256 && rects[0].height == TILE_SIZE;
+
+    TileHashesFree(&tiles);
+    free(pixels);
+    if (!ok) {
+        fprintf(stderr, "tiles mismatch: %d %d %d\n", first, same, changed);
+    }
+    return ok;
+}
+
+static void BenchTiles(int width, int height, bool poke) {
+    TileJob job = {.width = width, .height = height, .poke = poke};
+    job.pixels = malloc((size_t)width * height * 4);
+    FillPattern(job.pixels, (size_t)width * height * 4, 1);
+
+    char param[32];
+    snprintf(param, sizeof(param), "%dx%d", width, height);
+    double pixels = (double)width * height;
+    Report("tiles", poke ? "one" : "none", param, Measure(RunTiles, &job),
+           pixels * 4, pixels, "px");
+
+    TileHashesFree(&job.tiles);
+    free(job.pixels);
+}
+
+typedef struct {
+    OcclusionBuffer occ;
+    SchedulerView view;
+    Vector3 (*quads)[4];
+    int count;
+} OcclusionJob;
+
+static void RunOcclusion(void *ctx) {
+    OcclusionJob *job = ctx;
+    OcclusionBegin(&job->occ, &job->view, job->count);
+    for (int i = 0; i < job->count; i++) {
+        OcclusionAdd(&job->occ, i, job->quads[i]);
+    }
+    OcclusionResolve(&job->occ);
+}
+
+// Windows of a few sizes facing the camera at different depths and
+// overlapping, roughly how a busy scene looks
+static void BenchOcclusion(int count) {
+    Camera camera = {
+        .position = {0.0f, 0.0f, 8.0f},
+        .target = {0.0f, 0.0f, 0.0f},
+        .up = {0.0f, 1.0f, 0.0f},
+        .fovy = 45.0f,
+        .projection = CAMERA_PERSPECTIVE,
+    };
+    OcclusionJob job = {
+        .view = SchedulerViewFromCamera(camera, 1920, 1080),
+        .count = count,
+    };
+    job.quads = malloc(count * sizeof(*job.quads));
+
+    unsigned int seed = 7;
+    for (int i = 0; i < count; i++) {
+        float r[5];
+        for (int k = 0; k < 5; k++) {
+            seed = seed * 1103515245u + 12345u;
+            r[k] = (seed >> 8 & 0xFFFF) / 65535.0f;
+        }
+        Vector3 center = {(r[0] - 0.5f) * 12.0f, (r[1] - 0.5f) * 8.0f, -r[2] * 20.0f};
+        float half_w = 0.5f + r[3] * 1.5f;
+        float half_h = 0.5f + r[4] * 1.0f;
+        job.quads[i][0] = Vector3Add(center, (Vector3){-half_w, half_h, 0.0f});
+        job.quads[i][1] = Vector3Add(center, (Vector3){half_w, half_h, 0.0f});
+        job.quads[i][2] = Vector3Add(center, (Vector3){half_w, -half_h, 0.0f});
+        job.quads[i][3] = Vector3Add(center, (Vector3){-half_w, -half_h, 0.0f});
+    }
+
+    char param[32];
+    snprintf(param, sizeof(param), "%d", count);
+    Report("occlusion", "cpu", param, Measure(RunOcclusion, &job), 0, count, "window");
+
+    OcclusionFree(&job.occ);
+    free(job.quads);
+}
+
+// Shaped like the render thread's update queue
+typedef struct {
+    int index;
+    float priority;
+} Entry;
+
+typedef struct {
+    Entry *items;
+    size_t count;
+    size_t capacity;
+} DA_entry;
+
+typedef struct {
+    DA_entry da;
+    int count;
+    unsigned int seed;
+} ArrayJob;
+
+// Refill from empty, as the update queue is every frame
+static void RunAppend(void *ctx) {
+    ArrayJob *job = ctx;
+    job->da.count = 0;
+    for (int i = 0; i < job->count; i++) {
+        da_append(&job->da, ((Entry){i, (float)i}));
+    }
+}
+
+// Swap-remove anywhere and append, as windows come and go
+static void RunChurn(void *ctx) {
+    ArrayJob *job = ctx;
+    for (int i = 0; i < job->count; i++) {
+        job->seed = job->seed * 1103515245u + 12345u;
+        da_remove_unordered(&job->da, (job->seed >> 8) % job->da.count);
+        da_append(&job->da, ((Entry){i, (float)i}));
+    }
+}
+
+static void BenchArray(int count) {
+    ArrayJob job = {.count = count, .seed = 5};
+    char param[32];
+    snprintf(param, sizeof(param), "%d", count);
+
+    Report("da", "append", param, Measure(RunAppend, &job),
+           (double)count * sizeof(Entry), count, "elem");
+    // RunAppend left it full
+    Report("da", "churn", param, Measure(RunChurn, &job),
+           (double)count * sizeof(Entry) * 2, count, "elem");
+
+    da_free(job.da);
+}
+
+// Windows scattered around the camera, scaled and turned every which way.
+// Every eighth one sits right above or below it, where LookAtTarget has to
+// swap its up vector, and one sits on top of it.
+static void RandomTransforms(Matrix *transforms, int count, Vector3 eye, unsigned int *seed) {
+    for (int i = 0; i < count; i++) {
+        float scale = Random(seed, 0.03f, 10.0f);
+        Vector3 pos = {Random(seed, -20.0f, 20.0f), Random(seed, -5.0f, 5.0f), Random(seed, -20.0f, 20.0f)};
+        if (i % 8 == 3) {
+            pos = (Vector3){eye.x + Random(seed, -0.01f, 0.01f), eye.y + Random(seed, -5.0f, 5.0f), eye.z};
+        }
+        if (i == count / 2) {
+            pos = eye;
+        }
+
+        Matrix m = MatrixScale(scale, scale, scale);
+        m = MatrixMultiply(m, MatrixRotateX(Random(seed, -PI, PI)));
+        m = MatrixMultiply(m, MatrixRotateY(Random(seed, -PI, PI)));
+        transforms[i] = MatrixMultiply(m, MatrixTranslate(pos.x, pos.y, pos.z));
+    }
+}
+
+static bool Close(float a, float b) {
+    return fabsf(a - b) <= 1e-5f * (1.0f + fabsf(a) + fabsf(b));
+}
+
+// Every billboard kernel against LookAtTarget one window at a time, for
+// counts that leave every tail length over
+static bool CheckBillboard(BillboardKernel kernel) {
+    const int counts[] = {1, 7, 9, 33, 1024};
+    const Vector3 eye = {0.0f, 2.0f, 8.0f};
+    BillboardSetKernel(kernel);
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int count = counts[c];
+        unsigned int seed = 4321u + count;
+        Matrix *input = malloc(count * sizeof(Matrix));
+        Matrix *out = malloc(count * sizeof(Matrix));
+        RandomTransforms(input, count, eye, &seed);
+        memcpy(out, input, count * sizeof(Matrix));
+        BillboardTransforms(out, count, eye);
+
+        int bad = -1;
+        for (int i = 0; i < count && bad < 0; i++) {
+            Matrix want = LookAtTarget(input[i], eye);
+            const float *a = (const float *)&want;
+            const float *b = (const float *)&out[i];
+            for (int e = 0; e < 16 && bad < 0; e++) {
+                if (!Close(a[e], b[e])) bad = i;
+            }
+        }
+        free(input);
+        free(out);
+
+        if (bad >= 0) {
+            fprintf(stderr, "billboard %s mismatch: window %d of %d\n", BillboardKernelName(kernel), bad, count);
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    Matrix *transforms;
+    int count;
+    Vector3 eye;
+    int iteration;
+} BillboardJob;
+
+// Move the camera a little, like every frame in camera mode
+static Vector3 NextTarget(BillboardJob *job) {
+    job->iteration++;
+    return (Vector3){job->eye.x + 0.001f * (job->iteration & 15), job->eye.y, job->eye.z};
+}
+
+static void RunLookAt(void *ctx) {
+    BillboardJob *job = ctx;
+    Vector3 target = NextTarget(job);
+    for (int i = 0; i < job->count; i++) {
+        job->transforms[i] = LookAtTarget(job->transforms[i], target);
+    }
+}
+
+static void RunBillboard(void *ctx) {
+    BillboardJob *job = ctx;
+    BillboardTransforms(job->transforms, job->count, NextTarget(job));
+}
+
+static void BenchBillboard(int count) {
+    BillboardJob job = {.count = count, .eye = {0.0f, 2.0f, 8.0f}};
+    job.transforms = malloc(count * sizeof(Matrix));
+    unsigned int seed = 4321u + count;
+    RandomTransforms(job.transforms, count, job.eye, &seed);
+
+    char param[32];
+    snprintf(param, sizeof(param), "%d", count);
+    double bytes = (double)count * sizeof(Matrix) * 2;
+    Report("billboard", "lookat", param, Measure(RunLookAt, &job), bytes, count, "window");
+
+    BillboardKernel best = BillboardBestKernel();
+    for (int k = BILLBOARD_SCALAR; k <= (int)best; k++) {
+        BillboardSetKernel(k);
+        Report("billboard", BillboardKernelName(k), param, Measure(RunBillboard, &job), bytes, count, "window");
+    }
+
+    free(job.transforms);
+}
+
+typedef struct {
+    WindowRegistry reg;
+    Vector3 sink;
+} GeometryJob;
+
+static void RunNormal(void *ctx) {
+    GeometryJob *job = ctx;
+    Vector3 sum = {0};
+    for (int i = 0; i < job->reg.count; i++) {
+        sum = Vector3Add(sum, GetWindowNormal(&job->reg, i));
+    }
+    job->sink = sum;
+}
+
+static void RunCenter(void *ctx) {
+    GeometryJob *job = ctx;
+    Vector3 sum = {0};
+    for (int i = 0; i < job->reg.count; i++) {
+        sum = Vector3Add(sum, GetWindowCenter(&job->reg, i));
+    }
+    job->sink = sum;
+}
+
+static void RunCorners(void *ctx) {
+    GeometryJob *job = ctx;
+    Vector3 sum = {0};
+    for (int i = 0; i < job->reg.count; i++) {
+        Vector3 corners[4];
+        GetWindowCorners(&job->reg, i, corners);
+        sum = Vector3Add(sum, corners[3]);
+    }
+    job->sink = sum;
+}
+
+// What every frame asks of each window's transform, walking the registry's
+// columns as the render thread does
+static void BenchGeometry(int count) {
+    GeometryJob job;
+    WindowRegistryInit(&job.reg, 0);
+    Matrix *transforms = malloc(count * sizeof(Matrix));
+    unsigned int seed = 99u + count;
+    RandomTransforms(transforms, count, (Vector3){0.0f, 2.0f, 8.0f}, &seed);
+    for (int i = 0; i < count; i++) {
+        WindowRegistryAdd(&job.reg);
+        job.reg.transform[i] = transforms[i];
+        job.reg.size[i] = (Vector2){1.5f, 1.0f};
+    }
+    free(transforms);
+
+    char param[32];
+    snprintf(param, sizeof(param), "%d", count);
+    double bytes = (double)count * sizeof(Matrix);
+    Report("window", "normal", param, Measure(RunNormal, &job), bytes, count, "window");
+    Report("window", "center", param, Measure(RunCenter, &job), bytes, count, "window");
+    Report("window", "corners", param, Measure(RunCorners, &job), bytes, count, "window");
+
+    WindowRegistryFree(&job.reg);
+}
+
+// Plane the windows are made from, laid out like GenMeshPlane(w, l, 1, 1)
+static float plane_vertices[12] = {
+    -0.75f, 0.0f, -0.5f,
+     0.75f, 0.0f, -0.5f,
+    -0.75f, 0.0f,  0.5f,
+     0.75f, 0.0f,  0.5f,
+};
+static unsigned short plane_indices[6] = {0, 2, 1, 1, 2, 3};
+
+#define PICK_RAYS 1024
+
+typedef struct {
+    Matrix *transforms;
+    PickQuad *quads;
+    PickIndex index;
+    Ray rays[PICK_RAYS];
+    int count;
+    int moved; // windows dragged per cast, for the refit variant
+    int next;  // ray
+    unsigned int seed;
+    int sink;
+} PickJob;
+
+// Stand the plane up and turn it roughly towards the camera, like LookAtTarget
+static Matrix PickTransform(unsigned int *seed, float spread) {
+    Matrix m = MatrixRotateX(PI / 2.0f);
+    m = MatrixMultiply(m, MatrixRotateY(Random(seed, -0.6f, 0.6f)));
+    return MatrixMultiply(m, MatrixTranslate(Random(seed, -spread, spread), Random(seed, -spread * 0.4f, spread * 0.4f),
+                                             Random(seed, -spread * 2.0f, 0.0f)));
+}
+
+static void PlaneCorners(Matrix transform, Vector3 corners[4]) {
+    for (int i = 0; i < 4; i++) {
+        Vector3 v = {plane_vertices[3*i], plane_vertices[3*i + 1], plane_vertices[3*i + 2]};
+        corners[i] = Vector3Transform(v, transform);
+    }
+}
+
+// What WMUpdate did before: raylib's triangle test against every mesh
+static int PickMesh(const PickJob *job, Ray ray, RayCollision *collision) {
+    Mesh mesh = {.vertexCount = 4, .triangleCount = 2, .vertices = plane_vertices, .indices = plane_indices};
+    int best = -1;
+    *collision = (RayCollision){.distance = 1000000.0f};
+    for (int i = 0; i < job->count; i++) {
+        RayCollision hit = GetRayCollisionMesh(ray, mesh, job->transforms[i]);
+        if (hit.hit && hit.distance < collision->distance) {
+            *collision = hit;
+            best = i;
+        }
+    }
+    return best;
+}
+
+static int PickLinear(const PickJob *job, Ray ray, RayCollision *collision) {
+    int best = -1;
+    *collision = (RayCollision){.distance = 1000000.0f};
+    for (int i = 0; i < job->count; i++) {
+        RayCollision hit = PickQuadCollision(ray, &job->quads[i]);
+        if (hit.hit && hit.distance < collision->distance) {
+            *collision = hit;
+            best = i;
+        }
+    }
+    return best;
+}
+
+static Ray NextRay(PickJob *job) {
+    job->next = (job->next + 1) % PICK_RAYS;
+    return job->rays[job->next];
+}
+
+static void RunPickMesh(void *ctx) {
+    PickJob *job = ctx;
+    RayCollision hit;
+    job->sink += PickMesh(job, NextRay(job), &hit);
+}
+
+static void RunPickQuad(void *ctx) {
+    PickJob *job = ctx;
+    RayCollision hit;
+    job->sink += PickLinear(job, NextRay(job), &hit);
+}
+
+static void RunPickBvh(void *ctx) {
+    PickJob *job = ctx;
+    RayCollision hit;
+    job->sink += PickIndexCast(&job->index, NextRay(job), &hit);
+}
+
+// Drag a few windows a little before each cast, as the move and scale modes do
+static void RunPickRefit(void *ctx) {
+    PickJob *job = ctx;
+    for (int m = 0; m < job->moved; m++) {
+        int item = (job->next * 7919 + m * 104729) % job->count;
+        Matrix nudge = MatrixTranslate(Random(&job->seed, -0.05f, 0.05f), Random(&job->seed, -0.05f, 0.05f), 0.0f);
+        job->transforms[item] = MatrixMultiply(job->transforms[item], nudge);
+
+        Vector3 corners[4];
+        PlaneCorners(job->transforms[item], corners);
+        PickIndexSet(&job->index, item, corners);
+    }
+    RayCollision hit;
+    job->sink += PickIndexCast(&job->index, NextRay(job), &hit);
+}
+
+// Picking the window under the cursor, per ray. Returns false if the three
+// ways of picking disagree on what's hit.
+static bool BenchPick(int count) {
+    // Keep the density about the same as the scene grows
+    float spread = 4.0f * cbrtf((float)count);
+    PickJob *job = calloc(1, sizeof(PickJob));
+    job->count = count;
+    job->moved = count / 100 > 0 ? count / 100 : 1;
+    job->seed = 1234u + count;
+    job->transforms = malloc(count * sizeof(Matrix));
+    job->quads = malloc(count * sizeof(PickQuad));
+    for (int i = 0; i < count; i++) {
+        Vector3 corners[4];
+        job->transforms[i] = PickTransform(&job->seed, spread);
+        PlaneCorners(job->transforms[i], corners);
+        job->quads[i] = PickQuadFromCorners(corners);
+        PickIndexSet(&job->index, i, corners);
+    }
+    Vector3 position = {0.0f, 0.0f, 10.0f};
+    for (int i = 0; i < PICK_RAYS; i++) {
+        Vector3 target = {Random(&job->seed, -spread, spread), Random(&job->seed, -spread * 0.4f, spread * 0.4f), -spread};
+        job->rays[i] = (Ray){position, Vector3Normalize(Vector3Subtract(target, position))};
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < PICK_RAYS; i++) {
+        RayCollision a, b, c;
+        int ia = PickMesh(job, job->rays[i], &a);
+        int ib = PickLinear(job, job->rays[i], &b);
+        int ic = PickIndexCast(&job->index, job->rays[i], &c);
+        if (ia != ib || ib != ic) {
+            // Two windows can cross, in which case either answer is right
+            bool tie = a.hit && b.hit && c.hit && fabsf(a.distance - b.distance) < 1e-4f && fabsf(b.distance - c.distance) < 1e-4f;
+            mismatches += !tie;
+        }
+    }
+
+    if (mismatches == 0) {
+        char param[32];
+        char refit[16];
+        snprintf(param, sizeof(param), "%d", count);
+        snprintf(refit, sizeof(refit), "refit%d", job->moved);
+        Report("pick", "mesh", param, Measure(RunPickMesh, job), 0, 1, "ray");
+        Report("pick", "quad", param, Measure(RunPickQuad, job), 0, 1, "ray");
+        Report("pick", "bvh", param, Measure(RunPickBvh, job), 0, 1, "ray");
+        Report("pick", refit, param, Measure(RunPickRefit, job), 0, 1, "ray");
+    }
+    else {
+        fprintf(stderr, "pick %d windows: %d rays disagree\n", count, mismatches);
+    }
+
+    PickIndexFree(&job->index);
+    free(job->transforms);
+    free(job->quads);
+    free(job);
+    return mismatches == 0;
+}
+
+// "640x480,1920x1080"
+static bool ParseSizes(const char *arg) {
+    options.size_count = 0;
+    while (*arg != '\0') {
+        int width, height, used;
+        if (options.size_count == MAX_PARAMS ||
+            sscanf(arg, "%dx%d%n", &width, &height, &used) != 2 || width <= 0 || height <= 0) {
+            return false;
+        }
+        options.sizes[options.size_count][0] = width;
+        options.sizes[options.size_count][1] = height;
+        options.size_count++;
+        arg += used;
+        if (*arg == ',') arg++;
+        else if (*arg != '\0') return false;
+    }
+    return options.size_count > 0;
+}
+
+// "16,256"
+static bool ParseWindows(const char *arg) {
+    options.window_count = 0;
+    while (*arg != '\0') {
+        int count, used;
+        if (options.window_count == MAX_PARAMS ||
+            sscanf(arg, "%d%n", &count, &used) != 1 || count <= 0) {
+            return false;
+        }
+        options.windows[options.window_count++] = count;
+        arg += used;
+        if (*arg == ',') arg++;
+        else if (*arg != '\0') return false;
+    }
+    return options.window_count > 0;
+}
+
+static void Usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--sizes=WxH[,WxH...]] [--windows=N[,N...]] [--seconds=S]\n", name);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool ok = true;
+        if (strncmp(arg, "--sizes=", 8) == 0) {
+            ok = ParseSizes(arg + 8);
+        }
+        else if (strncmp(arg, "--windows=", 10) == 0) {
+            ok = ParseWindows(arg + 10);
+        }
+        else if (strncmp(arg, "--seconds=", 10) == 0) {
+            options.seconds = atof(arg + 10);
+            ok = options.seconds > 0.0;
+        }
+        else {
+            ok = false;
+        }
+        if (!ok) {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    ReportHeader();
+    int failures = 0;
+    for (int k = 0; k < SWIZZLE_KERNEL_COUNT; k++) {
+        if (!SwizzleSetKernel(k)) {
+            fprintf(stderr, "swizzle %s unsupported\n", SwizzleKernelName(k));
+            continue;
+        }
+        if (!CheckSwizzle(k)) {
+            failures++;
+            continue;
+        }
+        for (int i = 0; i < options.size_count; i++) {
+            BenchSwizzle(k, options.sizes[i][0], options.sizes[i][1]);
+        }
+
+        if (!CheckDownsample(k)) {
+            failures++;
+            continue;
+        }
+        for (int i = 0; i < options.size_count; i++) {
+            for (int lod = 1; lod <= SWIZZLE_MAX_LOD; lod++) {
+                BenchDownsample(k, options.sizes[i][0], options.sizes[i][1], lod);
+            }
+        }
+    }
+
+    if (CheckTiles()) {
+        for (int i = 0; i < options.size_count; i++) {
+            BenchTiles(options.sizes[i][0], options.sizes[i][1], false);
+            BenchTiles(options.sizes[i][0], options.sizes[i][1], true);
+        }
+    }
+    else {
+        failures++;
+    }
+
+    bool billboard = true;
+    for (int k = BILLBOARD_SCALAR; k <= (int)BillboardBestKernel(); k++) {
+        if (!CheckBillboard(k)) billboard = false;
+    }
+    if (billboard) {
+        for (int i = 0; i < options.window_count; i++) {
+            BenchBillboard(options.windows[i]);
+        }
+    }
+    else {
+        failures++;
+    }
+    for (int i = 0; i < options.window_count; i++) {
+        BenchGeometry(options.windows[i]);
+    }
+    for (int i = 0; i < options.window_count; i++) {
+        failures += !BenchPick(options.windows[i]);
+    }
+    for (int i = 0; i < options.window_count; i++) {
+        BenchOcclusion(options.windows[i]);
+    }
+    for (int i = 0; i < options.window_count; i++) {
+        BenchArray(options.windows[i]);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -14,6 +14,12 @@ newoption
 	default = "opengl33"
 }
 
+newoption
+{
+	trigger = "profile",
+	description = "time the frame stages, with an overlay (F5) and trace export (F6)"
+}
+
 function download_progress(total, current)
     local ratio = current / total;
     ratio = math.min(math.max(ratio, 0), 1);
@@ -165,6 +171,11 @@ if (downloadRaylib) then
         includedirs { "../src" }
         includedirs { "../include" }
 
+        filter "options:profile"
+            defines {"PROFILE_ENABLED"}
+
+        filter{}
+
         links {"raylib"}
 
         cdialect "C17"
@@ -189,12 +200,71 @@ if (downloadRaylib) then
             libdirs {"../bin/%{cfg.buildcfg}"}
 
         filter "system:linux"
-            links {"pthread", "m", "dl", "rt", "X11"}
+            links {"pthread", "m", "dl", "rt", "X11", "Xext", "Xdamage", "Xfixes", "Xcomposite", "X11-xcb", "xcb", "xcb-shm", "xcb-damage", "xcb-xfixes", "GL"}
 
         filter "system:macosx"
             links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework"}
 
         filter{}
+
+    project "e2ebench"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        -- The whole window manager, driven by the bench instead of main.c
+        files {"../bench/e2ebench.c", "../src/**.c", "../src/**.h"}
+        removefiles {"../src/main.c"}
+        includedirs { "../src" }
+
+        filter "options:profile"
+            defines {"PROFILE_ENABLED"}
+
+        filter{}
+
+        links {"raylib"}
+
+        cdialect "C17"
+
+        includedirs {raylib_dir .. "/src" }
+        includedirs {raylib_dir .."/src/external" }
+        includedirs { raylib_dir .."/src/external/glfw/include" }
+        platform_defines()
+
+        filter "system:linux"
+            links {"pthread", "m", "dl", "rt", "X11", "Xext", "Xdamage", "Xfixes", "Xcomposite", "X11-xcb", "xcb", "xcb-shm", "xcb-damage", "xcb-xfixes", "GL"}
+
+        filter{}
+
+    project "microbench"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        files {"../bench/microbench.c", "../src/swizzle.c", "../src/tiles.c", "../src/occlusion.c", "../src/scheduler.c",
+               "../src/billboard.c", "../src/picking.c", "../src/registry.c"}
+        includedirs { "../src" }
+        includedirs {raylib_dir .. "/src" }
+
+        -- Compares picking against raylib's GetRayCollisionMesh, which pulls
+        -- in the rest of the library; nothing opens a window
+        links {"raylib"}
+
+        cdialect "C17"
+        platform_defines()
+
+        filter "action:vs*"
+            dependson {"raylib"}
+            links {"raylib.lib"}
+
+        filter "system:windows"
+            links {"winmm", "gdi32", "opengl32"}
+            libdirs {"../bin/%{cfg.buildcfg}"}
+
+        filter "system:linux"
+            links {"pthread", "m", "dl", "rt", "X11", "GL"}
+
+        filter{}
 		
 
     project "raylib"
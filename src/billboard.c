@@ -0,0 +1,290 @@
+#include "billboard.h"
+#include "raymath.h"
+
+#include <math.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BILLBOARD_X86 1
+#include <immintrin.h>
+#endif
+
+// Past this the direction is too close to world up to build a basis from it
+#define VERTICAL_LIMIT 0.999f
+
+typedef void (*BillboardFn)(Matrix *transforms, int count, Vector3 target);
+
+Matrix LookAtTarget(Matrix transform, Vector3 target) {
+    Vector3 pos = {transform.m12, transform.m13, transform.m14};
+
+    // Extract scale from original transform
+    Vector3 originalX = {transform.m0, transform.m1, transform.m2};
+    float scale = Vector3Length(originalX);
+
+    Vector3 direction = Vector3Subtract(target, pos);
+
+    // Define the new Y-axis as the direction to the camera
+    Vector3 Y = Vector3Normalize(direction);
+
+    // Define an up vector (world up, unless direction is nearly vertical)
+    Vector3 up = {0.0f, 1.0f, 0.0f};
+    if (fabsf(Y.y) > VERTICAL_LIMIT) { // If direction is nearly vertical, adjust up vector
+        up = (Vector3){0.0f, 0.0f, 1.0f};
+    }
+
+    // X-axis perpendicular to Y and up
+    Vector3 X = Vector3Normalize(Vector3CrossProduct(up, Y));
+    // Z-axis completes the orthonormal basis
+    Vector3 Z = Vector3CrossProduct(X, Y);
+
+    // Construct rotation matrix (columns are X, Y, Z)
+    Matrix newTransform = {
+        X.x * scale, Y.x * scale, Z.x * scale, pos.x,
+        X.y * scale, Y.y * scale, Z.y * scale, pos.y,
+        X.z * scale, Y.z * scale, Z.z * scale, pos.z,
+        0.0f, 0.0f, 0.0f, 1.0f
+    };
+
+    return newTransform;
+}
+
+static void BillboardScalar(Matrix *transforms, int count, Vector3 target) {
+    for (int i = 0; i < count; i++) {
+        transforms[i] = LookAtTarget(transforms[i], target);
+    }
+}
+
+#ifdef BILLBOARD_X86
+// The vector kernels do the same arithmetic as LookAtTarget in the same
+// order, lane by lane, so they agree with it to the last bit or nearly.
+// A Matrix is stored row by row, so transposing the first three rows of
+// four transforms gives each of their X columns and translations as one
+// vector apiece, and transposing back writes them out.
+
+// Per-lane results, one vector per matrix element that isn't constant
+typedef struct {
+    __m128 x[3], y[3], z[3], pos[3];
+} Basis4;
+
+__attribute__((target("sse2")))
+static void Normalize4(__m128 v[3]) {
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(v[0], v[0]), _mm_mul_ps(v[1], v[1])),
+                                           _mm_mul_ps(v[2], v[2])));
+    // Vector3Normalize leaves zero vectors alone
+    __m128 nonzero = _mm_cmpneq_ps(length, _mm_setzero_ps());
+    __m128 ilength = _mm_and_ps(nonzero, _mm_div_ps(_mm_set1_ps(1.0f), length));
+    for (int c = 0; c < 3; c++) {
+        v[c] = _mm_or_ps(_mm_and_ps(nonzero, _mm_mul_ps(v[c], ilength)), _mm_andnot_ps(nonzero, v[c]));
+    }
+}
+
+__attribute__((target("sse2")))
+static Basis4 LookAt4(const Matrix *m, Vector3 target) {
+    Basis4 b;
+    __m128 axis[3];
+    for (int r = 0; r < 3; r++) {
+        const float *row0 = &m[0].m0 + 4 * r;
+        __m128 a = _mm_loadu_ps(row0);
+        __m128 c = _mm_loadu_ps(row0 + 16);
+        __m128 d = _mm_loadu_ps(row0 + 32);
+        __m128 e = _mm_loadu_ps(row0 + 48);
+        _MM_TRANSPOSE4_PS(a, c, d, e);
+        axis[r] = a;
+        b.pos[r] = e;
+    }
+
+    __m128 scale = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(axis[0], axis[0]), _mm_mul_ps(axis[1], axis[1])),
+                                          _mm_mul_ps(axis[2], axis[2])));
+
+    b.y[0] = _mm_sub_ps(_mm_set1_ps(target.x), b.pos[0]);
+    b.y[1] = _mm_sub_ps(_mm_set1_ps(target.y), b.pos[1]);
+    b.y[2] = _mm_sub_ps(_mm_set1_ps(target.z), b.pos[2]);
+    Normalize4(b.y);
+
+    // up x Y is (Y.z, 0, -Y.x) for world up and (-Y.y, Y.x, 0) for +Z
+    __m128 zero = _mm_setzero_ps();
+    __m128 abs_y = _mm_andnot_ps(_mm_set1_ps(-0.0f), b.y[1]);
+    __m128 vertical = _mm_cmpgt_ps(abs_y, _mm_set1_ps(VERTICAL_LIMIT));
+    __m128 level[3] = {b.y[2], zero, _mm_sub_ps(zero, b.y[0])};
+    __m128 steep[3] = {_mm_sub_ps(zero, b.y[1]), b.y[0], zero};
+    for (int c = 0; c < 3; c++) {
+        b.x[c] = _mm_or_ps(_mm_and_ps(vertical, steep[c]), _mm_andnot_ps(vertical, level[c]));
+    }
+    Normalize4(b.x);
+
+    b.z[0] = _mm_sub_ps(_mm_mul_ps(b.x[1], b.y[2]), _mm_mul_ps(b.x[2], b.y[1]));
+    b.z[1] = _mm_sub_ps(_mm_mul_ps(b.x[2], b.y[0]), _mm_mul_ps(b.x[0], b.y[2]));
+    b.z[2] = _mm_sub_ps(_mm_mul_ps(b.x[0], b.y[1]), _mm_mul_ps(b.x[1], b.y[0]));
+
+    for (int c = 0; c < 3; c++) {
+        b.x[c] = _mm_mul_ps(b.x[c], scale);
+        b.y[c] = _mm_mul_ps(b.y[c], scale);
+        b.z[c] = _mm_mul_ps(b.z[c], scale);
+    }
+    return b;
+}
+
+__attribute__((target("sse2")))
+static void Store4(Matrix *m, const Basis4 *b) {
+    for (int r = 0; r < 3; r++) {
+        __m128 a = b->x[r], c = b->y[r], d = b->z[r], e = b->pos[r];
+        _MM_TRANSPOSE4_PS(a, c, d, e);
+        float *row0 = &m[0].m0 + 4 * r;
+        _mm_storeu_ps(row0, a);
+        _mm_storeu_ps(row0 + 16, c);
+        _mm_storeu_ps(row0 + 32, d);
+        _mm_storeu_ps(row0 + 48, e);
+    }
+
+    __m128 last = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    for (int k = 0; k < 4; k++) {
+        _mm_storeu_ps(&m[k].m3, last);
+    }
+}
+
+__attribute__((target("sse2")))
+static void BillboardSSE2(Matrix *transforms, int count, Vector3 target) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Basis4 b = LookAt4(transforms + i, target);
+        Store4(transforms + i, &b);
+    }
+    BillboardScalar(transforms + i, count - i, target);
+}
+
+// Eight lanes of the same; the transposes stay 128 bits wide and the
+// halves are joined for the arithmetic
+typedef struct {
+    __m256 x[3], y[3], z[3];
+} Basis8;
+
+__attribute__((target("avx")))
+static void Normalize8(__m256 v[3]) {
+    __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(v[0], v[0]), _mm256_mul_ps(v[1], v[1])),
+                                                 _mm256_mul_ps(v[2], v[2])));
+    __m256 nonzero = _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+    __m256 ilength = _mm256_and_ps(nonzero, _mm256_div_ps(_mm256_set1_ps(1.0f), length));
+    for (int c = 0; c < 3; c++) {
+        v[c] = _mm256_blendv_ps(v[c], _mm256_mul_ps(v[c], ilength), nonzero);
+    }
+}
+
+__attribute__((target("avx")))
+static void BillboardAVX(Matrix *transforms, int count, Vector3 target) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        Matrix *m = transforms + i;
+
+        __m256 axis[3], pos[3];
+        for (int r = 0; r < 3; r++) {
+            const float *row0 = &m[0].m0 + 4 * r;
+            __m128 a = _mm_loadu_ps(row0), c = _mm_loadu_ps(row0 + 16);
+            __m128 d = _mm_loadu_ps(row0 + 32), e = _mm_loadu_ps(row0 + 48);
+            __m128 f = _mm_loadu_ps(row0 + 64), g = _mm_loadu_ps(row0 + 80);
+            __m128 h = _mm_loadu_ps(row0 + 96), k = _mm_loadu_ps(row0 + 112);
+            _MM_TRANSPOSE4_PS(a, c, d, e);
+            _MM_TRANSPOSE4_PS(f, g, h, k);
+            axis[r] = _mm256_set_m128(f, a);
+            pos[r] = _mm256_set_m128(k, e);
+        }
+
+        __m256 scale = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(axis[0], axis[0]),
+                                                                  _mm256_mul_ps(axis[1], axis[1])),
+                                                    _mm256_mul_ps(axis[2], axis[2])));
+
+        Basis8 b;
+        b.y[0] = _mm256_sub_ps(_mm256_set1_ps(target.x), pos[0]);
+        b.y[1] = _mm256_sub_ps(_mm256_set1_ps(target.y), pos[1]);
+        b.y[2] = _mm256_sub_ps(_mm256_set1_ps(target.z), pos[2]);
+        Normalize8(b.y);
+
+        __m256 zero = _mm256_setzero_ps();
+        __m256 abs_y = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), b.y[1]);
+        __m256 vertical = _mm256_cmp_ps(abs_y, _mm256_set1_ps(VERTICAL_LIMIT), _CMP_GT_OQ);
+        __m256 level[3] = {b.y[2], zero, _mm256_sub_ps(zero, b.y[0])};
+        __m256 steep[3] = {_mm256_sub_ps(zero, b.y[1]), b.y[0], zero};
+        for (int c = 0; c < 3; c++) {
+            b.x[c] = _mm256_blendv_ps(level[c], steep[c], vertical);
+        }
+        Normalize8(b.x);
+
+        b.z[0] = _mm256_sub_ps(_mm256_mul_ps(b.x[1], b.y[2]), _mm256_mul_ps(b.x[2], b.y[1]));
+        b.z[1] = _mm256_sub_ps(_mm256_mul_ps(b.x[2], b.y[0]), _mm256_mul_ps(b.x[0], b.y[2]));
+        b.z[2] = _mm256_sub_ps(_mm256_mul_ps(b.x[0], b.y[1]), _mm256_mul_ps(b.x[1], b.y[0]));
+
+        for (int r = 0; r < 3; r++) {
+            __m256 x = _mm256_mul_ps(b.x[r], scale);
+            __m256 y = _mm256_mul_ps(b.y[r], scale);
+            __m256 z = _mm256_mul_ps(b.z[r], scale);
+            for (int half = 0; half < 2; half++) {
+                __m128 a = half ? _mm256_extractf128_ps(x, 1) : _mm256_castps256_ps128(x);
+                __m128 c = half ? _mm256_extractf128_ps(y, 1) : _mm256_castps256_ps128(y);
+                __m128 d = half ? _mm256_extractf128_ps(z, 1) : _mm256_castps256_ps128(z);
+                __m128 e = half ? _mm256_extractf128_ps(pos[r], 1) : _mm256_castps256_ps128(pos[r]);
+                _MM_TRANSPOSE4_PS(a, c, d, e);
+                float *row0 = &m[4 * half].m0 + 4 * r;
+                _mm_storeu_ps(row0, a);
+                _mm_storeu_ps(row0 + 16, c);
+                _mm_storeu_ps(row0 + 32, d);
+                _mm_storeu_ps(row0 + 48, e);
+            }
+        }
+
+        __m128 last = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+        for (int k = 0; k < 8; k++) {
+            _mm_storeu_ps(&m[k].m3, last);
+        }
+    }
+    BillboardSSE2(transforms + i, count - i, target);
+}
+#endif
+
+static const BillboardFn kernels[BILLBOARD_KERNEL_COUNT] = {
+    [BILLBOARD_SCALAR] = BillboardScalar,
+#ifdef BILLBOARD_X86
+    [BILLBOARD_SSE2] = BillboardSSE2,
+    [BILLBOARD_AVX] = BillboardAVX,
+#endif
+};
+
+// Only the render thread billboards, so no need for atomics here
+static int active_kernel = -1;
+
+static bool KernelSupported(BillboardKernel kernel) {
+    switch (kernel) {
+        case BILLBOARD_SCALAR: return true;
+#ifdef BILLBOARD_X86
+        case BILLBOARD_SSE2: return __builtin_cpu_supports("sse2");
+        case BILLBOARD_AVX: return __builtin_cpu_supports("avx");
+#endif
+        default: return false;
+    }
+}
+
+BillboardKernel BillboardBestKernel(void) {
+    for (int k = BILLBOARD_KERNEL_COUNT - 1; k > BILLBOARD_SCALAR; k--) {
+        if (KernelSupported(k)) return k;
+    }
+    return BILLBOARD_SCALAR;
+}
+
+bool BillboardSetKernel(BillboardKernel kernel) {
+    if (kernel >= BILLBOARD_KERNEL_COUNT || !KernelSupported(kernel)) return false;
+    active_kernel = kernel;
+    return true;
+}
+
+const char *BillboardKernelName(BillboardKernel kernel) {
+    switch (kernel) {
+        case BILLBOARD_SCALAR: return "scalar";
+        case BILLBOARD_SSE2: return "sse2";
+        case BILLBOARD_AVX: return "avx";
+        default: return "unknown";
+    }
+}
+
+void BillboardTransforms(Matrix *transforms, int count, Vector3 target) {
+    if (active_kernel < 0) {
+        active_kernel = BillboardBestKernel();
+    }
+    kernels[active_kernel](transforms, count, target);
+}
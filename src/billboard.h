@@ -0,0 +1,28 @@
+#ifndef BILLBOARD_H
+#define BILLBOARD_H
+
+#include "raylib.h"
+
+#include <stdbool.h>
+
+typedef enum {
+    BILLBOARD_SCALAR,
+    BILLBOARD_SSE2, // 4 windows at a time
+    BILLBOARD_AVX,  // 8 windows at a time
+    BILLBOARD_KERNEL_COUNT,
+} BillboardKernel;
+
+// Turn a window's +Y towards target, keeping its position and scale. Its
+// local X stays level unless target is almost straight above or below.
+Matrix LookAtTarget(Matrix transform, Vector3 target);
+
+// LookAtTarget for a whole array of transforms, in place
+void BillboardTransforms(Matrix *transforms, int count, Vector3 target);
+
+// The fastest kernel the CPU supports is picked on first use. These exist
+// so the benchmark can compare kernels against each other.
+BillboardKernel BillboardBestKernel(void);
+bool BillboardSetKernel(BillboardKernel kernel);
+const char *BillboardKernelName(BillboardKernel kernel);
+
+#endif // BILLBOARD_H
@@ -0,0 +1,414 @@
+#include "capture.h"
+
+#include <pthread.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// X errors are delivered to one process-wide handler, on the thread that
+// reads the reply. Captured windows can vanish or unmap at any time, so each
+// capture thread traps errors around requests that may fail instead of
+// letting the default handler exit.
+static pthread_once_t error_handler_once = PTHREAD_ONCE_INIT;
+static XErrorHandler previous_error_handler = NULL;
+static _Thread_local bool error_trapped = false;
+static _Thread_local unsigned char trapped_error = Success;
+
+static int CaptureErrorHandler(Display *display, XErrorEvent *event) {
+    if (error_trapped) {
+        trapped_error = event->error_code;
+        return 0;
+    }
+    return previous_error_handler != NULL ? previous_error_handler(display, event) : 0;
+}
+
+static void InstallErrorHandler(void) {
+    previous_error_handler = XSetErrorHandler(CaptureErrorHandler);
+}
+
+// Errors arrive in request order, so a trap that ends with a request that
+// has a reply has seen every error before it without an extra XSync
+void CaptureTrapErrors(void) {
+    pthread_once(&error_handler_once, InstallErrorHandler);
+    error_trapped = true;
+    trapped_error = Success;
+}
+
+bool CaptureUntrapErrors(void) {
+    error_trapped = false;
+    return trapped_error == Success;
+}
+
+// Attach a segment and wait for the server to process it. XShmAttach itself
+// always succeeds locally; a remote or sandboxed server only reports the
+// failure asynchronously, so trap the error around a round trip.
+static bool AttachSegment(Display *display, XShmSegmentInfo *info) {
+    CaptureTrapErrors();
+    Status status = XShmAttach(display, info);
+    XSync(display, False);
+    return CaptureUntrapErrors() && status;
+}
+
+static bool ProbeShm(Display *display) {
+    if (!XShmQueryExtension(display)) return false;
+
+    XShmSegmentInfo info = {0};
+    info.shmid = shmget(IPC_PRIVATE, 4096, IPC_CREAT | 0600);
+    if (info.shmid < 0) return false;
+
+    info.shmaddr = shmat(info.shmid, NULL, 0);
+    if (info.shmaddr == (char *)-1) {
+        shmctl(info.shmid, IPC_RMID, NULL);
+        return false;
+    }
+    info.readOnly = False;
+
+    bool attached = AttachSegment(display, &info);
+    if (attached) {
+        XShmDetach(display, &info);
+        XSync(display, False);
+    }
+
+    shmdt(info.shmaddr);
+    shmctl(info.shmid, IPC_RMID, NULL);
+    return attached;
+}
+
+static bool ProbeComposite(Display *display) {
+    int event_base, error_base;
+    if (!XCompositeQueryExtension(display, &event_base, &error_base)) return false;
+
+    // NameWindowPixmap arrived in 0.2
+    int major = 0, minor = 2;
+    XCompositeQueryVersion(display, &major, &minor);
+    return major > 0 || minor >= 2;
+}
+
+void CaptureInit(CaptureContext *ctx, Display *display, CompositeMode composite) {
+    memset(ctx, 0, sizeof(CaptureContext));
+    ctx->display = display;
+    ctx->use_shm = ProbeShm(display);
+    if (!ctx->use_shm) {
+        fprintf(stderr, "MIT-SHM unavailable, falling back to XGetImage\n");
+    }
+
+    int error_base;
+    int major = 1, minor = 1;
+    if (XDamageQueryExtension(display, &ctx->damage_event_base, &error_base) &&
+        XDamageQueryVersion(display, &major, &minor) &&
+        XFixesQueryExtension(display, &error_base, &error_base)) {
+        XFixesQueryVersion(display, &major, &minor);
+        ctx->damage_parts = XFixesCreateRegion(display, NULL, 0);
+        ctx->use_damage = true;
+    }
+    else {
+        fprintf(stderr, "XDamage unavailable, capturing every frame\n");
+    }
+
+    ctx->composite = composite;
+    if (composite != COMPOSITE_OFF && !ProbeComposite(display)) {
+        fprintf(stderr, "Composite unavailable, windows must stay on screen to be captured\n");
+        ctx->composite = COMPOSITE_OFF;
+    }
+}
+
+bool CaptureTrack(CaptureContext *ctx, CaptureBuffer *buf, Window window) {
+    CaptureTrapErrors();
+
+    // Map and configure tell us when a redirected window's pixmap changes
+    XSelectInput(ctx->display, window, StructureNotifyMask);
+
+    if (ctx->composite != COMPOSITE_OFF) {
+        // Automatic redirection keeps the window on screen as before, and
+        // unlike manual redirection works alongside a compositing manager
+        XCompositeRedirectWindow(ctx->display, window, CompositeRedirectAutomatic);
+        buf->pixmap_stale = true;
+    }
+
+    if (ctx->use_damage) {
+        // NonEmpty only notifies on the empty -> damaged transition, so an
+        // idle window sends nothing and a busy one at most one event per frame
+        buf->damage = XDamageCreate(ctx->display, window, XDamageReportNonEmpty);
+    }
+    buf->damaged = true;
+
+    // Has a reply, so this doubles as the sync for the requests above
+    Status status = XGetWindowAttributes(ctx->display, window, &buf->attr);
+    if (!CaptureUntrapErrors() || status == 0) {
+        buf->attr.map_state = IsUnmapped;
+        return false;
+    }
+    buf->width = buf->attr.width;
+    buf->height = buf->attr.height;
+    return true;
+}
+
+Window CaptureEventWindow(CaptureContext *ctx, const XEvent *event) {
+    if (ctx->use_damage && event->type == ctx->damage_event_base + XDamageNotify) {
+        return ((const XDamageNotifyEvent *)event)->drawable;
+    }
+
+    switch (event->type) {
+        case MapNotify: return event->xmap.window;
+        case UnmapNotify: return event->xunmap.window;
+        case DestroyNotify: return event->xdestroywindow.window;
+        case ConfigureNotify: return event->xconfigure.window;
+        default: return None;
+    }
+}
+
+void CaptureHandleEvent(CaptureContext *ctx, CaptureBuffer *buf, const XEvent *event) {
+    (void)ctx;
+    if (event->type == UnmapNotify || event->type == DestroyNotify) {
+        // Nothing to capture until it's mapped again
+        buf->attr.map_state = IsUnmapped;
+        return;
+    }
+
+    // A map or resize gives the window new backing storage, which also
+    // reads as a full damage. A plain move doesn't.
+    if (event->type == ConfigureNotify) {
+        const XConfigureEvent *configure = &event->xconfigure;
+        buf->attr.x = configure->x;
+        buf->attr.y = configure->y;
+        buf->attr.width = configure->width;
+        buf->attr.height = configure->height;
+        buf->attr.border_width = configure->border_width;
+        if (configure->width == buf->width && configure->height == buf->height) return;
+        buf->width = configure->width;
+        buf->height = configure->height;
+        buf->pixmap_stale = true;
+    }
+    else if (event->type == MapNotify) {
+        buf->attr.map_state = IsViewable;
+        buf->pixmap_stale = true;
+    }
+    buf->damaged = true;
+}
+
+int CaptureTakeDamage(CaptureContext *ctx, CaptureBuffer *buf, const XWindowAttributes *attr, XRectangle rects[CAPTURE_MAX_RECTS]) {
+    buf->damaged = !ctx->use_damage; // without damage every frame is dirty
+    if (!ctx->use_damage) return CAPTURE_FULL;
+
+    // Subtract before capturing so that anything drawn after this point
+    // raises a fresh notify instead of being lost
+    CaptureTrapErrors();
+    XDamageSubtract(ctx->display, buf->damage, None, ctx->damage_parts);
+
+    int count = 0;
+    XRectangle *parts = XFixesFetchRegion(ctx->display, ctx->damage_parts, &count);
+    if (!CaptureUntrapErrors() || parts == NULL) {
+        if (parts != NULL) XFree(parts);
+        return CAPTURE_FULL;
+    }
+
+    int n = CaptureClipDamage(attr, parts, count, rects);
+    XFree(parts);
+    return n;
+}
+
+int CaptureClipDamage(const XWindowAttributes *attr, const XRectangle *parts, int count, XRectangle rects[CAPTURE_MAX_RECTS]) {
+    long window_area = (long)attr->width * attr->height;
+    long damaged_area = 0;
+    int n = 0;
+    for (int i = 0; i < count && n < CAPTURE_MAX_RECTS; i++) {
+        // Clip to the window, damage can extend past a shrinking window
+        int x0 = parts[i].x < 0 ? 0 : parts[i].x;
+        int y0 = parts[i].y < 0 ? 0 : parts[i].y;
+        int x1 = parts[i].x + parts[i].width;
+        int y1 = parts[i].y + parts[i].height;
+        if (x1 > attr->width) x1 = attr->width;
+        if (y1 > attr->height) y1 = attr->height;
+        if (x1 <= x0 || y1 <= y0) continue;
+
+        rects[n++] = (XRectangle){x0, y0, x1 - x0, y1 - y0};
+        damaged_area += (long)(x1 - x0) * (y1 - y0);
+    }
+    bool overflow = count > CAPTURE_MAX_RECTS;
+
+    if (overflow || damaged_area * 2 > window_area) return CAPTURE_FULL;
+    return n;
+}
+
+static bool CreateShmImage(Display *display, CaptureBuffer *buf, const XWindowAttributes *attr) {
+    XImage *image = XShmCreateImage(display, attr->visual, attr->depth, ZPixmap, NULL,
+                                    &buf->shminfo, attr->width, attr->height);
+    if (image == NULL) return false;
+
+    buf->shminfo.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+    if (buf->shminfo.shmid < 0) {
+        XDestroyImage(image);
+        return false;
+    }
+
+    buf->shminfo.shmaddr = image->data = shmat(buf->shminfo.shmid, NULL, 0);
+    if (buf->shminfo.shmaddr == (char *)-1) {
+        shmctl(buf->shminfo.shmid, IPC_RMID, NULL);
+        image->data = NULL;
+        XDestroyImage(image);
+        return false;
+    }
+    buf->shminfo.readOnly = False;
+
+    bool attached = AttachSegment(display, &buf->shminfo);
+
+    // The server holds its own attachment now, so the segment can be marked
+    // for removal and will go away with the last detach (or our exit).
+    shmctl(buf->shminfo.shmid, IPC_RMID, NULL);
+    if (!attached) {
+        shmdt(buf->shminfo.shmaddr);
+        image->data = NULL;
+        XDestroyImage(image);
+        return false;
+    }
+
+    buf->image = image;
+    buf->shm = true;
+    return true;
+}
+
+static void FreeShmImage(Display *display, CaptureBuffer *buf) {
+    XShmDetach(display, &buf->shminfo);
+    XDestroyImage(buf->image); // XShm images only free the header, not the data
+    shmdt(buf->shminfo.shmaddr);
+    buf->image = NULL;
+    buf->shm = false;
+}
+
+// Name the window's pixmap if it changed since we last did. Must be called
+// with errors trapped: an unmapped window has no pixmap.
+static Pixmap RefreshPixmap(CaptureContext *ctx, CaptureBuffer *buf, Window window) {
+    if (buf->pixmap_stale && buf->pixmap != None) {
+        XFreePixmap(ctx->display, buf->pixmap);
+        buf->pixmap = None;
+    }
+    if (buf->pixmap == None) {
+        buf->pixmap = XCompositeNameWindowPixmap(ctx->display, window);
+        buf->pixmap_stale = false;
+    }
+    return buf->pixmap;
+}
+
+// Where to read pixels from: the offscreen pixmap of a redirected window
+Drawable CaptureDrawable(CaptureContext *ctx, CaptureBuffer *buf, Window window) {
+    if (ctx->composite == COMPOSITE_OFF) return window;
+    return RefreshPixmap(ctx, buf, window);
+}
+
+// Naming the pixmap has no reply, so its error (if any) shows up with the
+// image request that follows, indistinguishable from the read failing on a
+// pixmap that's fine (say, a rect out of bounds after a resize). Free it
+// either way; if it was never created, that error is trapped too.
+void CaptureFailed(CaptureContext *ctx, CaptureBuffer *buf) {
+    if (buf->pixmap != None) {
+        CaptureTrapErrors();
+        XFreePixmap(ctx->display, buf->pixmap);
+        XSync(ctx->display, False);
+        CaptureUntrapErrors();
+    }
+    buf->pixmap = None;
+    buf->pixmap_stale = false;
+}
+
+bool CaptureReserveShm(CaptureContext *ctx, CaptureBuffer *buf, Window window, const XWindowAttributes *attr) {
+    if (buf->shm && (buf->image->width != attr->width || buf->image->height != attr->height)) {
+        FreeShmImage(ctx->display, buf);
+    }
+
+    if (!buf->shm && ctx->use_shm && !CreateShmImage(ctx->display, buf, attr)) {
+        // Most likely out of shared memory (shmmax/shmall); don't retry every frame
+        fprintf(stderr, "Unable to create shared image for window 0x%lx, falling back to XGetImage\n", window);
+        ctx->use_shm = false;
+    }
+    return buf->shm;
+}
+
+XImage *CaptureWindow(CaptureContext *ctx, CaptureBuffer *buf, Window window, const XWindowAttributes *attr) {
+    CaptureReserveShm(ctx, buf, window, attr);
+
+    CaptureTrapErrors();
+    Drawable source = CaptureDrawable(ctx, buf, window);
+
+    XImage *image = NULL;
+    if (buf->shm) {
+        if (XShmGetImage(ctx->display, source, buf->image, 0, 0, AllPlanes)) {
+            image = buf->image;
+        }
+    }
+    else {
+        image = XGetImage(ctx->display, source, 0, 0, attr->width, attr->height, AllPlanes, ZPixmap);
+    }
+
+    if (!CaptureUntrapErrors() || image == NULL) {
+        if (image != NULL) CaptureRelease(buf, image);
+        CaptureFailed(ctx, buf);
+        return NULL;
+    }
+    return image;
+}
+
+XImage *CaptureWindowRect(CaptureContext *ctx, CaptureBuffer *buf, Window window, const XWindowAttributes *attr, XRectangle rect) {
+    CaptureTrapErrors();
+    Drawable source = CaptureDrawable(ctx, buf, window);
+
+    XImage *image = NULL;
+    if (buf->shm) {
+        // A header-only image over the start of the window's segment; the
+        // rect is never larger than the window so it always fits
+        image = XShmCreateImage(ctx->display, attr->visual, attr->depth, ZPixmap,
+                                buf->shminfo.shmaddr, &buf->shminfo, rect.width, rect.height);
+        if (image != NULL && !XShmGetImage(ctx->display, source, image, rect.x, rect.y, AllPlanes)) {
+            XDestroyImage(image);
+            image = NULL;
+        }
+    }
+    else {
+        image = XGetImage(ctx->display, source, rect.x, rect.y, rect.width, rect.height, AllPlanes, ZPixmap);
+    }
+
+    if (!CaptureUntrapErrors() || image == NULL) {
+        if (image != NULL) CaptureRelease(buf, image);
+        CaptureFailed(ctx, buf);
+        return NULL;
+    }
+    return image;
+}
+
+void CaptureRelease(CaptureBuffer *buf, XImage *image) {
+    // The full-size shared image is reused by the next capture
+    if (image == NULL || (buf->shm && image == buf->image)) return;
+    XDestroyImage(image);
+}
+
+Pixmap CaptureWindowPixmap(CaptureContext *ctx, CaptureBuffer *buf, Window window) {
+    if (ctx->composite == COMPOSITE_OFF) return None;
+    if (buf->pixmap != None && !buf->pixmap_stale) return buf->pixmap;
+
+    CaptureTrapErrors();
+    Pixmap pixmap = RefreshPixmap(ctx, buf, window);
+    XSync(ctx->display, False);
+    if (!CaptureUntrapErrors()) {
+        CaptureFailed(ctx, buf);
+        return None;
+    }
+    return pixmap;
+}
+
+void CaptureFree(CaptureContext *ctx, CaptureBuffer *buf) {
+    CaptureTrapErrors();
+    if (buf->damage != None) {
+        XDamageDestroy(ctx->display, buf->damage);
+        buf->damage = None;
+    }
+    if (buf->pixmap != None) {
+        XFreePixmap(ctx->display, buf->pixmap);
+        buf->pixmap = None;
+    }
+    if (buf->shm) {
+        FreeShmImage(ctx->display, buf);
+    }
+    XSync(ctx->display, False);
+    CaptureUntrapErrors();
+}
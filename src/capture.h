@@ -0,0 +1,107 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+
+#include <stdbool.h>
+
+typedef enum {
+    COMPOSITE_OFF,    // read straight from the window, so it has to be on screen
+    COMPOSITE_COPY,   // redirect the window and read back its offscreen pixmap
+    COMPOSITE_PIXMAP, // redirect and hand the pixmap to the renderer to bind as a texture
+} CompositeMode;
+
+// Per-display capture state, filled in once by CaptureInit
+typedef struct {
+    Display *display;
+    bool use_shm; // MIT-SHM is present and the server can attach our segments
+
+    bool use_damage;
+    int damage_event_base;
+    XserverRegion damage_parts; // scratch region XDamageSubtract moves damage into
+
+    CompositeMode composite;
+} CaptureContext;
+
+// Per-window capture target. With MIT-SHM the XImage and its shared segment
+// are kept between frames and only reallocated when the window is resized.
+typedef struct {
+    XImage *image;
+    XShmSegmentInfo shminfo;
+    bool shm;
+
+    Damage damage;
+    bool damaged; // contents changed since the last CaptureTakeDamage
+
+    // Offscreen storage of a redirected window. The server swaps it out when
+    // the window is mapped or resized, so it is renamed after either.
+    Pixmap pixmap;
+    bool pixmap_stale;
+    int width; // size from the last ConfigureNotify
+    int height;
+
+    // Fetched once by CaptureTrack and kept current from the window's
+    // events, so capturing never has to ask the server
+    XWindowAttributes attr;
+} CaptureBuffer;
+
+// Damage is reported as a handful of rectangles; past this a single full
+// capture costs less than the extra requests and texture uploads.
+#define CAPTURE_MAX_RECTS 16
+#define CAPTURE_FULL -1
+
+// Falls back to COMPOSITE_OFF when the server has no Composite extension
+void CaptureInit(CaptureContext *ctx, Display *display, CompositeMode composite);
+
+// Start tracking a window: redirect it, follow its damage and its map and
+// configure events, and cache its attributes. It starts out fully damaged.
+// Returns false if the window is already gone.
+bool CaptureTrack(CaptureContext *ctx, CaptureBuffer *buf, Window window);
+
+// Update buf for an event on its window. Returns the window the event was
+// about, None if it isn't one capture cares about.
+Window CaptureEventWindow(CaptureContext *ctx, const XEvent *event);
+void CaptureHandleEvent(CaptureContext *ctx, CaptureBuffer *buf, const XEvent *event);
+
+// Reset the window's damage and return the rectangles that need recapturing,
+// or CAPTURE_FULL when the whole window should be captured.
+int CaptureTakeDamage(CaptureContext *ctx, CaptureBuffer *buf, const XWindowAttributes *attr, XRectangle rects[CAPTURE_MAX_RECTS]);
+
+// Clip damage to the window and decide between rects and CAPTURE_FULL, as
+// CaptureTakeDamage does with the region it fetched
+int CaptureClipDamage(const XWindowAttributes *attr, const XRectangle *parts, int count, XRectangle rects[CAPTURE_MAX_RECTS]);
+
+// Capture the window contents (or a rectangle of them) as the server's BGRA.
+// Convert while copying the pixels out, see SwizzleBGRAToRGBA. The returned
+// image must be handed back with CaptureRelease once the pixels are consumed.
+// Returns NULL when the window can't be read, e.g. it's unmapped or gone.
+XImage *CaptureWindow(CaptureContext *ctx, CaptureBuffer *buf, Window window, const XWindowAttributes *attr);
+XImage *CaptureWindowRect(CaptureContext *ctx, CaptureBuffer *buf, Window window, const XWindowAttributes *attr, XRectangle rect);
+void CaptureRelease(CaptureBuffer *buf, XImage *image);
+
+// The pieces of CaptureWindow, for reading windows some other way than
+// through Xlib. CaptureReserveShm makes sure the buffer has a shared segment
+// the size of the window, if MIT-SHM works at all; it traps errors itself, so
+// call it outside any other trap. CaptureDrawable names what to read from,
+// and CaptureFailed drops it again if reading fails; it traps errors too.
+bool CaptureReserveShm(CaptureContext *ctx, CaptureBuffer *buf, Window window, const XWindowAttributes *attr);
+Drawable CaptureDrawable(CaptureContext *ctx, CaptureBuffer *buf, Window window);
+void CaptureFailed(CaptureContext *ctx, CaptureBuffer *buf);
+
+// The redirected window's current pixmap, None if it has none (unmapped)
+Pixmap CaptureWindowPixmap(CaptureContext *ctx, CaptureBuffer *buf, Window window);
+
+void CaptureFree(CaptureContext *ctx, CaptureBuffer *buf);
+
+// Swallow X errors raised on this thread until CaptureUntrapErrors, which
+// returns false if there were any. Only errors for requests whose reply (or
+// an XSync) came back before the untrap are caught.
+void CaptureTrapErrors(void);
+bool CaptureUntrapErrors(void);
+
+#endif // CAPTURE_H
@@ -0,0 +1,708 @@
+#include "capture_worker.h"
+#include "capture_xcb.h"
+#include "profile.h"
+#include "swizzle.h"
+#include "tiles.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Set on CaptureSource.middle while the frame there hasn't been picked up
+#define FRAME_FRESH 4
+// How long an expedited window is captured as soon as it draws
+#define EXPEDITE_SECONDS 0.25
+
+typedef struct CaptureWorker CaptureWorker;
+
+struct CaptureSource {
+    Window window;
+    CaptureWorker *worker;
+    CaptureSource *next;
+
+    // Shared between the worker and the render thread
+    _Atomic float rate_hz;
+    atomic_int lod_wanted;
+    atomic_bool force_full;
+    atomic_bool copies_only;
+    atomic_bool removed;
+    atomic_bool expedite;
+    atomic_int middle;
+
+    // Render thread only
+    int front;
+
+    // Worker only
+    CaptureBuffer buffer;
+    CaptureFrame frames[3];
+    int back;
+    bool published;
+    int width;
+    int height;
+    int lod;        // level the last frame was captured at
+    int lod_served; // lod_wanted at the time, which may have been clamped
+    int lod_planned; // lod_wanted for the frame being captured
+    bool dedup;      // the planned full frame is only full because of its damage
+    TileHashes tiles;
+    double next_capture;
+    double expedite_until;
+};
+
+struct CaptureWorker {
+    CaptureContext ctx;
+    pthread_t thread;
+    int wake[2];
+    atomic_bool stop;
+    atomic_int source_count;
+    _Atomic(CaptureSource *) incoming; // added but not yet adopted by the worker
+    CaptureSource *sources;
+    void (*notify)(void *data);
+    void *notify_data;
+    CaptureFrame scratch; // pixels to swap with a frame that was cut down
+
+    // XCB backend: the copies due this pass
+    bool use_xcb;
+    CaptureXcb xcb;
+    CaptureRequest batch[CAPTURE_BATCH_MAX];
+    CaptureSource *batch_sources[CAPTURE_BATCH_MAX];
+    int batch_count;
+};
+
+struct CaptureSystem {
+    CaptureWorker workers[CAPTURE_MAX_WORKERS];
+    int worker_count;
+};
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void Wake(CaptureWorker *worker) {
+    // The pipe is non-blocking; if it's full the worker is awake anyway
+    ssize_t n = write(worker->wake[1], "", 1);
+    (void)n;
+}
+
+static bool ReserveFrame(CaptureFrame *frame, size_t size) {
+    if (size <= frame->capacity) return true;
+
+    unsigned char *pixels = realloc(frame->pixels, size);
+    if (pixels == NULL) {
+        fprintf(stderr, "Failed to allocate memory for capture frame\n");
+        return false;
+    }
+    frame->pixels = pixels;
+    frame->capacity = size;
+    return true;
+}
+
+// Convert straight from the server's image into the frame, so the pixels are
+// only touched once on their way out of the shared segment
+static unsigned char *CopyRows(unsigned char *dst, const unsigned char *src, size_t stride, int width, int height, int lod) {
+    size_t row = (size_t)(width >> lod) * 4;
+    PROFILE_BEGIN(PROFILE_SWIZZLE);
+    SwizzleDownsampleBGRAToRGBA(dst, row, src, stride, width, height, lod);
+    PROFILE_END(PROFILE_SWIZZLE);
+    PROFILE_COUNT(PROFILE_BYTES_CAPTURED, row * (height >> lod));
+    return dst + row * (height >> lod);
+}
+
+static unsigned char *CopyImageRows(unsigned char *dst, const XImage *image, int lod) {
+    return CopyRows(dst, (const unsigned char *)image->data, image->bytes_per_line, image->width, image->height, lod);
+}
+
+// Grow a rect out to whole 2^lod blocks, dropping the edge pixels that don't
+// make up a full block. False if nothing is left.
+static bool AlignRect(XRectangle *rect, int lod, const XWindowAttributes *attr) {
+    int mask = (1 << lod) - 1;
+    int x0 = rect->x & ~mask;
+    int y0 = rect->y & ~mask;
+    int x1 = (rect->x + rect->width + mask) & ~mask;
+    int y1 = (rect->y + rect->height + mask) & ~mask;
+    if (x1 > (attr->width & ~mask)) x1 = attr->width & ~mask;
+    if (y1 > (attr->height & ~mask)) y1 = attr->height & ~mask;
+    if (x1 <= x0 || y1 <= y0) return false;
+
+    *rect = (XRectangle){x0, y0, x1 - x0, y1 - y0};
+    return true;
+}
+
+// Append the rects of a frame the render thread hasn't picked up yet, since
+// publishing over it drops it
+static int MergeRects(XRectangle *rects, int count, const CaptureFrame *unread, int lod) {
+    if (count == CAPTURE_FULL || unread->rect_count == CAPTURE_FULL) return CAPTURE_FULL;
+    if (unread->lod != lod) return CAPTURE_FULL;
+    if (count + unread->rect_count > CAPTURE_MAX_RECTS) return CAPTURE_FULL;
+
+    memcpy(rects + count, unread->rects, unread->rect_count * sizeof(XRectangle));
+    return count + unread->rect_count;
+}
+
+static void Publish(CaptureSource *src, const XWindowAttributes *attr) {
+    int old = atomic_exchange_explicit(&src->middle, src->back | FRAME_FRESH, memory_order_acq_rel);
+    src->back = old & ~FRAME_FRESH;
+    src->published = true;
+    src->width = attr->width;
+    src->height = attr->height;
+
+    CaptureWorker *worker = src->worker;
+    if (worker->notify != NULL) worker->notify(worker->notify_data);
+}
+
+// Fetching damage is a round trip too, so it counts as capture time
+static int TakeDamage(CaptureContext *ctx, CaptureBuffer *buf, const XWindowAttributes *attr, XRectangle rects[]) {
+    PROFILE_BEGIN(PROFILE_CAPTURE);
+    int count = CaptureTakeDamage(ctx, buf, attr, rects);
+    PROFILE_END(PROFILE_CAPTURE);
+    return count;
+}
+
+// The renderer binds the pixmap itself, so all there is to send is that it
+// changed (and which one it is now)
+static void CaptureSourcePixmap(CaptureWorker *worker, CaptureSource *src, const XWindowAttributes *attr) {
+    XRectangle rects[CAPTURE_MAX_RECTS];
+    TakeDamage(&worker->ctx, &src->buffer, attr, rects);
+    atomic_store(&src->force_full, false);
+
+    PROFILE_BEGIN(PROFILE_CAPTURE);
+    Pixmap pixmap = CaptureWindowPixmap(&worker->ctx, &src->buffer, src->window);
+    PROFILE_END(PROFILE_CAPTURE);
+    if (pixmap == None) return;
+
+    CaptureFrame *frame = &src->frames[src->back];
+    frame->width = attr->width;
+    frame->height = attr->height;
+    frame->pixmap = pixmap;
+    frame->depth = attr->depth;
+    frame->lod = 0;
+    frame->rect_count = CAPTURE_FULL;
+    Publish(src, attr);
+}
+
+static bool SendsPixmaps(const CaptureWorker *worker, CaptureSource *src) {
+    return worker->ctx.composite == COMPOSITE_PIXMAP && !atomic_load(&src->copies_only);
+}
+
+// Settle what the next frame of a damaged window holds: the level to capture
+// at (through lod) and the rects, or CAPTURE_FULL. 0 if there is nothing to
+// capture or no room for it.
+static int PlanFrame(CaptureSource *src, const XWindowAttributes *attr, XRectangle rects[], int rect_count, int *lod) {
+    // Never scale a window below one pixel
+    src->lod_planned = atomic_load(&src->lod_wanted);
+    *lod = src->lod_planned;
+    while (*lod > 0 && ((attr->width >> *lod) == 0 || (attr->height >> *lod) == 0)) (*lod)--;
+
+    bool full = atomic_exchange(&src->force_full, false) || !src->published ||
+                attr->width != src->width || attr->height != src->height || *lod != src->lod;
+    src->dedup = rect_count == CAPTURE_FULL && !full;
+    if (full) rect_count = CAPTURE_FULL;
+
+    int middle = atomic_load(&src->middle);
+    if (middle & FRAME_FRESH) {
+        // The unread frame's contents have to go out with this one
+        src->dedup = false;
+        rect_count = MergeRects(rects, rect_count, &src->frames[middle & ~FRAME_FRESH], *lod);
+    }
+    if (rect_count != CAPTURE_FULL && *lod > 0) {
+        int kept = 0;
+        for (int i = 0; i < rect_count; i++) {
+            if (AlignRect(&rects[i], *lod, attr)) rects[kept++] = rects[i];
+        }
+        rect_count = kept;
+    }
+    if (rect_count == 0) return 0;
+
+    size_t size = 0;
+    if (rect_count == CAPTURE_FULL) {
+        size = (size_t)(attr->width >> *lod) * (attr->height >> *lod) * 4;
+    }
+    else {
+        for (int i = 0; i < rect_count; i++) {
+            size += (size_t)(rects[i].width >> *lod) * (rects[i].height >> *lod) * 4;
+        }
+    }
+    if (!ReserveFrame(&src->frames[src->back], size)) return 0;
+    return rect_count;
+}
+
+// Cut a full frame down to the tiles that changed since the last one, unless
+// it has to go out whole. Returns the rects in window coordinates,
+// CAPTURE_FULL to send all of it or 0 if nothing changed at all.
+static int DedupFrame(CaptureSource *src, const XWindowAttributes *attr, int lod, XRectangle rects[]) {
+    CaptureFrame *frame = &src->frames[src->back];
+    int width = attr->width >> lod;
+    int height = attr->height >> lod;
+    // Always hashed, so the next frame has something to compare against
+    int count = TileHashesDiff(&src->tiles, frame->pixels, width, height, rects, CAPTURE_MAX_RECTS);
+    if (count < 0 || !src->dedup) return CAPTURE_FULL;
+    if (count == 0) return 0;
+
+    size_t size = 0;
+    for (int i = 0; i < count; i++) {
+        size += (size_t)rects[i].width * rects[i].height * 4;
+    }
+    CaptureWorker *worker = src->worker;
+    if (!ReserveFrame(&worker->scratch, size)) return CAPTURE_FULL;
+
+    // Pack the tiles' rows back to back as a rect frame holds them, then
+    // trade buffers so the frame has them
+    size_t stride = (size_t)width * 4;
+    unsigned char *dst = worker->scratch.pixels;
+    for (int i = 0; i < count; i++) {
+        XRectangle rect = rects[i];
+        size_t row = (size_t)rect.width * 4;
+        for (int y = 0; y < rect.height; y++) {
+            memcpy(dst, frame->pixels + (rect.y + y) * stride + (size_t)rect.x * 4, row);
+            dst += row;
+        }
+        rects[i] = (XRectangle){rect.x << lod, rect.y << lod, rect.width << lod, rect.height << lod};
+    }
+    unsigned char *pixels = frame->pixels;
+    size_t capacity = frame->capacity;
+    frame->pixels = worker->scratch.pixels;
+    frame->capacity = worker->scratch.capacity;
+    worker->scratch.pixels = pixels;
+    worker->scratch.capacity = capacity;
+    return count;
+}
+
+// Once the pixels are in the back frame
+static void FinishFrame(CaptureSource *src, const XWindowAttributes *attr, const XRectangle *rects, int rect_count, int lod) {
+    CaptureFrame *frame = &src->frames[src->back];
+    XRectangle changed[CAPTURE_MAX_RECTS];
+    if (rect_count == CAPTURE_FULL) {
+        rect_count = DedupFrame(src, attr, lod, changed);
+        rects = changed;
+        if (rect_count == 0) {
+            src->lod_served = src->lod_planned;
+            return;
+        }
+    }
+    else {
+        TileHashesForget(&src->tiles, rects, rect_count, lod);
+    }
+    if (rect_count != CAPTURE_FULL) {
+        memcpy(frame->rects, rects, rect_count * sizeof(XRectangle));
+    }
+    frame->width = attr->width;
+    frame->height = attr->height;
+    frame->pixmap = None;
+    frame->depth = attr->depth;
+    frame->lod = lod;
+    frame->rect_count = rect_count;
+    src->lod = lod;
+    src->lod_served = src->lod_planned;
+    Publish(src, attr);
+}
+
+static void CaptureSourceFrame(CaptureWorker *worker, CaptureSource *src) {
+    CaptureContext *ctx = &worker->ctx;
+
+    const XWindowAttributes *attr = &src->buffer.attr;
+    if (attr->map_state == IsUnmapped) {
+        src->buffer.damaged = false;
+        return;
+    }
+
+    if (SendsPixmaps(worker, src)) {
+        CaptureSourcePixmap(worker, src, attr);
+        return;
+    }
+
+    XRectangle rects[CAPTURE_MAX_RECTS];
+    int lod;
+    int rect_count = TakeDamage(ctx, &src->buffer, attr, rects);
+    rect_count = PlanFrame(src, attr, rects, rect_count, &lod);
+    if (rect_count == 0) return;
+
+    CaptureFrame *frame = &src->frames[src->back];
+    if (rect_count == CAPTURE_FULL) {
+        PROFILE_BEGIN(PROFILE_CAPTURE);
+        XImage *image = CaptureWindow(ctx, &src->buffer, src->window, attr);
+        PROFILE_END(PROFILE_CAPTURE);
+        if (image == NULL) return;
+        CopyImageRows(frame->pixels, image, lod);
+        CaptureRelease(&src->buffer, image);
+    }
+    else {
+        unsigned char *dst = frame->pixels;
+        for (int i = 0; i < rect_count; i++) {
+            PROFILE_BEGIN(PROFILE_CAPTURE);
+            XImage *image = CaptureWindowRect(ctx, &src->buffer, src->window, attr, rects[i]);
+            PROFILE_END(PROFILE_CAPTURE);
+            if (image == NULL) return;
+            dst = CopyImageRows(dst, image, lod);
+            CaptureRelease(&src->buffer, image);
+        }
+    }
+    FinishFrame(src, attr, rects, rect_count, lod);
+}
+
+// The XCB backend's version of CaptureSourceFrame, for all the copied windows
+// that came due in one pass at once
+static void CaptureBatch(CaptureWorker *worker) {
+    CaptureContext *ctx = &worker->ctx;
+    int count = worker->batch_count;
+    worker->batch_count = 0;
+    if (count == 0) return;
+
+    int lods[CAPTURE_BATCH_MAX];
+    PROFILE_BEGIN(PROFILE_CAPTURE);
+    // Attaching a segment syncs under a trap of its own, which would end
+    // this one and take the batch's errors with it
+    for (int i = 0; i < count; i++) {
+        CaptureSource *src = worker->batch_sources[i];
+        CaptureReserveShm(ctx, &src->buffer, src->window, &src->buffer.attr);
+    }
+    CaptureTrapErrors();
+    CaptureXcbTakeDamage(&worker->xcb, ctx, worker->batch, count);
+    for (int i = 0; i < count; i++) {
+        CaptureRequest *r = &worker->batch[i];
+        CaptureSource *src = worker->batch_sources[i];
+        r->rect_count = PlanFrame(src, &src->buffer.attr, r->rects, r->rect_count, &lods[i]);
+    }
+    CaptureXcbGetImages(&worker->xcb, ctx, worker->batch, count);
+    // Let Xlib see the errors of the requests that had no reply while
+    // they're still trapped
+    XPending(ctx->display);
+    CaptureUntrapErrors();
+    PROFILE_END(PROFILE_CAPTURE);
+
+    for (int i = 0; i < count; i++) {
+        CaptureRequest *r = &worker->batch[i];
+        CaptureSource *src = worker->batch_sources[i];
+        if (r->failed) CaptureFailed(ctx, r->buf);
+        if (r->image_count == 0) continue;
+
+        const XWindowAttributes *attr = &src->buffer.attr;
+        unsigned char *dst = src->frames[src->back].pixels;
+        if (r->rect_count == CAPTURE_FULL) {
+            CopyRows(dst, r->images[0], (size_t)attr->width * 4, attr->width, attr->height, lods[i]);
+        }
+        else {
+            for (int k = 0; k < r->rect_count; k++) {
+                dst = CopyRows(dst, r->images[k], (size_t)r->rects[k].width * 4,
+                               r->rects[k].width, r->rects[k].height, lods[i]);
+            }
+        }
+        CaptureXcbRelease(r);
+        FinishFrame(src, attr, r->rects, r->rect_count, lods[i]);
+    }
+}
+
+// Copies are batched on XCB, everything else is captured right away
+static void CaptureSourceDue(CaptureWorker *worker, CaptureSource *src) {
+    if (!worker->use_xcb || SendsPixmaps(worker, src)) {
+        CaptureSourceFrame(worker, src);
+        return;
+    }
+
+    if (src->buffer.attr.map_state == IsUnmapped) {
+        src->buffer.damaged = false;
+        return;
+    }
+    if (worker->batch_count == CAPTURE_BATCH_MAX) CaptureBatch(worker);
+    worker->batch[worker->batch_count] = (CaptureRequest){.buf = &src->buffer, .window = src->window};
+    worker->batch_sources[worker->batch_count++] = src;
+}
+
+static void FreeSource(CaptureWorker *worker, CaptureSource *src) {
+    CaptureFree(&worker->ctx, &src->buffer);
+    for (int i = 0; i < 3; i++) {
+        free(src->frames[i].pixels);
+    }
+    TileHashesFree(&src->tiles);
+    free(src);
+}
+
+static void AdoptSources(CaptureWorker *worker) {
+    CaptureSource *src = atomic_exchange(&worker->incoming, NULL);
+    while (src != NULL) {
+        CaptureSource *next = src->next;
+        // Damage has to be created on this connection to be reported here
+        if (!CaptureTrack(&worker->ctx, &src->buffer, src->window)) {
+            fprintf(stderr, "Unable to track window 0x%lx\n", src->window);
+        }
+        src->next = worker->sources;
+        worker->sources = src;
+        src = next;
+    }
+}
+
+static void ReapSources(CaptureWorker *worker) {
+    CaptureSource **link = &worker->sources;
+    while (*link != NULL) {
+        CaptureSource *src = *link;
+        if (atomic_load(&src->removed)) {
+            *link = src->next;
+            FreeSource(worker, src);
+            atomic_fetch_sub(&worker->source_count, 1);
+        }
+        else {
+            link = &src->next;
+        }
+    }
+}
+
+static void DrainEvents(CaptureWorker *worker) {
+    while (XPending(worker->ctx.display)) {
+        XEvent event;
+        XNextEvent(worker->ctx.display, &event);
+
+        Window window = CaptureEventWindow(&worker->ctx, &event);
+        if (window == None) continue;
+
+        for (CaptureSource *src = worker->sources; src != NULL; src = src->next) {
+            if (src->window == window) {
+                CaptureHandleEvent(&worker->ctx, &src->buffer, &event);
+                break;
+            }
+        }
+    }
+}
+
+static void WaitForWork(CaptureWorker *worker, double timeout) {
+    XFlush(worker->ctx.display);
+    if (XPending(worker->ctx.display)) return;
+
+    struct pollfd fds[2] = {
+        {.fd = ConnectionNumber(worker->ctx.display), .events = POLLIN},
+        {.fd = worker->wake[0], .events = POLLIN},
+    };
+    poll(fds, 2, timeout < 0 ? -1 : (int)(timeout * 1000.0) + 1);
+
+    if (fds[1].revents & POLLIN) {
+        char buf[64];
+        while (read(worker->wake[0], buf, sizeof(buf)) > 0) {}
+    }
+}
+
+static void *WorkerMain(void *arg) {
+    CaptureWorker *worker = arg;
+
+    while (!atomic_load(&worker->stop)) {
+        AdoptSources(worker);
+        DrainEvents(worker);
+        ReapSources(worker);
+
+        double now = Now();
+        double timeout = -1.0;
+        for (CaptureSource *src = worker->sources; src != NULL; src = src->next) {
+            if (atomic_load(&src->force_full)) src->buffer.damaged = true;
+            if (atomic_exchange(&src->expedite, false)) src->expedite_until = now + EXPEDITE_SECONDS;
+            bool expedited = now < src->expedite_until;
+            // A new level needs a new frame even if nothing changed
+            if (src->published && atomic_load(&src->lod_wanted) != src->lod_served && !SendsPixmaps(worker, src)) {
+                src->buffer.damaged = true;
+            }
+            if (!src->buffer.damaged) continue;
+
+            float hz = atomic_load(&src->rate_hz);
+            if (src->published && hz <= 0.0f && !atomic_load(&src->force_full) && !expedited) continue;
+
+            // A busy window is captured at its rate, not as often as it draws
+            if (now < src->next_capture && !expedited) {
+                double wait = src->next_capture - now;
+                if (timeout < 0 || wait < timeout) timeout = wait;
+                continue;
+            }
+
+            CaptureSourceDue(worker, src);
+            src->next_capture = hz > 0.0f ? now + 1.0 / hz : now;
+        }
+
+        CaptureBatch(worker);
+        WaitForWork(worker, timeout);
+    }
+
+    return NULL;
+}
+
+static bool WorkerInit(CaptureWorker *worker, const char *display_name, CompositeMode composite, CaptureBackend backend) {
+    Display *display = XOpenDisplay(display_name);
+    if (display == NULL) {
+        fprintf(stderr, "Unable to open X display for capture\n");
+        return false;
+    }
+    CaptureInit(&worker->ctx, display, composite);
+
+    worker->use_xcb = backend == CAPTURE_BACKEND_XCB && CaptureXcbInit(&worker->xcb, &worker->ctx);
+    if (backend == CAPTURE_BACKEND_XCB && !worker->use_xcb) {
+        fprintf(stderr, "Unable to capture through XCB, using Xlib\n");
+    }
+    worker->batch_count = 0;
+
+    if (pipe(worker->wake) != 0) {
+        fprintf(stderr, "Unable to create capture wake pipe\n");
+        XCloseDisplay(display);
+        return false;
+    }
+    fcntl(worker->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(worker->wake[1], F_SETFL, O_NONBLOCK);
+
+    atomic_init(&worker->stop, false);
+    atomic_init(&worker->source_count, 0);
+    atomic_init(&worker->incoming, NULL);
+    worker->sources = NULL;
+
+    if (pthread_create(&worker->thread, NULL, WorkerMain, worker) != 0) {
+        fprintf(stderr, "Unable to start capture thread\n");
+        close(worker->wake[0]);
+        close(worker->wake[1]);
+        XCloseDisplay(display);
+        return false;
+    }
+    return true;
+}
+
+CaptureSystem *CaptureSystemInit(const char *display_name, int worker_count, CompositeMode composite,
+                                 CaptureBackend backend) {
+    if (worker_count <= 0) {
+        // Leave a core for the render thread
+        worker_count = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    }
+    if (worker_count < 1) worker_count = 1;
+    if (worker_count > CAPTURE_MAX_WORKERS) worker_count = CAPTURE_MAX_WORKERS;
+
+    CaptureSystem *sys = malloc(sizeof(CaptureSystem));
+    if (sys == NULL) {
+        fprintf(stderr, "Failed to allocate memory for capture system\n");
+        return NULL;
+    }
+    memset(sys, 0, sizeof(CaptureSystem));
+
+    for (int i = 0; i < worker_count; i++) {
+        if (!WorkerInit(&sys->workers[i], display_name, composite, backend)) break;
+        sys->worker_count++;
+    }
+
+    if (sys->worker_count == 0) {
+        free(sys);
+        return NULL;
+    }
+    return sys;
+}
+
+void CaptureSystemSetNotify(CaptureSystem *sys, void (*notify)(void *data), void *data) {
+    for (int i = 0; i < sys->worker_count; i++) {
+        sys->workers[i].notify = notify;
+        sys->workers[i].notify_data = data;
+    }
+}
+
+void CaptureSystemShutdown(CaptureSystem *sys) {
+    for (int i = 0; i < sys->worker_count; i++) {
+        CaptureWorker *worker = &sys->workers[i];
+        atomic_store(&worker->stop, true);
+        Wake(worker);
+        pthread_join(worker->thread, NULL);
+
+        AdoptSources(worker);
+        while (worker->sources != NULL) {
+            CaptureSource *src = worker->sources;
+            worker->sources = src->next;
+            FreeSource(worker, src);
+        }
+
+        if (worker->use_xcb) CaptureXcbFree(&worker->xcb);
+        free(worker->scratch.pixels);
+        close(worker->wake[0]);
+        close(worker->wake[1]);
+        XCloseDisplay(worker->ctx.display);
+    }
+    free(sys);
+}
+
+CaptureSource *CaptureSourceAdd(CaptureSystem *sys, Window window) {
+    CaptureWorker *worker = &sys->workers[0];
+    for (int i = 1; i < sys->worker_count; i++) {
+        if (atomic_load(&sys->workers[i].source_count) < atomic_load(&worker->source_count)) {
+            worker = &sys->workers[i];
+        }
+    }
+
+    CaptureSource *src = malloc(sizeof(CaptureSource));
+    if (src == NULL) {
+        fprintf(stderr, "Failed to allocate memory for capture source\n");
+        return NULL;
+    }
+    memset(src, 0, sizeof(CaptureSource));
+
+    src->window = window;
+    src->worker = worker;
+    atomic_init(&src->rate_hz, 0.0f);
+    atomic_init(&src->lod_wanted, 0);
+    atomic_init(&src->force_full, false);
+    atomic_init(&src->copies_only, false);
+    atomic_init(&src->removed, false);
+    atomic_init(&src->expedite, false);
+    atomic_init(&src->middle, 1);
+    src->back = 0;
+    src->front = 2;
+
+    atomic_fetch_add(&worker->source_count, 1);
+    src->next = atomic_load(&worker->incoming);
+    while (!atomic_compare_exchange_weak(&worker->incoming, &src->next, src)) {}
+    Wake(worker);
+
+    return src;
+}
+
+void CaptureSourceRemove(CaptureSource *src) {
+    atomic_store(&src->removed, true);
+    Wake(src->worker);
+}
+
+void CaptureSourceSetRate(CaptureSource *src, float hz) {
+    float old = atomic_exchange(&src->rate_hz, hz);
+    // Going faster may mean a damaged window is due right away
+    if (hz > old) {
+        Wake(src->worker);
+    }
+}
+
+void CaptureSourceSetLod(CaptureSource *src, int lod) {
+    if (lod < 0) lod = 0;
+    if (lod > SWIZZLE_MAX_LOD) lod = SWIZZLE_MAX_LOD;
+    if (atomic_exchange(&src->lod_wanted, lod) != lod) {
+        Wake(src->worker);
+    }
+}
+
+void CaptureSourceRequestFull(CaptureSource *src) {
+    if (!atomic_exchange(&src->force_full, true)) {
+        Wake(src->worker);
+    }
+}
+
+void CaptureSourceExpedite(CaptureSource *src) {
+    if (!atomic_exchange(&src->expedite, true)) {
+        Wake(src->worker);
+    }
+}
+
+void CaptureSourceRequestCopies(CaptureSource *src) {
+    atomic_store(&src->copies_only, true);
+    CaptureSourceRequestFull(src);
+}
+
+bool CaptureSourcePending(CaptureSource *src) {
+    return atomic_load_explicit(&src->middle, memory_order_relaxed) & FRAME_FRESH;
+}
+
+CaptureFrame *CaptureSourceLatest(CaptureSource *src) {
+    if (!(atomic_load_explicit(&src->middle, memory_order_relaxed) & FRAME_FRESH)) return NULL;
+
+    int old = atomic_exchange_explicit(&src->middle, src->front, memory_order_acq_rel);
+    src->front = old & ~FRAME_FRESH;
+    return &src->frames[src->front];
+}
@@ -0,0 +1,75 @@
+#ifndef CAPTURE_WORKER_H
+#define CAPTURE_WORKER_H
+
+#include "capture.h"
+
+#include <stddef.h>
+
+#define CAPTURE_MAX_WORKERS 4
+
+// One captured update of a window. rect_count is CAPTURE_FULL for a whole
+// window, otherwise pixels holds the rects' RGBA rows packed back to back.
+// In COMPOSITE_PIXMAP mode there are no pixels: pixmap names the window's
+// offscreen storage, which changed and should be rebound.
+//
+// Pixels are scaled down by 2^lod (width >> lod by height >> lod, like a mip
+// level). width, height and rects stay in window coordinates; the rects are
+// aligned to the 2^lod blocks so they shift down exactly.
+typedef struct {
+    int width;
+    int height;
+    Pixmap pixmap;
+    int depth;
+    int lod;
+    int rect_count;
+    XRectangle rects[CAPTURE_MAX_RECTS];
+    unsigned char *pixels;
+    size_t capacity;
+} CaptureFrame;
+
+typedef struct CaptureSource CaptureSource;
+typedef struct CaptureSystem CaptureSystem;
+
+typedef enum {
+    CAPTURE_BACKEND_XLIB, // one window after another, a round trip or more each
+    CAPTURE_BACKEND_XCB,  // every due window at once, see CaptureXcb
+} CaptureBackend;
+
+// Capture runs on worker threads with their own X connections, so the render
+// thread never waits on the server. Each tracked window is a CaptureSource
+// owned by one worker; finished frames are handed over through a lock-free
+// triple buffer and the render thread only ever sees the newest one.
+CaptureSystem *CaptureSystemInit(const char *display_name, int worker_count, CompositeMode composite,
+                                 CaptureBackend backend);
+void CaptureSystemShutdown(CaptureSystem *sys);
+// Called on a worker thread whenever it publishes a frame, e.g. to wake the
+// render thread. Set it before adding any sources.
+void CaptureSystemSetNotify(CaptureSystem *sys, void (*notify)(void *data), void *data);
+
+CaptureSource *CaptureSourceAdd(CaptureSystem *sys, Window window);
+// The source is released by its worker; don't touch it after this
+void CaptureSourceRemove(CaptureSource *src);
+
+// How often a damaged window may be recaptured; 0 stops it. Every source
+// still gets one initial frame so it has something to show.
+void CaptureSourceSetRate(CaptureSource *src, float hz);
+// Capture at 1/2^lod of the window's size from now on. Has no effect on
+// pixmaps, which are never copied.
+void CaptureSourceSetLod(CaptureSource *src, int lod);
+// Ask for a full frame, e.g. when the texture was lost
+void CaptureSourceRequestFull(CaptureSource *src);
+// Capture whatever the window draws next right away, regardless of its rate,
+// e.g. when it was just sent input
+void CaptureSourceExpedite(CaptureSource *src);
+// Send pixels instead of pixmaps for this window, e.g. when the renderer has
+// no way to bind a pixmap of its depth
+void CaptureSourceRequestCopies(CaptureSource *src);
+
+// Whether a frame is waiting to be picked up
+bool CaptureSourcePending(CaptureSource *src);
+
+// Newest frame published since the last call, NULL if there is none. The
+// frame stays valid until the next call for the same source.
+CaptureFrame *CaptureSourceLatest(CaptureSource *src);
+
+#endif // CAPTURE_WORKER_H
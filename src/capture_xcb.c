@@ -0,0 +1,165 @@
+#include "capture_xcb.h"
+
+#include <X11/Xlib-xcb.h>
+#include <xcb/damage.h>
+#include <xcb/shm.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool CaptureXcbInit(CaptureXcb *xcb, CaptureContext *ctx) {
+    memset(xcb, 0, sizeof(CaptureXcb));
+    xcb->conn = XGetXCBConnection(ctx->display);
+    if (xcb->conn == NULL) return false;
+
+    // Xlib already set the extensions up on this connection. Look up their
+    // opcodes now rather than in the middle of the first batch.
+    xcb_prefetch_extension_data(xcb->conn, &xcb_shm_id);
+    xcb_prefetch_extension_data(xcb->conn, &xcb_damage_id);
+    xcb_prefetch_extension_data(xcb->conn, &xcb_xfixes_id);
+    const xcb_query_extension_reply_t *shm = xcb_get_extension_data(xcb->conn, &xcb_shm_id);
+    const xcb_query_extension_reply_t *damage = xcb_get_extension_data(xcb->conn, &xcb_damage_id);
+    const xcb_query_extension_reply_t *xfixes = xcb_get_extension_data(xcb->conn, &xcb_xfixes_id);
+    if (ctx->use_shm && (shm == NULL || !shm->present)) return false;
+    if (ctx->use_damage && (damage == NULL || !damage->present || xfixes == NULL || !xfixes->present)) return false;
+
+    if (ctx->use_damage) {
+        for (int i = 0; i < CAPTURE_BATCH_MAX; i++) {
+            xcb->regions[i] = xcb_generate_id(xcb->conn);
+            xcb_xfixes_create_region(xcb->conn, xcb->regions[i], 0, NULL);
+        }
+    }
+    return true;
+}
+
+void CaptureXcbFree(CaptureXcb *xcb) {
+    if (xcb->conn == NULL) return;
+    for (int i = 0; i < CAPTURE_BATCH_MAX; i++) {
+        if (xcb->regions[i] != 0) xcb_xfixes_destroy_region(xcb->conn, xcb->regions[i]);
+    }
+    xcb_flush(xcb->conn);
+    memset(xcb, 0, sizeof(CaptureXcb));
+}
+
+void CaptureXcbTakeDamage(CaptureXcb *xcb, CaptureContext *ctx, CaptureRequest *requests, int count) {
+    if (!ctx->use_damage) {
+        // Without damage every frame is dirty
+        for (int i = 0; i < count; i++) {
+            requests[i].buf->damaged = true;
+            requests[i].rect_count = CAPTURE_FULL;
+        }
+        return;
+    }
+
+    // Subtract before capturing so that anything drawn after this point
+    // raises a fresh notify instead of being lost
+    xcb_xfixes_fetch_region_cookie_t cookies[CAPTURE_BATCH_MAX];
+    for (int i = 0; i < count; i++) {
+        requests[i].buf->damaged = false;
+        xcb_damage_subtract(xcb->conn, requests[i].buf->damage, XCB_NONE, xcb->regions[i]);
+        cookies[i] = xcb_xfixes_fetch_region(xcb->conn, xcb->regions[i]);
+    }
+
+    for (int i = 0; i < count; i++) {
+        CaptureRequest *r = &requests[i];
+        xcb_generic_error_t *error = NULL;
+        xcb_xfixes_fetch_region_reply_t *reply = xcb_xfixes_fetch_region_reply(xcb->conn, cookies[i], &error);
+        if (reply == NULL) {
+            free(error);
+            r->rect_count = CAPTURE_FULL;
+            continue;
+        }
+
+        // xcb_rectangle_t is laid out like XRectangle
+        const XRectangle *parts = (const XRectangle *)xcb_xfixes_fetch_region_rectangles(reply);
+        int part_count = xcb_xfixes_fetch_region_rectangles_length(reply);
+        r->rect_count = CaptureClipDamage(&r->buf->attr, parts, part_count, r->rects);
+        free(reply);
+    }
+}
+
+typedef union {
+    xcb_get_image_cookie_t plain;
+    xcb_shm_get_image_cookie_t shm;
+} ImageCookie;
+
+void CaptureXcbGetImages(CaptureXcb *xcb, CaptureContext *ctx, CaptureRequest *requests, int count) {
+    ImageCookie cookies[CAPTURE_BATCH_MAX][CAPTURE_MAX_RECTS];
+    size_t offsets[CAPTURE_BATCH_MAX][CAPTURE_MAX_RECTS];
+    bool shared[CAPTURE_BATCH_MAX][CAPTURE_MAX_RECTS];
+    int sent[CAPTURE_BATCH_MAX];
+
+    for (int i = 0; i < count; i++) {
+        CaptureRequest *r = &requests[i];
+        r->image_count = 0;
+        r->failed = false;
+        sent[i] = 0;
+        if (r->rect_count == 0) continue;
+
+        const XWindowAttributes *attr = &r->buf->attr;
+        bool shm = r->buf->shm;
+        size_t segment = shm ? (size_t)r->buf->image->bytes_per_line * r->buf->image->height : 0;
+        Drawable source = CaptureDrawable(ctx, r->buf, r->window);
+
+        // Rects go back to back in the window's segment, like they do in a frame
+        XRectangle full = {0, 0, attr->width, attr->height};
+        int n = r->rect_count == CAPTURE_FULL ? 1 : r->rect_count;
+        size_t offset = 0;
+        for (int k = 0; k < n; k++) {
+            XRectangle rect = r->rect_count == CAPTURE_FULL ? full : r->rects[k];
+            size_t size = (size_t)rect.width * rect.height * 4;
+
+            // Rects grown to whole blocks can add up to more than the window
+            shared[i][k] = shm && offset + size <= segment;
+            offsets[i][k] = offset;
+            if (shared[i][k]) {
+                cookies[i][k].shm = xcb_shm_get_image(xcb->conn, source, rect.x, rect.y, rect.width, rect.height, ~0u,
+                                                      XCB_IMAGE_FORMAT_Z_PIXMAP, r->buf->shminfo.shmseg, offset);
+                offset += size;
+            }
+            else {
+                cookies[i][k].plain = xcb_get_image(xcb->conn, XCB_IMAGE_FORMAT_Z_PIXMAP, source,
+                                                    rect.x, rect.y, rect.width, rect.height, ~0u);
+            }
+        }
+        sent[i] = n;
+    }
+
+    for (int i = 0; i < count; i++) {
+        CaptureRequest *r = &requests[i];
+        bool ok = true;
+
+        // Every reply has to be read, even once one of them failed
+        for (int k = 0; k < sent[i]; k++) {
+            xcb_generic_error_t *error = NULL;
+            if (shared[i][k]) {
+                xcb_shm_get_image_reply_t *reply = xcb_shm_get_image_reply(xcb->conn, cookies[i][k].shm, &error);
+                r->replies[k] = reply;
+                r->images[k] = (const unsigned char *)r->buf->shminfo.shmaddr + offsets[i][k];
+                ok = ok && reply != NULL;
+            }
+            else {
+                xcb_get_image_reply_t *reply = xcb_get_image_reply(xcb->conn, cookies[i][k].plain, &error);
+                r->replies[k] = reply;
+                r->images[k] = reply != NULL ? xcb_get_image_data(reply) : NULL;
+                ok = ok && reply != NULL;
+            }
+            free(error);
+        }
+
+        r->image_count = sent[i];
+        r->failed = !ok;
+        if (!ok) {
+            CaptureXcbRelease(r);
+        }
+    }
+}
+
+void CaptureXcbRelease(CaptureRequest *request) {
+    for (int k = 0; k < request->image_count; k++) {
+        free(request->replies[k]);
+        request->replies[k] = NULL;
+    }
+    request->image_count = 0;
+}
@@ -0,0 +1,53 @@
+#ifndef CAPTURE_XCB_H
+#define CAPTURE_XCB_H
+
+#include "capture.h"
+
+#include <xcb/xcb.h>
+#include <xcb/xfixes.h>
+
+// Most windows read in one batch
+#define CAPTURE_BATCH_MAX 64
+
+// One window's part of a batch. Set buf and window; CaptureXcbTakeDamage
+// fills in the rects, which may then be changed (aligned, dropped, turned
+// into a full capture) before CaptureXcbGetImages reads them.
+typedef struct {
+    CaptureBuffer *buf;
+    Window window;
+    int rect_count; // CAPTURE_FULL, or how many rects to read; 0 skips the window
+    XRectangle rects[CAPTURE_MAX_RECTS];
+
+    // Filled by CaptureXcbGetImages: one image per rect, or a single one for
+    // the whole window, as the server's BGRA with no row padding. None if
+    // reading failed, which sets failed: call CaptureFailed once untrapped.
+    bool failed;
+    int image_count;
+    const unsigned char *images[CAPTURE_MAX_RECTS];
+    void *replies[CAPTURE_MAX_RECTS];
+} CaptureRequest;
+
+// Capture through XCB on the same connection as ctx, a batch of windows at
+// a time. Each step sends the requests for every window before it waits for
+// the first reply, so a batch costs two round trips (damage, then images)
+// however many windows are in it, where Xlib waits on each window in turn.
+typedef struct {
+    xcb_connection_t *conn;
+    xcb_xfixes_region_t regions[CAPTURE_BATCH_MAX]; // damage parts, one per window in a batch
+} CaptureXcb;
+
+// False if the connection can't be used through XCB
+bool CaptureXcbInit(CaptureXcb *xcb, CaptureContext *ctx);
+void CaptureXcbFree(CaptureXcb *xcb);
+
+// Both must be called with errors trapped, and the trap has to see the
+// errors of requests without replies: call XPending before untrapping.
+// Shared segments are only used where CaptureReserveShm made them before
+// the trap, since it can't be called inside one.
+void CaptureXcbTakeDamage(CaptureXcb *xcb, CaptureContext *ctx, CaptureRequest *requests, int count);
+void CaptureXcbGetImages(CaptureXcb *xcb, CaptureContext *ctx, CaptureRequest *requests, int count);
+
+// Once the images have been copied out
+void CaptureXcbRelease(CaptureRequest *request);
+
+#endif // CAPTURE_XCB_H
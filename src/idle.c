@@ -0,0 +1,145 @@
+#include "idle.h"
+#include "raylib.h"
+#define GLFW_INCLUDE_NONE
+#include "GLFW/glfw3.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct IdleWaiter {
+    pthread_t thread;
+    int fd;
+    int wake[2]; // tells the watcher a wait started, or to stop
+    atomic_bool stop;
+    atomic_bool posted; // an empty event is on its way to GLFW
+
+    pthread_mutex_t lock;
+    bool waiting;
+    double deadline;
+};
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void Nudge(IdleWaiter *idle) {
+    ssize_t n = write(idle->wake[1], "", 1);
+    (void)n;
+}
+
+static void *WatcherMain(void *arg) {
+    IdleWaiter *idle = arg;
+    while (!atomic_load(&idle->stop)) {
+        pthread_mutex_lock(&idle->lock);
+        bool waiting = idle->waiting;
+        double deadline = idle->deadline;
+        pthread_mutex_unlock(&idle->lock);
+
+        // Only watch the fd during a wait, or its events would spin us
+        // until the render thread gets around to reading them
+        int timeout = -1;
+        if (waiting) {
+            double left = deadline - Now();
+            timeout = left > 0.0 ? (int)(left * 1000.0) + 1 : 0;
+        }
+        struct pollfd fds[2] = {
+            {.fd = idle->wake[0], .events = POLLIN},
+            {.fd = idle->fd, .events = waiting ? POLLIN : 0},
+        };
+        int n = poll(fds, idle->fd >= 0 ? 2 : 1, timeout);
+        if (fds[0].revents & POLLIN) {
+            char buf[64];
+            while (read(idle->wake[0], buf, sizeof(buf)) > 0) {}
+            continue;
+        }
+        if (!waiting || (n != 0 && !(fds[1].revents & POLLIN))) continue;
+
+        // Unless the wait already ended some other way
+        pthread_mutex_lock(&idle->lock);
+        bool wake = idle->waiting;
+        idle->waiting = false;
+        pthread_mutex_unlock(&idle->lock);
+        if (wake) IdleWake(idle);
+    }
+    return NULL;
+}
+
+IdleWaiter *IdleStart(int fd) {
+    IdleWaiter *idle = malloc(sizeof(IdleWaiter));
+    if (idle == NULL) {
+        fprintf(stderr, "Failed to allocate memory for idle waiter\n");
+        return NULL;
+    }
+    memset(idle, 0, sizeof(IdleWaiter));
+    idle->fd = fd;
+
+    if (pipe(idle->wake) != 0) {
+        fprintf(stderr, "Unable to create idle wake pipe\n");
+        free(idle);
+        return NULL;
+    }
+    fcntl(idle->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(idle->wake[1], F_SETFL, O_NONBLOCK);
+
+    pthread_mutex_init(&idle->lock, NULL);
+    atomic_init(&idle->stop, false);
+    atomic_init(&idle->posted, false);
+    if (pthread_create(&idle->thread, NULL, WatcherMain, idle) != 0) {
+        fprintf(stderr, "Unable to start idle watcher thread\n");
+        pthread_mutex_destroy(&idle->lock);
+        close(idle->wake[0]);
+        close(idle->wake[1]);
+        free(idle);
+        return NULL;
+    }
+    return idle;
+}
+
+void IdleStop(IdleWaiter *idle) {
+    atomic_store(&idle->stop, true);
+    Nudge(idle);
+    pthread_join(idle->thread, NULL);
+
+    pthread_mutex_destroy(&idle->lock);
+    close(idle->wake[0]);
+    close(idle->wake[1]);
+    free(idle);
+}
+
+void IdleWake(IdleWaiter *idle) {
+    // One empty event is enough until the render thread has seen it
+    if (!atomic_exchange(&idle->posted, true)) {
+        glfwPostEmptyEvent();
+    }
+}
+
+void IdleRearm(IdleWaiter *idle) {
+    atomic_store(&idle->posted, false);
+}
+
+void IdleWait(IdleWaiter *idle, double timeout) {
+    pthread_mutex_lock(&idle->lock);
+    idle->waiting = true;
+    idle->deadline = Now() + timeout;
+    pthread_mutex_unlock(&idle->lock);
+    Nudge(idle);
+
+    // Through raylib, so its pressed and released keys stay right
+    EnableEventWaiting();
+    PollInputEvents();
+    DisableEventWaiting();
+
+    pthread_mutex_lock(&idle->lock);
+    idle->waiting = false;
+    pthread_mutex_unlock(&idle->lock);
+}
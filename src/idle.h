@@ -0,0 +1,25 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdbool.h>
+
+typedef struct IdleWaiter IdleWaiter;
+
+// Lets the render thread sleep in GLFW's event wait while nothing on screen
+// would change. GLFW only wakes up for input on its own connection, so a
+// watcher thread wakes it for the rest: IdleWake from any thread (new
+// frames from the capture workers), the watched fd becoming readable (events
+// on our other X connection) or the timeout running out.
+IdleWaiter *IdleStart(int fd);
+void IdleStop(IdleWaiter *idle);
+
+// Any thread: end the current wait, or the next one if there's none
+void IdleWake(IdleWaiter *idle);
+
+// Render thread, instead of EndDrawing on a frame that isn't drawn. Call
+// IdleRearm after every frame's input is polled and before checking
+// whether anything changed, so wakes in between aren't lost.
+void IdleWait(IdleWaiter *idle, double timeout);
+void IdleRearm(IdleWaiter *idle);
+
+#endif // IDLE_H
@@ -0,0 +1,361 @@
+#include "input.h"
+
+#include <X11/keysym.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POINTER_MASK (ButtonPressMask | ButtonReleaseMask | PointerMotionMask)
+
+struct InputForwarder {
+    Display *display;
+    Window own;
+    Window root;
+    pthread_t thread;
+    int wake[2];
+    atomic_bool stop;
+
+    // Shared with the render thread
+    pthread_mutex_t lock;
+    InputView view;
+    bool wanted;
+    unsigned int generation; // bumped by InputBegin and InputEnd
+
+    // Input thread only. Events are handled with a copy of the shared view,
+    // outside the lock, since forwarding them makes round trips.
+    InputView current;
+    bool grabbed;
+    int origin_x; // the target window on the root
+    int origin_y;
+    Window focus; // deepest window under the pointer, which gets key events
+    int focus_x;
+    int focus_y;
+};
+
+static void Wake(InputForwarder *input) {
+    ssize_t n = write(input->wake[1], "", 1);
+    (void)n;
+}
+
+// Cast the pointer into the window's quad. False if it misses the window.
+static bool WindowPoint(const InputView *view, int x, int y, int *px, int *py) {
+    if (view->screen_width <= 0 || view->screen_height <= 0) return false;
+
+    // The same ray as raylib's GetScreenToWorldRay
+    double aspect = (double)view->screen_width / view->screen_height;
+    Matrix projection = MatrixPerspective(view->fovy * DEG2RAD, aspect, 0.01, 1000.0);
+    Matrix camera = MatrixLookAt(view->position, view->target, view->up);
+    float nx = 2.0f * (x + 0.5f) / view->screen_width - 1.0f;
+    float ny = 1.0f - 2.0f * (y + 0.5f) / view->screen_height;
+    Vector3 near = Vector3Unproject((Vector3){nx, ny, 0.0f}, projection, camera);
+    Vector3 far = Vector3Unproject((Vector3){nx, ny, 1.0f}, projection, camera);
+
+    Vector3 origin = Vector3Transform(near, view->inverse);
+    Vector3 direction = Vector3Subtract(Vector3Transform(far, view->inverse), origin);
+    if (fabsf(direction.y) < 1e-8f) return false;
+    float t = -origin.y / direction.y;
+    if (t < 0.0f) return false;
+
+    // Local corner (-x, -z) is texture (0, 0), the window's top left
+    float u = (origin.x + t * direction.x) / view->size.x + 0.5f;
+    float v = (origin.z + t * direction.z) / view->size.y + 0.5f;
+    *px = (int)floorf(u * view->width);
+    *py = (int)floorf(v * view->height);
+    return u >= 0.0f && u < 1.0f && v >= 0.0f && v < 1.0f;
+}
+
+// The deepest window at (x, y) in window, which becomes relative to it. One
+// round trip per level.
+static Window ChildAt(InputForwarder *input, Window window, int *x, int *y) {
+    Window child;
+    if (!XTranslateCoordinates(input->display, window, window, *x, *y, x, y, &child)) return window;
+    while (child != None) {
+        Window next;
+        if (!XTranslateCoordinates(input->display, window, child, *x, *y, x, y, &next)) break;
+        window = child;
+        child = next;
+    }
+    return window;
+}
+
+static void SendPointer(InputForwarder *input, const XEvent *event, int px, int py) {
+    int x = px, y = py;
+    Window target = ChildAt(input, input->current.window, &x, &y);
+    input->focus = target;
+    input->focus_x = x;
+    input->focus_y = y;
+
+    XEvent sent = {0};
+    if (event->type == MotionNotify) {
+        XMotionEvent *e = &sent.xmotion;
+        e->type = MotionNotify;
+        e->window = target;
+        e->root = input->root;
+        e->time = event->xmotion.time;
+        e->x = x;
+        e->y = y;
+        e->x_root = input->origin_x + px;
+        e->y_root = input->origin_y + py;
+        e->state = event->xmotion.state;
+        e->same_screen = True;
+    }
+    else {
+        XButtonEvent *e = &sent.xbutton;
+        e->type = event->type;
+        e->window = target;
+        e->root = input->root;
+        e->time = event->xbutton.time;
+        e->x = x;
+        e->y = y;
+        e->x_root = input->origin_x + px;
+        e->y_root = input->origin_y + py;
+        e->state = event->xbutton.state;
+        e->button = event->xbutton.button;
+        e->same_screen = True;
+    }
+    // Propagate, since the deepest window often doesn't select pointer events
+    XSendEvent(input->display, target, True, POINTER_MASK, &sent);
+}
+
+static void SendKey(InputForwarder *input, const XEvent *event) {
+    Window target = input->focus != None ? input->focus : input->current.window;
+    XEvent sent = {0};
+    XKeyEvent *e = &sent.xkey;
+    e->type = event->type;
+    e->window = target;
+    e->root = input->root;
+    e->time = event->xkey.time;
+    e->x = input->focus_x;
+    e->y = input->focus_y;
+    e->state = event->xkey.state;
+    e->keycode = event->xkey.keycode;
+    e->same_screen = True;
+    XSendEvent(input->display, target, True, KeyPressMask | KeyReleaseMask, &sent);
+}
+
+static void Ungrab(InputForwarder *input) {
+    XUngrabPointer(input->display, CurrentTime);
+    XUngrabKeyboard(input->display, CurrentTime);
+    XSetInputFocus(input->display, input->own, RevertToParent, CurrentTime);
+    input->grabbed = false;
+}
+
+// Grab or let go to match what the render thread wants. False if the grab
+// failed.
+static bool SyncGrab(InputForwarder *input, bool wanted) {
+    if (wanted && !input->grabbed) {
+        Display *display = input->display;
+        int pointer = XGrabPointer(display, input->own, False, POINTER_MASK, GrabModeAsync, GrabModeAsync,
+                                   input->own, None, CurrentTime);
+        int keyboard = XGrabKeyboard(display, input->own, False, GrabModeAsync, GrabModeAsync, CurrentTime);
+        input->grabbed = true;
+        if (pointer != GrabSuccess || keyboard != GrabSuccess) {
+            fprintf(stderr, "Unable to grab input for forwarding\n");
+            Ungrab(input);
+            return false;
+        }
+
+        // Most toolkits only take keys while they think they have focus
+        Window child;
+        XTranslateCoordinates(display, input->current.window, input->root, 0, 0, &input->origin_x, &input->origin_y, &child);
+        XSetInputFocus(display, input->current.window, RevertToParent, CurrentTime);
+        input->focus = None;
+    }
+    else if (!wanted && input->grabbed) {
+        Ungrab(input);
+    }
+    return true;
+}
+
+// Stop forwarding from this side, unless the render thread moved on to
+// another window since generation
+static void Release(InputForwarder *input, unsigned int generation) {
+    pthread_mutex_lock(&input->lock);
+    if (input->generation == generation) input->wanted = false;
+    pthread_mutex_unlock(&input->lock);
+}
+
+// Returns true if the event went to the window
+static bool HandleEvent(InputForwarder *input, const XEvent *event, unsigned int generation) {
+    if (!input->grabbed || input->current.window == None) return false;
+
+    switch (event->type) {
+        case KeyPress:
+        case KeyRelease: {
+            XKeyEvent key = event->xkey;
+            if (XLookupKeysym(&key, 0) == XK_Caps_Lock) {
+                if (event->type == KeyPress) {
+                    Release(input, generation);
+                    Ungrab(input);
+                }
+                return false;
+            }
+            SendKey(input, event);
+            break;
+        }
+        case MotionNotify:
+        case ButtonPress:
+        case ButtonRelease: {
+            int x = event->type == MotionNotify ? event->xmotion.x : event->xbutton.x;
+            int y = event->type == MotionNotify ? event->xmotion.y : event->xbutton.y;
+            int px, py;
+            bool inside = WindowPoint(&input->current, x, y, &px, &py);
+            // Always let go of buttons, or the window would think they're still held
+            if (!inside && event->type != ButtonRelease) return false;
+            SendPointer(input, event, px, py);
+            break;
+        }
+        default:
+            return false;
+    }
+
+    // Send now
+    XFlush(input->display);
+    return true;
+}
+
+// Have the window's response captured as soon as it draws. Locked, since
+// the source may be gone once the render thread has ended forwarding.
+static void Expedite(InputForwarder *input, unsigned int generation) {
+    pthread_mutex_lock(&input->lock);
+    if (input->generation == generation && input->view.source != NULL) {
+        CaptureSourceExpedite(input->view.source);
+    }
+    pthread_mutex_unlock(&input->lock);
+}
+
+static void *InputMain(void *arg) {
+    InputForwarder *input = arg;
+    // The target can go away at any time; whatever fails is dropped
+    CaptureTrapErrors();
+
+    while (!atomic_load(&input->stop)) {
+        // Only copy the render thread's side under the lock; grabbing and
+        // forwarding wait on the server, and the render thread takes the
+        // lock every frame
+        pthread_mutex_lock(&input->lock);
+        input->current = input->view;
+        input->current.source = NULL; // only touched locked, see Expedite
+        bool wanted = input->wanted;
+        unsigned int generation = input->generation;
+        pthread_mutex_unlock(&input->lock);
+
+        if (!SyncGrab(input, wanted)) {
+            Release(input, generation);
+            wanted = false;
+        }
+        bool forwarded = false;
+        while (XPending(input->display)) {
+            XEvent event;
+            XNextEvent(input->display, &event);
+            if (wanted && HandleEvent(input, &event, generation)) forwarded = true;
+        }
+        if (forwarded) Expedite(input, generation);
+        XFlush(input->display);
+
+        struct pollfd fds[2] = {
+            {.fd = ConnectionNumber(input->display), .events = POLLIN},
+            {.fd = input->wake[0], .events = POLLIN},
+        };
+        poll(fds, 2, -1);
+        if (fds[1].revents & POLLIN) {
+            char buf[64];
+            while (read(input->wake[0], buf, sizeof(buf)) > 0) {}
+        }
+    }
+
+    if (input->grabbed) Ungrab(input);
+    XSync(input->display, False);
+    return NULL;
+}
+
+InputForwarder *InputStart(const char *display_name, Window own) {
+    InputForwarder *input = malloc(sizeof(InputForwarder));
+    if (input == NULL) {
+        fprintf(stderr, "Failed to allocate memory for input forwarding\n");
+        return NULL;
+    }
+    memset(input, 0, sizeof(InputForwarder));
+
+    input->display = XOpenDisplay(display_name);
+    if (input->display == NULL) {
+        fprintf(stderr, "Unable to open X display for input forwarding\n");
+        free(input);
+        return NULL;
+    }
+    input->own = own;
+    input->root = DefaultRootWindow(input->display);
+
+    if (pipe(input->wake) != 0) {
+        fprintf(stderr, "Unable to create input wake pipe\n");
+        XCloseDisplay(input->display);
+        free(input);
+        return NULL;
+    }
+    fcntl(input->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(input->wake[1], F_SETFL, O_NONBLOCK);
+
+    pthread_mutex_init(&input->lock, NULL);
+    atomic_init(&input->stop, false);
+    if (pthread_create(&input->thread, NULL, InputMain, input) != 0) {
+        fprintf(stderr, "Unable to start input thread\n");
+        pthread_mutex_destroy(&input->lock);
+        close(input->wake[0]);
+        close(input->wake[1]);
+        XCloseDisplay(input->display);
+        free(input);
+        return NULL;
+    }
+    return input;
+}
+
+void InputStop(InputForwarder *input) {
+    atomic_store(&input->stop, true);
+    Wake(input);
+    pthread_join(input->thread, NULL);
+
+    pthread_mutex_destroy(&input->lock);
+    close(input->wake[0]);
+    close(input->wake[1]);
+    XCloseDisplay(input->display);
+    free(input);
+}
+
+void InputBegin(InputForwarder *input, const InputView *view) {
+    pthread_mutex_lock(&input->lock);
+    input->view = *view;
+    input->wanted = true;
+    input->generation++;
+    pthread_mutex_unlock(&input->lock);
+    Wake(input);
+}
+
+void InputUpdate(InputForwarder *input, const InputView *view) {
+    pthread_mutex_lock(&input->lock);
+    if (input->wanted) input->view = *view;
+    pthread_mutex_unlock(&input->lock);
+}
+
+void InputEnd(InputForwarder *input) {
+    pthread_mutex_lock(&input->lock);
+    input->wanted = false;
+    input->view.window = None;
+    input->view.source = NULL;
+    input->generation++;
+    pthread_mutex_unlock(&input->lock);
+    Wake(input);
+}
+
+bool InputActive(InputForwarder *input) {
+    pthread_mutex_lock(&input->lock);
+    bool wanted = input->wanted;
+    pthread_mutex_unlock(&input->lock);
+    return wanted;
+}
@@ -0,0 +1,48 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "capture_worker.h"
+#include "raymath.h"
+
+#include <X11/Xlib.h>
+
+#include <stdbool.h>
+
+// Where the window being interacted with is, as of the last frame
+typedef struct {
+    // Perspective camera, as in raylib's Camera3D
+    Vector3 position;
+    Vector3 target;
+    Vector3 up;
+    float fovy;
+    int screen_width; // our window, in pointer coordinates
+    int screen_height;
+
+    Window window;         // where input goes
+    Matrix inverse;        // world to the window quad's local space, where it lies in y = 0
+    Vector2 size;          // the quad's size in local space
+    int width;             // the window's size in pixels
+    int height;
+    CaptureSource *source; // expedited after every event
+} InputView;
+
+typedef struct InputForwarder InputForwarder;
+
+// Forwards input on a thread with its own connection. While interacting it
+// grabs the pointer and keyboard on our window, so events reach it as soon
+// as the server sends them instead of when the next frame polls for input.
+// Pointer positions are cast into the window's quad and sent on as window
+// pixel coordinates.
+InputForwarder *InputStart(const char *display_name, Window own);
+void InputStop(InputForwarder *input);
+
+// Start forwarding to the view's window. It ends with InputEnd, or when the
+// user presses Caps Lock.
+void InputBegin(InputForwarder *input, const InputView *view);
+// Keep the view current while interacting
+void InputUpdate(InputForwarder *input, const InputView *view);
+// The view's source isn't touched once this returns
+void InputEnd(InputForwarder *input);
+bool InputActive(InputForwarder *input);
+
+#endif // INPUT_H
@@ -1,600 +1,127 @@
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
-#define Font XFont
-
-#include "raylib.h"
-#undef Font
-#define Font XFont
-#include "rcamera.h"
-#include "raymath.h"
-#include "rlgl.h"
+#include "wm.h"
+#include "swizzle.h"
+#include "profile.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <assert.h>
-
-#define SCREEN_WIDTH 800
-#define SCREEN_HEIGHT 600
-
-const Vector3 ORIGIN = {0.0f, 0.0f, 0.0f};
-
-typedef enum {
-    CameraMovement,
-    CursorMovement,
-    ScaleWindow,
-    MoveWindowZ,
-    MoveWindowXY,
-} ControlMode;
-
-typedef struct {
-    Window window;
-    Model *model;
-    Texture texture;
-    bool visible;
-} MyWindow;
-
-// implement dynamic array
-#define DA_INIT_CAP 16
-
-#define da_reserve(da, expected_capacity)                                              \
-    do {                                                                               \
-        if ((expected_capacity) > (da)->capacity) {                                    \
-            if ((da)->capacity == 0) {                                                 \
-                (da)->capacity = DA_INIT_CAP;                                          \
-            }                                                                          \
-            while ((expected_capacity) > (da)->capacity) {                             \
-                (da)->capacity *= 2;                                                   \
-            }                                                                          \
-            (da)->items = realloc((da)->items, (da)->capacity * sizeof(*(da)->items)); \
-            assert((da)->items != NULL && "Buy more RAM lol");                         \
-        }                                                                              \
-    } while (0)
-
-// Append an item to a dynamic array
-#define da_append(da, item)                  \
-    do {                                     \
-        da_reserve((da), (da)->count + 1);   \
-        (da)->items[(da)->count++] = (item); \
-    } while (0)
-
-#define da_free(da) free((da).items)
-
-// Append several items to a dynamic array
-#define da_append_many(da, new_items, new_items_count)                                          \
-    do {                                                                                        \
-        da_reserve((da), (da)->count + (new_items_count));                                      \
-        memcpy((da)->items + (da)->count, (new_items), (new_items_count)*sizeof(*(da)->items)); \
-        (da)->count += (new_items_count);                                                       \
-    } while (0)
-
-#define da_resize(da, new_size)     \
-    do {                            \
-        da_reserve((da), new_size); \
-        (da)->count = (new_size);   \
-    } while (0)
-
-#define da_last(da) (da)->items[(assert((da)->count > 0), (da)->count-1)]
-
-#define da_remove_unordered(da, i)                   \
-    do {                                             \
-        size_t j = (i);                              \
-        assert(j < (da)->count);                     \
-        (da)->items[j] = (da)->items[--(da)->count]; \
-    } while(0)
-
-typedef struct {
-    MyWindow *items;
-    size_t count;
-    size_t capacity;
-} DA_window;
-
-#define FOR_EACH_WINDOW(item, array)           \
-    for (MyWindow *item = (array).items;       \
-         item < (array).items + (array).count; \
-         ++item)
-
-// Alternative version that provides the index
-#define FOR_EACH_WINDOW_INDEXED(item, index, array)                      \
-    for (size_t index = 0;                                               \
-         index < (array).count && ((item = &(array).items[index]) || 1); \
-         ++index)
-
-typedef struct {
-    Display *display;
-    Camera camera;
-    ControlMode mode;
-    DA_window windows;
-    MyWindow *selected_window;
-    Matrix original_transform;
-    Vector2 original_mouse_position;
-    bool show_controls;
-
-    Ray ray;
-    RayCollision collision;
-} WMState;
-
-Color GetModeColor(ControlMode m) {
-    switch (m) {
-        case CameraMovement: return BLUE;
-        case CursorMovement: return GREEN;
-        case ScaleWindow:
-        case MoveWindowZ:
-        case MoveWindowXY: return RED;
-        default: return BLACK;
-    }
-}
-
-const char *GetModeText(ControlMode m) {
-    switch (m) {
-        case CameraMovement: return "Camera Movement";
-        case CursorMovement: return "Cursor Movement";
-        case ScaleWindow: return "Scale Window";
-        case MoveWindowZ:
-        case MoveWindowXY: return "Move Window";
-        default: return "Unknown Mode";
-    }
-}
-
-void MyUpdateCamera(Camera *camera) {
-#define CAMERA_MOUSE_MOVE_SENSITIVITY 0.005f
-#define CAMERA_MOVE_SPEED 10.0f // Units per second
-    bool moveInWorldPlane = true;
-    bool rotateAroundTarget = false;
-    bool lockView = false;
-    bool rotateUp = false;
-
-    // Keyboard support
-    float cameraMoveSpeed = CAMERA_MOVE_SPEED * GetFrameTime();
-    if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W))
-        CameraMoveForward(camera, cameraMoveSpeed, moveInWorldPlane);
-    if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S))
-        CameraMoveForward(camera, -cameraMoveSpeed, moveInWorldPlane);
-
-    if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A))
-        CameraMoveRight(camera, -cameraMoveSpeed, moveInWorldPlane);
-    if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D))
-        CameraMoveRight(camera, cameraMoveSpeed, moveInWorldPlane);
-
-    if (IsKeyPressed(KEY_F2))
-        camera->target.x = camera->target.y = camera->target.z = 0.0f;
-    if (IsKeyDown(KEY_F3))
-        CameraMoveUp(camera, -cameraMoveSpeed);
-    if (IsKeyDown(KEY_F4))
-        CameraMoveUp(camera, cameraMoveSpeed);
-
-    // Mouse-based rotation
-    Vector2 mousePosition = GetMousePosition();
-    Vector2 screenCenter = {GetScreenWidth() / 2.0f, GetScreenHeight() / 2.0f};
-    Vector2 mouseDelta = {mousePosition.x - screenCenter.x, mousePosition.y - screenCenter.y};
-
-    float rotationSpeed = CAMERA_MOUSE_MOVE_SENSITIVITY;
-    CameraYaw(camera, -mouseDelta.x * rotationSpeed, rotateAroundTarget);
-    CameraPitch(camera, -mouseDelta.y * rotationSpeed, lockView, rotateAroundTarget, rotateUp);
-
-    // Reset mouse position to center of the screen
-    SetMousePosition(screenCenter.x, screenCenter.y);
-
-    // print camera position
-    //  printf("Camera position: (%f, %f, %f)\n", camera->position.x, camera->position.y, camera->position.z);
-    //  printf("Camera target: (%f, %f, %f)\n", camera->target.x, camera->target.y, camera->target.z);
-}
-
-XImage *XGetRGBImage(Display *display, Window window, int x, int y, unsigned int width, unsigned int height) {
-    XImage *image = XGetImage(display, window, x, y, width, height, AllPlanes, ZPixmap);
-    if (image == NULL) {
-        fprintf(stderr, "Unable to get image\n");
-        return NULL;
-    }
-
-    unsigned char *data = (unsigned char *)image->data;
-
-    // TODO: maybe use a shader for this
-    // Swap BGR to RGB
-    unsigned char *pixel = data;
-    unsigned char *end = data + (width * height * 4);
-    while (pixel < end) {
-        unsigned char b = pixel[0];
-        pixel[0] = pixel[2];
-        pixel[2] = b;
-        pixel += 4;
-    }
-
-    return image;
-}
-
-void MyUpdateTexture(Display *display, MyWindow *w) {
-    XWindowAttributes attr;
-    XGetWindowAttributes(display, w->window, &attr);
-
-    XImage *image = XGetRGBImage(display, w->window, 0, 0, attr.width, attr.height);
-    if (image == NULL) {
-        fprintf(stderr, "Unable to get image\n");
-        exit(1);
-    }
-
-    if (w->texture.id == 0) {
-        // Convert rearranged data to Image
-        Image rlImg = {
-            .data = image->data,
-            .width = image->width,
-            .height = image->height,
-            .mipmaps = 1,
-            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, // Raylib does not have a B8R8G8 format
-        };
-
-        w->texture = LoadTextureFromImage(rlImg);
-        if (w->texture.id == 0) {
-            fprintf(stderr, "Unable to load texture\n");
-            exit(1);
-        }
-        SetTextureFilter(w->texture, TEXTURE_FILTER_BILINEAR);
-        UnloadImage(rlImg); // Properly unload the image to avoid memory leaks
-        return;
-    }
-
-    UpdateTexture(w->texture, image->data);
-    XDestroyImage(image);
-}
-
-void DrawWindowBorder(MyWindow *w, Color color) {
-    //TODO: maybe use a shader for this
-    float *vertices = w->model->meshes[0].vertices;
-    Matrix transform = w->model->transform;
-
-    Vector3 v1 = Vector3Transform((Vector3){vertices[0], vertices[1], vertices[2]}, transform);
-    Vector3 v2 = Vector3Transform((Vector3){vertices[3], vertices[4], vertices[5]}, transform);
-    Vector3 v3 = Vector3Transform((Vector3){vertices[6], vertices[7], vertices[8]}, transform);
-    Vector3 v4 = Vector3Transform((Vector3){vertices[9], vertices[10], vertices[11]}, transform);
-
-    DrawSphere(v1, 0.02f, RED);
-    DrawSphere(v2, 0.02f, YELLOW);
-    DrawSphere(v3, 0.02f, GREEN);
-    DrawSphere(v4, 0.02f, BLUE);
-
-    DrawLine3D(v1, v2, color);
-    DrawLine3D(v2, v4, color);
-    DrawLine3D(v4, v3, color);
-    DrawLine3D(v3, v1, color);
-}
-
-Vector3 GetWindowNormal(const MyWindow *w) {
-    float *vertices = w->model->meshes[0].vertices;
-    Matrix transform = w->model->transform;
-
-    // Calculate the normal vector (assuming the window is facing +Y in its local space)
-    Vector3 normal = Vector3Transform((Vector3){0, 1, 0}, transform);
-    Vector3 transformedVec = Vector3Transform((Vector3){0, 0, 0}, transform);
-    normal = Vector3Subtract(normal, transformedVec);
-    return Vector3Normalize(normal);
-}
-
-Vector3 GetWindowCenter(const MyWindow *w) {
-    float *vertices = w->model->meshes[0].vertices;
-    Matrix transform = w->model->transform;
-
-    // Calculate the center of the window
-    Vector3 v2 = Vector3Transform((Vector3){vertices[3], vertices[4], vertices[5]}, transform);
-    Vector3 v3 = Vector3Transform((Vector3){vertices[6], vertices[7], vertices[8]}, transform);
-    return Vector3Scale(Vector3Add(v2, v3), 0.5f);
-}
-
-void DrawWindowNormal(const MyWindow *w, Color color) {
-    Vector3 normal = GetWindowNormal(w);
-    Vector3 center = GetWindowCenter(w);
-
-    // Draw the normal vector
-    Vector3 endPoint = Vector3Add(center, Vector3Scale(normal, 0.5f)); // Adjust the 0.5f to change the length of the normal
-    DrawLine3D(center, endPoint, color);
-
-    // Draw a small sphere at the end of the normal vector
-    DrawSphere(endPoint, 0.02f, color);
-}
-
-Matrix LookAtTarget(Matrix transform, Vector3 target) {
-    Vector3 pos = {transform.m12, transform.m13, transform.m14};
-
-    // Extract scale from original transform
-    Vector3 originalX = {transform.m0, transform.m1, transform.m2};
-    float scale = Vector3Length(originalX);
-
-    Vector3 direction = Vector3Subtract(target, pos);
-
-    // Define the new Y-axis as the direction to the camera
-    Vector3 Y = Vector3Normalize(direction);
-
-    // Define an up vector (world up, unless direction is nearly vertical)
-    Vector3 up = {0.0f, 1.0f, 0.0f};
-    if (fabsf(Y.y) > 0.999f) { // If direction is nearly vertical, adjust up vector
-        up = (Vector3){0.0f, 0.0f, 1.0f};
-    }
-
-    // X-axis perpendicular to Y and up
-    Vector3 X = Vector3Normalize(Vector3CrossProduct(up, Y));
-    // Z-axis completes the orthonormal basis
-    Vector3 Z = Vector3CrossProduct(X, Y);
-
-    // Construct rotation matrix (columns are X, Y, Z)
-    Matrix newTransform = {
-        X.x * scale, Y.x * scale, Z.x * scale, pos.x,
-        X.y * scale, Y.y * scale, Z.y * scale, pos.y,
-        X.z * scale, Y.z * scale, Z.z * scale, pos.z,
-        0.0f, 0.0f, 0.0f, 1.0f
-    };
-
-    return newTransform;
-}
-
-void WMUpdate(WMState *wm) {
-    if (wm->mode == CameraMovement) {
-        MyUpdateCamera(&wm->camera);
-        if (IsKeyPressed(KEY_Q) || IsKeyPressed(KEY_SPACE) || IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-            wm->mode = CursorMovement;
-            EnableCursor();
-        }
-        else if (IsKeyPressed(KEY_H)) {
-            FOR_EACH_WINDOW(w, wm->windows) {
-                w->visible = !w->visible;
-            }
+#include <ctype.h>
+
+void PrintUsage(const char *program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --upload=pbo|sync  stream textures through pixel buffers (default) or upload synchronously\n");
+    printf("  --composite=pixmap|copy|off\n");
+    printf("                     redirect windows offscreen and bind their pixmaps as textures (default),\n");
+    printf("                     redirect and read the pixmaps back, or read windows on screen\n");
+    printf("  --capture=xlib|xcb read window contents one window at a time (default), or send the\n");
+    printf("                     requests for every window due at once and then collect the replies\n");
+    printf("  --occlusion=on|off skip drawing and capturing windows hidden behind others (default on)\n");
+    printf("  --redraw=always|changed\n");
+    printf("                     draw every frame (default), or only when something changed and\n");
+    printf("                     sleep until then\n");
+    printf("  --focused-hz=N     refresh rate of the selected window (default 60)\n");
+    printf("  --background-hz=N  refresh rate of other windows in view (default 10)\n");
+    printf("  --update-budget=MS time per frame for texture updates (default 4)\n");
+    printf("  --texture-budget=MB\n");
+    printf("                     shrink the textures of windows out of view to stay under this\n");
+    printf("                     (default 0, no limit)\n");
+    printf("  --scene-ms=MS      lower the resolution of the 3d scene while it takes longer than\n");
+    printf("                     this to draw (default 0, always full resolution)\n");
+    printf("  --session=PATH     put windows back where they were, showing their last frame\n");
+    printf("                     until they're captured, and save them there on exit\n");
+    printf("  --tap=PATH         stream the 3d scene to PATH, a file or a fifo, as YUV4MPEG2\n");
+    printf("  --max-lod=N        capture distant windows at down to 1/2^N size (default %d)\n", SWIZZLE_MAX_LOD);
+    printf("  --help             show this message\n");
+}
+
+// Parse "<name><number>" into value, e.g. "--focused-hz=30"
+bool ParseFloatOption(const char *arg, const char *name, float *value) {
+    size_t length = strlen(name);
+    if (strncmp(arg, name, length) != 0) return false;
+
+    char *end;
+    float parsed = strtof(arg + length, &end);
+    if (end == arg + length || *end != '\0' || parsed < 0.0f) return false;
+    *value = parsed;
+    return true;
+}
+
+bool ParseOptions(int argc, char **argv, WMOptions *options) {
+    memset(options, 0, sizeof(WMOptions));
+    options->composite = COMPOSITE_PIXMAP;
+    options->schedule.focused_hz = 60.0f;
+    options->schedule.background_hz = 10.0f;
+    options->schedule.budget_ms = 4.0f;
+    options->schedule.max_lod = SWIZZLE_MAX_LOD;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--upload=pbo") == 0) {
+            options->sync_upload = false;
+        }
+        else if (strcmp(arg, "--upload=sync") == 0) {
+            options->sync_upload = true;
+        }
+        else if (strcmp(arg, "--composite=pixmap") == 0) {
+            options->composite = COMPOSITE_PIXMAP;
+        }
+        else if (strcmp(arg, "--composite=copy") == 0) {
+            options->composite = COMPOSITE_COPY;
+        }
+        else if (strcmp(arg, "--composite=off") == 0) {
+            options->composite = COMPOSITE_OFF;
+        }
+        else if (strcmp(arg, "--capture=xlib") == 0) {
+            options->capture = CAPTURE_BACKEND_XLIB;
+        }
+        else if (strcmp(arg, "--capture=xcb") == 0) {
+            options->capture = CAPTURE_BACKEND_XCB;
+        }
+        else if (strcmp(arg, "--occlusion=on") == 0) {
+            options->no_occlusion = false;
+        }
+        else if (strcmp(arg, "--occlusion=off") == 0) {
+            options->no_occlusion = true;
+        }
+        else if (strcmp(arg, "--redraw=always") == 0) {
+            options->on_demand = false;
+        }
+        else if (strcmp(arg, "--redraw=changed") == 0) {
+            options->on_demand = true;
+        }
+        else if (ParseFloatOption(arg, "--focused-hz=", &options->schedule.focused_hz)) {}
+        else if (ParseFloatOption(arg, "--background-hz=", &options->schedule.background_hz)) {}
+        else if (ParseFloatOption(arg, "--update-budget=", &options->schedule.budget_ms)) {}
+        else if (ParseFloatOption(arg, "--texture-budget=", &options->texture_budget_mb)) {}
+        else if (ParseFloatOption(arg, "--scene-ms=", &options->scene_ms)) {}
+        else if (strncmp(arg, "--session=", 10) == 0 && arg[10] != '\0') {
+            options->session_path = arg + 10;
+        }
+        else if (strncmp(arg, "--tap=", 6) == 0 && arg[6] != '\0') {
+            options->tap_path = arg + 6;
+        }
+        else if (strncmp(arg, "--max-lod=", 10) == 0 && isdigit((unsigned char)arg[10])) {
+            options->schedule.max_lod = atoi(arg + 10);
+            if (options->schedule.max_lod > SWIZZLE_MAX_LOD) options->schedule.max_lod = SWIZZLE_MAX_LOD;
         }
         else {
-            FOR_EACH_WINDOW(w, wm->windows) {
-                w->model->transform = LookAtTarget(w->model->transform, wm->camera.position);
+            if (strcmp(arg, "--help") != 0) {
+                fprintf(stderr, "Unknown option: %s\n", arg);
             }
+            PrintUsage(argv[0]);
+            return false;
         }
     }
-    else if (wm->mode == CursorMovement) {
-        if (IsKeyPressed(KEY_SPACE)) {
-            wm->mode = CameraMovement;
-            DisableCursor();
-        }
-        else if (IsKeyPressed(KEY_H)) {
-            FOR_EACH_WINDOW(w, wm->windows) {
-                w->visible = !w->visible;
-            }
-        }
-        else if (wm->selected_window != NULL && IsKeyPressed(KEY_S)) {
-            wm->mode = ScaleWindow;
-            wm->original_transform = wm->selected_window->model->transform;
-        }
-        else if (wm->selected_window != NULL && IsKeyPressed(KEY_Z)) {
-            wm->mode = MoveWindowZ;
-            wm->original_transform = wm->selected_window->model->transform;
-            wm->original_mouse_position = GetMousePosition();
-        }
-        else if (wm->selected_window != NULL && IsKeyPressed(KEY_G)) {
-            wm->mode = MoveWindowXY;
-            wm->original_transform = wm->selected_window->model->transform;
-            wm->original_mouse_position = GetMousePosition();
-        }
-        else {//if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-            wm->ray = GetScreenToWorldRay(GetMousePosition(), wm->camera);
-
-            wm->collision.distance = 1000000.0f;
-            wm->collision.hit = false;
-            RayCollision tempCollision = {0};
-            // Check collision between ray and box
-            FOR_EACH_WINDOW(w, wm->windows) {
-                tempCollision = GetRayCollisionMesh(wm->ray, w->model->meshes[0], w->model->transform);
-                if (tempCollision.hit && tempCollision.distance <= wm->collision.distance) {
-                    wm->collision = tempCollision;
-                    wm->selected_window = w;
-                }
-            }
-        }
-    }
-    else if (wm->mode == ScaleWindow) {
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-            wm->mode = CursorMovement;
-        }
-        else if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_CAPS_LOCK)) {
-            wm->mode = CursorMovement;
-            wm->selected_window->model->transform = wm->original_transform;
-        }
-        else {
-            //TODO: maybe scale based on mouse velocity instead
-            //      maybe wrap around the screen
-
-            // scale based on mouse position distance from the center of the screen
-            // the closer to the center, the smaller the scale
-            // the further from the center, the larger the scale
-            // should scale quadratically
-
-            Vector2 mousePosition = GetMousePosition();
-            Vector2 screenCenter = {GetScreenWidth() / 2.0f, GetScreenHeight() / 2.0f};
-            Vector2 mouseDelta = {mousePosition.x - screenCenter.x, mousePosition.y - screenCenter.y};
-            float scale = Vector2Length(mouseDelta) / (GetScreenWidth() / 2.0f);
-            scale *= 5*scale; // scale quadratically
-            if (scale < 0.03f) scale = 0.03f; // minimum scale
-            if (scale > 10.0f) scale = 10.0f; // maximum scale
-            Matrix scaleMat = MatrixScale(scale, scale, scale);
-            wm->selected_window->model->transform = MatrixMultiply(scaleMat, wm->original_transform);
-        }
-    }
-    else if (wm->mode == MoveWindowZ) {
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-            wm->mode = CursorMovement;
-        }
-        else if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_CAPS_LOCK)) {
-            wm->mode = CursorMovement;
-            wm->selected_window->model->transform = wm->original_transform;
-        }
-        else {
-            // move window toward the camera when mouse is above center
-            // move window away from the camera when mouse is below center
-
-            Vector3 pos = {wm->original_transform.m12, wm->original_transform.m13, wm->original_transform.m14};
-            Vector3 moveDirection = Vector3Subtract(pos, wm->camera.position);
-            float scalar = (wm->original_mouse_position.y - GetMouseY()) / 60.0f;
-            Vector3 moveVector = Vector3Scale(moveDirection, scalar);
-
-            Matrix m = MatrixTranslate(moveVector.x, moveVector.y, moveVector.z);
-            wm->selected_window->model->transform = MatrixMultiply(wm->original_transform, m);
-        }
-    }
-    else if (wm->mode == MoveWindowXY) {
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-            wm->mode = CursorMovement;
-        }
-        else if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_CAPS_LOCK)) {
-            wm->mode = CursorMovement;
-            wm->selected_window->model->transform = wm->original_transform;
-        }
-        else {
-            Vector2 mousePosition = GetMousePosition();
-            Matrix orig_t = wm->original_transform;
-            Vector3 pos = {orig_t.m12, orig_t.m13, orig_t.m14};
-            Vector3 directionOfWindow = Vector3Subtract(pos, wm->camera.position);
-
-            Vector3 forward = Vector3Normalize(Vector3Subtract(wm->camera.target, wm->camera.position));
-            Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, wm->camera.up));
-
-            Vector3 moveDirectionX = Vector3RotateByAxisAngle(directionOfWindow, wm->camera.up, (wm->original_mouse_position.x - mousePosition.x) / 800.0f);
-            Vector3 moveDirection = Vector3RotateByAxisAngle(moveDirectionX, right, (wm->original_mouse_position.y - mousePosition.y) / 800.0f);
-
-            Vector3 moveVector = Vector3Subtract(moveDirection, directionOfWindow);
-
-            float scale = Vector3Length((Vector3){orig_t.m0, orig_t.m1, orig_t.m2});
-            Vector3 newPos = Vector3Add(pos, moveVector);
-
-            Matrix m = MatrixMultiply(
-                MatrixScale(scale, scale, scale),
-                MatrixTranslate(newPos.x, newPos.y, newPos.z));
-            wm->selected_window->model->transform = LookAtTarget(m, wm->camera.position);
-        }
-    }
-
-    if (wm->selected_window != NULL) {
-        MyUpdateTexture(wm->display, wm->selected_window);
-    }
-
-    if (IsKeyPressed(KEY_F1)) {
-        wm->show_controls = !wm->show_controls;
-    }
-}
-
-MyWindow *WindowInit(Display *display, Camera camera, Window id, Vector3 pos) {
-    MyWindow *w = malloc(sizeof(MyWindow));
-    if (w == NULL) {
-        fprintf(stderr, "Failed to allocate memory for window\n");
-        exit(1);
-    }
-
-    w->window = id;
-    w->texture.id = 0;
-
-    XWindowAttributes attr;
-    if (XGetWindowAttributes(display, w->window, &attr) == 0) {
-        fprintf(stderr, "Unable to get window attributes\n");
-        XCloseDisplay(display);
-        exit(1);
-    }
-
-    // Create a simple plane mesh
-    Mesh plane = GenMeshPlane(attr.width / 350.0f, attr.height / 350.0f, 1, 1); // Width, length, resX, resZ
-    // Mesh cube = GenMeshCube(4.0f, 3.0f, 0.1f); // Width, height, depth
-
-    w->model = (Model *)malloc(sizeof(Model));
-    if (w->model == NULL) {
-        fprintf(stderr, "Failed to allocate memory for model\n");
-        exit(1);
-    }
-    *w->model = LoadModelFromMesh(plane);
-
-    MyUpdateTexture(display, w);
-    w->model->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = w->texture;
-
-    // printf("Window %d texture id: %d\n", i, w.texture->id);
-    w->model->transform = LookAtTarget(MatrixTranslate(pos.x, pos.y, pos.z), camera.position);
-
-    w->visible = true;
-    return w;
-}
-
-WMState *WMInit() {
-    // Tell the window to use vsync and work on high DPI displays
-    SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_HIGHDPI | FLAG_MSAA_4X_HINT);
-
-    // Create the window and OpenGL context
-    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "3dwm");
-
-    WMState *wm = (WMState *)malloc(sizeof(WMState));
-    if (wm == NULL) {
-        fprintf(stderr, "Failed to allocate memory for window manager state\n");
-        return NULL;
-    }
-    memset(wm, 0, sizeof(WMState));
-
-    wm->camera.up = (Vector3){0.0f, 1.0f, 0.0f}; // Camera up vector (rotation towards target)
-    wm->camera.fovy = 45.0f;                     // Camera field-of-view Y
-    wm->camera.projection = CAMERA_PERSPECTIVE;  // Camera projection type
-
-    wm->camera.position = (Vector3){0, 2, 8};
-    wm->camera.target = (Vector3){0, 0, -3};
-
-    SetTargetFPS(60);
-    wm->show_controls = true;
-
-    wm->display = XOpenDisplay(NULL);
-    if (wm->display == NULL) {
-        fprintf(stderr, "Unable to open X display\n");
-        return NULL;
-    }
-
-    MyWindow *w1 = WindowInit(wm->display, wm->camera, 0x1e0002c, (Vector3){0.0f, 3.25f, -0.8f});
-    da_append(&wm->windows, *w1);
-
-    MyWindow *w2 = WindowInit(wm->display, wm->camera, 0x2a00003, (Vector3){2.0f, 2.25f, -1.0f});
-    da_append(&wm->windows, *w2);
-
-    wm->selected_window = &wm->windows.items[0];
-    wm->mode = CursorMovement;
-
-    // disable the escape key
-    SetExitKey(-1);
-
-    return wm;
+    return true;
 }
 
-void DrawModeText(WMState *wm) {
-    const char *modeText = GetModeText(wm->mode);
-    Color modeColor = GetModeColor(wm->mode);
-    const int FONTSIZE = 10;
-    DrawText(TextFormat("Mode: %s", modeText), 5, 0, FONTSIZE, modeColor);
-}
-
-void DrawControls(WMState *wm) {
-    if (!wm->show_controls) return;
-
-    const char* controlsText[] = {
-        "- Press [Space] to toggle cursor/camera movement",
-        "- Use [F1] to toggle controls display",
-        "Mode: Cursor Movement",
-        "- Press H to toggle visibility of all windows",
-        "- Press S to scale selected window",
-        "- Press Z to move selected window in the Z direction",
-        "- Press G to move selected window in the XY plane",
-        "- Left-click to confirm change",
-        "- Press [Escape] to cancel change",
-        "Mode: Camera Movement",
-        "- Use WASD to move",
-        "- Use [F3/F4] to move up/down",
-    };
-
-    const int ROW_HEIGHT = 20;
-    const int ROW_COUNT = sizeof(controlsText) / sizeof(controlsText[0]);
-    DrawRectangle(10, 10, 285, ROW_COUNT * ROW_HEIGHT + 10, Fade(SKYBLUE, 0.5f));
-    DrawRectangleLines(10, 10, 285, ROW_COUNT * ROW_HEIGHT + 10, BLUE);
-
-    const int FONTSIZE = 10;
-    const int INDENTX = 20;
-    for (int i = 0; i < ROW_COUNT; i++) {
-        DrawText(controlsText[i], INDENTX, (i+1) * ROW_HEIGHT, FONTSIZE, DARKGRAY);
+int main(int argc, char **argv) {
+    WMOptions options;
+    if (!ParseOptions(argc, argv, &options)) {
+        return 1;
     }
-}
 
-int main(void) {
-    WMState *wm = WMInit();
+    WMState *wm = WMInit(&options);
     if (wm == NULL) {
         printf("Failed to initialize window manager\n");
         return 1;
@@ -602,51 +129,27 @@ int main(void) {
 
     // game loop
     while (!WindowShouldClose()) {
+        PROFILE_BEGIN(PROFILE_FRAME);
         WMUpdate(wm);
 
-        BeginDrawing();
-
-        ClearBackground(RAYWHITE);
+        if (WMNeedsDraw(wm)) {
+            BeginDrawing();
+            WMDraw(wm);
+            PROFILE_END(PROFILE_FRAME);
 
-        BeginMode3D(wm->camera);
-
-        DrawGrid(10, 1.0f);
-
-        // draw collision box
-        if (wm->collision.hit) {
-            DrawCube(wm->collision.point, 0.1f, 0.1f, 0.1f, RED);
+            // end the frame and get ready for the next one  (display frame, poll input, etc...)
+            EndDrawing();
         }
-        DrawRay(wm->ray, GREEN);
-
-        FOR_EACH_WINDOW(w, wm->windows) {
-            if (!w->visible) break;
-            DrawModel(*w->model, ORIGIN, 1.0f, WHITE);
-
-            Color color = wm->selected_window != NULL && wm->selected_window->window == w->window ? RED : BLACK;
-            DrawWindowBorder(w, color);
-
-            if (wm->selected_window->window == w->window)
-                DrawWindowNormal(w, GREEN);
+        else {
+            // The screen already shows all there is; sleep until that changes
+            WMWait(wm);
         }
 
-        EndMode3D();
-
-        // display frame rate on screen
-        int screenWidth = GetScreenWidth();
-        DrawFPS(screenWidth - 80, 10);
-
-        DrawModeText(wm);
-        DrawControls(wm);
-
-        // end the frame and get ready for the next one  (display frame, poll input, etc...)
-        EndDrawing();
+#ifdef PROFILE_ENABLED
+        ProfileCollect();
+#endif
     }
 
-    // cleanup
-    FOR_EACH_WINDOW(w, wm->windows) {
-        UnloadModel(*w->model);
-    }
-    XCloseDisplay(wm->display);
-    CloseWindow();
+    WMShutdown(wm);
     return 0;
 }
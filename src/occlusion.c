@@ -0,0 +1,208 @@
+#include "occlusion.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Corners closer to the camera than this (in clip w) can't be projected
+#define NEAR_W 1e-3f
+
+static Vector4 ToClip(Matrix m, Vector3 v) {
+    return (Vector4){
+        m.m0 * v.x + m.m4 * v.y + m.m8 * v.z + m.m12,
+        m.m1 * v.x + m.m5 * v.y + m.m9 * v.z + m.m13,
+        m.m2 * v.x + m.m6 * v.y + m.m10 * v.z + m.m14,
+        m.m3 * v.x + m.m7 * v.y + m.m11 * v.z + m.m15,
+    };
+}
+
+void OcclusionBegin(OcclusionBuffer *occ, const SchedulerView *view, int item_count) {
+    occ->count = 0;
+    occ->item_count = 0;
+    occ->view_proj = view->view_proj;
+
+    int width = OCCLUSION_WIDTH;
+    int height = view->width > 0.0f ? (int)(width * view->height / view->width + 0.5f) : width;
+    if (height < 1) height = 1;
+    if (height > width * 4) height = width * 4;
+    if (width != occ->width || height != occ->height || occ->depth == NULL) {
+        free(occ->depth);
+        occ->width = occ->height = 0;
+        occ->depth = malloc((size_t)width * height * sizeof(float));
+        if (occ->depth == NULL) {
+            fprintf(stderr, "Failed to allocate memory for occlusion depth buffer\n");
+            return;
+        }
+        occ->width = width;
+        occ->height = height;
+    }
+
+    if (item_count > occ->item_capacity) {
+        bool *hidden = realloc(occ->hidden, item_count * sizeof(bool));
+        if (hidden == NULL) {
+            fprintf(stderr, "Failed to allocate memory for occlusion results\n");
+            return;
+        }
+        occ->hidden = hidden;
+        occ->item_capacity = item_count;
+    }
+    if (item_count > 0) memset(occ->hidden, 0, item_count * sizeof(bool));
+    occ->item_count = item_count;
+}
+
+void OcclusionAdd(OcclusionBuffer *occ, int item, const Vector3 corners[4]) {
+    if (item < 0 || item >= occ->item_count) return;
+
+    if (occ->count == occ->capacity) {
+        int capacity = occ->capacity == 0 ? 16 : occ->capacity * 2;
+        OcclusionQuad *quads = realloc(occ->quads, capacity * sizeof(OcclusionQuad));
+        if (quads == NULL) {
+            fprintf(stderr, "Failed to allocate memory for occlusion quads\n");
+            return;
+        }
+        occ->quads = quads;
+        occ->capacity = capacity;
+    }
+
+    OcclusionQuad *q = &occ->quads[occ->count++];
+    q->item = item;
+    q->projected = true;
+    q->nearest = FLT_MAX;
+    for (int i = 0; i < 4; i++) {
+        Vector4 clip = ToClip(occ->view_proj, corners[i]);
+        if (clip.w <= NEAR_W) {
+            // Straddling the camera: in the way of everything, but it can't
+            // be drawn into the buffer, so it neither hides nor is hidden
+            q->projected = false;
+            q->nearest = -FLT_MAX;
+            return;
+        }
+        q->screen[i] = (Vector2){
+            (clip.x / clip.w + 1.0f) * 0.5f * occ->width,
+            (1.0f - clip.y / clip.w) * 0.5f * occ->height,
+        };
+        q->depth[i] = clip.z / clip.w;
+        if (q->depth[i] < q->nearest) q->nearest = q->depth[i];
+    }
+}
+
+static int CompareNearest(const void *a, const void *b) {
+    float na = ((const OcclusionQuad *)a)->nearest;
+    float nb = ((const OcclusionQuad *)b)->nearest;
+    return (na > nb) - (na < nb);
+}
+
+// Cells the quad's screen bounds touch, clamped to the buffer. False if
+// it's all off the buffer.
+static bool CellBounds(const OcclusionBuffer *occ, const OcclusionQuad *q, int *x0, int *y0, int *x1, int *y1) {
+    float min_x = q->screen[0].x, max_x = min_x;
+    float min_y = q->screen[0].y, max_y = min_y;
+    for (int i = 1; i < 4; i++) {
+        min_x = fminf(min_x, q->screen[i].x);
+        max_x = fmaxf(max_x, q->screen[i].x);
+        min_y = fminf(min_y, q->screen[i].y);
+        max_y = fmaxf(max_y, q->screen[i].y);
+    }
+    *x0 = (int)fmaxf(floorf(min_x), 0.0f);
+    *y0 = (int)fmaxf(floorf(min_y), 0.0f);
+    *x1 = (int)fminf(ceilf(max_x), (float)occ->width);
+    *y1 = (int)fminf(ceilf(max_y), (float)occ->height);
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+static bool Covered(const OcclusionBuffer *occ, const OcclusionQuad *q, int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; y++) {
+        const float *row = occ->depth + (size_t)y * occ->width;
+        for (int x = x0; x < x1; x++) {
+            if (row[x] >= q->nearest) return false;
+        }
+    }
+    return true;
+}
+
+static void Rasterize(OcclusionBuffer *occ, const OcclusionQuad *q, int x0, int y0, int x1, int y1) {
+    const Vector2 *s = q->screen;
+    float area = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        area += s[i].x * s[(i + 1) % 4].y - s[(i + 1) % 4].x * s[i].y;
+    }
+    // Edge on
+    if (fabsf(area) < 1e-6f) return;
+    float sign = area > 0.0f ? 1.0f : -1.0f;
+
+    // The quad stays flat after projection, so its depth is a plane over
+    // the buffer: z = a x + b y + c
+    float ux = s[1].x - s[0].x, uy = s[1].y - s[0].y, uz = q->depth[1] - q->depth[0];
+    float vx = s[2].x - s[0].x, vy = s[2].y - s[0].y, vz = q->depth[2] - q->depth[0];
+    float nx = uy * vz - uz * vy;
+    float ny = uz * vx - ux * vz;
+    float nz = ux * vy - uy * vx;
+    if (fabsf(nz) < 1e-6f) return;
+    float a = -nx / nz;
+    float b = -ny / nz;
+    float c = q->depth[0] - a * s[0].x - b * s[0].y;
+    // From a cell's center to its farthest corner
+    float slack = 0.5f * (fabsf(a) + fabsf(b));
+
+    for (int y = y0; y < y1; y++) {
+        float cy = y + 0.5f;
+        float *row = occ->depth + (size_t)y * occ->width;
+        for (int x = x0; x < x1; x++) {
+            float cx = x + 0.5f;
+            // Inside every edge at all four of the cell's corners
+            bool inside = true;
+            for (int i = 0; i < 4 && inside; i++) {
+                Vector2 p = s[i];
+                Vector2 n = s[(i + 1) % 4];
+                float dx = n.x - p.x, dy = n.y - p.y;
+                float edge = sign * (dx * (cy - p.y) - dy * (cx - p.x));
+                inside = edge >= 0.5f * (fabsf(dx) + fabsf(dy));
+            }
+            if (!inside) continue;
+
+            float z = a * cx + b * cy + c + slack;
+            if (z < row[x]) row[x] = z;
+        }
+    }
+}
+
+void OcclusionResolve(OcclusionBuffer *occ) {
+    occ->tested = 0;
+    occ->occluded = 0;
+    if (occ->depth == NULL || occ->item_count == 0) return;
+
+    for (size_t i = 0; i < (size_t)occ->width * occ->height; i++) {
+        occ->depth[i] = FLT_MAX;
+    }
+    qsort(occ->quads, occ->count, sizeof(OcclusionQuad), CompareNearest);
+
+    // Front to back, so every quad is tested against everything in front
+    // of it before it's drawn in itself
+    for (int i = 0; i < occ->count; i++) {
+        const OcclusionQuad *q = &occ->quads[i];
+        int x0, y0, x1, y1;
+        if (!q->projected || !CellBounds(occ, q, &x0, &y0, &x1, &y1)) continue;
+
+        occ->tested++;
+        if (Covered(occ, q, x0, y0, x1, y1)) {
+            occ->hidden[q->item] = true;
+            occ->occluded++;
+        }
+        else {
+            Rasterize(occ, q, x0, y0, x1, y1);
+        }
+    }
+}
+
+bool OcclusionHidden(const OcclusionBuffer *occ, int item) {
+    return item >= 0 && item < occ->item_count && occ->hidden[item];
+}
+
+void OcclusionFree(OcclusionBuffer *occ) {
+    free(occ->depth);
+    free(occ->quads);
+    free(occ->hidden);
+    memset(occ, 0, sizeof(OcclusionBuffer));
+}
@@ -0,0 +1,52 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "raylib.h"
+#include "scheduler.h"
+
+#include <stdbool.h>
+
+// Columns of the depth buffer; rows follow the screen's aspect ratio
+#define OCCLUSION_WIDTH 128
+
+typedef struct {
+    int item;
+    Vector2 screen[4]; // in depth buffer cells
+    float depth[4];    // normalized device z
+    float nearest;
+    bool projected;    // false if it crosses the near plane
+} OcclusionQuad;
+
+// A coarse software depth buffer the window quads are rasterized into front
+// to back, to find the ones that are completely behind nearer windows.
+// Conservative both ways: an occluder only covers the cells it covers
+// whole, at the farthest depth it has in them, and a quad is only hidden
+// if every cell its bounds touch is covered nearer than its nearest point.
+// Windows are taken to be opaque.
+typedef struct {
+    float *depth;
+    int width;
+    int height;
+    Matrix view_proj;
+
+    OcclusionQuad *quads;
+    int count;
+    int capacity;
+    bool *hidden; // by item
+    int item_count;
+    int item_capacity;
+
+    // As of the last OcclusionResolve
+    int tested;
+    int occluded;
+} OcclusionBuffer;
+
+// Start over for items 0 to item_count - 1 seen from view
+void OcclusionBegin(OcclusionBuffer *occ, const SchedulerView *view, int item_count);
+// corners in perimeter order, world space. Items never added aren't hidden.
+void OcclusionAdd(OcclusionBuffer *occ, int item, const Vector3 corners[4]);
+void OcclusionResolve(OcclusionBuffer *occ);
+bool OcclusionHidden(const OcclusionBuffer *occ, int item);
+void OcclusionFree(OcclusionBuffer *occ);
+
+#endif // OCCLUSION_H
@@ -0,0 +1,295 @@
+#include "picking.h"
+#include "raymath.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Past this depth nodes split by count, which bounds the tree's depth (and
+// the traversal stack) no matter how the windows are clustered
+#define PICK_MIDPOINT_DEPTH 32
+#define PICK_STACK_SIZE 96
+
+PickQuad PickQuadFromCorners(const Vector3 corners[4]) {
+    PickQuad quad = {
+        .origin = corners[0],
+        .u = Vector3Subtract(corners[1], corners[0]),
+        .v = Vector3Subtract(corners[2], corners[0]),
+        .active = true,
+    };
+    quad.normal = Vector3Normalize(Vector3CrossProduct(quad.u, quad.v));
+
+    // Solving for the hit point's edge coordinates needs the inverse of the
+    // edges' Gram matrix; a degenerate quad can't be hit
+    quad.uu = Vector3DotProduct(quad.u, quad.u);
+    quad.uv = Vector3DotProduct(quad.u, quad.v);
+    quad.vv = Vector3DotProduct(quad.v, quad.v);
+    float det = quad.uu * quad.vv - quad.uv * quad.uv;
+    quad.inv_det = fabsf(det) > 1e-12f ? 1.0f / det : 0.0f;
+
+    Vector3 far = Vector3Add(corners[1], quad.v);
+    quad.bounds.min = Vector3Min(Vector3Min(corners[0], corners[1]), Vector3Min(corners[2], far));
+    quad.bounds.max = Vector3Max(Vector3Max(corners[0], corners[1]), Vector3Max(corners[2], far));
+    return quad;
+}
+
+RayCollision PickQuadCollision(Ray ray, const PickQuad *quad) {
+    RayCollision collision = {0};
+    if (quad->inv_det == 0.0f) return collision;
+
+    // Both sides count, like the triangle test
+    float denom = Vector3DotProduct(ray.direction, quad->normal);
+    if (fabsf(denom) < 1e-8f) return collision;
+
+    float t = Vector3DotProduct(Vector3Subtract(quad->origin, ray.position), quad->normal) / denom;
+    if (t <= 0.0f) return collision;
+
+    Vector3 point = Vector3Add(ray.position, Vector3Scale(ray.direction, t));
+    Vector3 d = Vector3Subtract(point, quad->origin);
+    float du = Vector3DotProduct(d, quad->u);
+    float dv = Vector3DotProduct(d, quad->v);
+    float s = (quad->vv * du - quad->uv * dv) * quad->inv_det;
+    float r = (quad->uu * dv - quad->uv * du) * quad->inv_det;
+    if (s < 0.0f || s > 1.0f || r < 0.0f || r > 1.0f) return collision;
+
+    collision.hit = true;
+    collision.distance = t; // like raylib, in units of the direction vector
+    collision.point = point;
+    collision.normal = quad->normal;
+    return collision;
+}
+
+static BoundingBox EmptyBounds(void) {
+    return (BoundingBox){{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+}
+
+static BoundingBox MergeBounds(BoundingBox a, BoundingBox b) {
+    return (BoundingBox){Vector3Min(a.min, b.min), Vector3Max(a.max, b.max)};
+}
+
+static float Axis(Vector3 v, int axis) {
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+static float Centroid(const PickQuad *quad, int axis) {
+    return (Axis(quad->bounds.min, axis) + Axis(quad->bounds.max, axis)) * 0.5f;
+}
+
+static int PushNode(PickIndex *index, int parent) {
+    if (index->node_count == index->node_capacity) {
+        int capacity = index->node_capacity == 0 ? 64 : index->node_capacity * 2;
+        PickNode *nodes = realloc(index->nodes, capacity * sizeof(PickNode));
+        if (nodes == NULL) {
+            fprintf(stderr, "Failed to allocate memory for pick index\n");
+            exit(1);
+        }
+        index->nodes = nodes;
+        index->node_capacity = capacity;
+    }
+    int node = index->node_count++;
+    index->nodes[node] = (PickNode){.left = -1, .right = -1, .parent = parent};
+    return node;
+}
+
+// Split at the middle of the centroids' extent along its longest axis, or
+// down the middle of the range when everything sits on the same spot
+static int BuildNode(PickIndex *index, int parent, int first, int count, int depth) {
+    int node = PushNode(index, parent);
+
+    BoundingBox bounds = EmptyBounds();
+    BoundingBox centroids = EmptyBounds();
+    for (int i = first; i < first + count; i++) {
+        const PickQuad *quad = &index->quads[index->order[i]];
+        Vector3 c = Vector3Scale(Vector3Add(quad->bounds.min, quad->bounds.max), 0.5f);
+        bounds = MergeBounds(bounds, quad->bounds);
+        centroids = MergeBounds(centroids, (BoundingBox){c, c});
+    }
+    index->nodes[node].bounds = bounds;
+
+    if (count <= PICK_LEAF_SIZE) {
+        index->nodes[node].first = first;
+        index->nodes[node].count = count;
+        for (int i = first; i < first + count; i++) {
+            index->leaf_of[index->order[i]] = node;
+        }
+        return node;
+    }
+
+    Vector3 extent = Vector3Subtract(centroids.max, centroids.min);
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    float split = (Axis(centroids.min, axis) + Axis(centroids.max, axis)) * 0.5f;
+
+    int mid = first;
+    for (int i = first; i < first + count; i++) {
+        if (Centroid(&index->quads[index->order[i]], axis) < split) {
+            int tmp = index->order[i];
+            index->order[i] = index->order[mid];
+            index->order[mid] = tmp;
+            mid++;
+        }
+    }
+    if (mid == first || mid == first + count || depth >= PICK_MIDPOINT_DEPTH) mid = first + count / 2;
+
+    int left = BuildNode(index, node, first, mid - first, depth + 1);
+    int right = BuildNode(index, node, mid, first + count - mid, depth + 1);
+    index->nodes[node].left = left;
+    index->nodes[node].right = right;
+    return node;
+}
+
+static void Rebuild(PickIndex *index) {
+    index->node_count = 0;
+    int active = 0;
+    for (int i = 0; i < index->count; i++) {
+        index->leaf_of[i] = -1;
+        if (index->quads[i].active) index->order[active++] = i;
+    }
+    if (active > 0) BuildNode(index, -1, 0, active, 0);
+    index->stale = false;
+}
+
+static void Refit(PickIndex *index, int node) {
+    PickNode *n = &index->nodes[node];
+    if (!n->dirty) return;
+    n->dirty = false;
+
+    if (n->left < 0) {
+        BoundingBox bounds = EmptyBounds();
+        for (int i = n->first; i < n->first + n->count; i++) {
+            bounds = MergeBounds(bounds, index->quads[index->order[i]].bounds);
+        }
+        n->bounds = bounds;
+        return;
+    }
+
+    Refit(index, n->left);
+    Refit(index, n->right);
+    n->bounds = MergeBounds(index->nodes[n->left].bounds, index->nodes[n->right].bounds);
+}
+
+static void Reserve(PickIndex *index, int count) {
+    if (count <= index->capacity) return;
+
+    int capacity = index->capacity == 0 ? 16 : index->capacity;
+    while (capacity < count) capacity *= 2;
+
+    PickQuad *quads = realloc(index->quads, capacity * sizeof(PickQuad));
+    int *leaf_of = quads ? realloc(index->leaf_of, capacity * sizeof(int)) : NULL;
+    int *order = leaf_of ? realloc(index->order, capacity * sizeof(int)) : NULL;
+    if (order == NULL) {
+        fprintf(stderr, "Failed to allocate memory for pick index\n");
+        exit(1);
+    }
+    index->quads = quads;
+    index->leaf_of = leaf_of;
+    index->order = order;
+    index->capacity = capacity;
+}
+
+void PickIndexSet(PickIndex *index, int item, const Vector3 corners[4]) {
+    if (item >= index->count) {
+        Reserve(index, item + 1);
+        for (int i = index->count; i <= item; i++) {
+            index->quads[i] = (PickQuad){0};
+            index->leaf_of[i] = -1;
+        }
+        index->count = item + 1;
+    }
+
+    bool added = !index->quads[item].active;
+    index->quads[item] = PickQuadFromCorners(corners);
+    if (added || index->stale) {
+        index->stale = true;
+        return;
+    }
+
+    // Mark the path to the root; the next cast refits just those nodes
+    for (int node = index->leaf_of[item]; node >= 0 && !index->nodes[node].dirty; node = index->nodes[node].parent) {
+        index->nodes[node].dirty = true;
+    }
+}
+
+void PickIndexRemove(PickIndex *index, int item) {
+    if (item < 0 || item >= index->count || !index->quads[item].active) return;
+    index->quads[item].active = false;
+    index->stale = true;
+}
+
+// Slab test; returns the entry distance, or FLT_MAX on a miss or when the box
+// starts beyond the closest hit so far
+static float RayBoxEntry(Vector3 origin, Vector3 inv_dir, BoundingBox box, float limit) {
+    float t1 = (box.min.x - origin.x) * inv_dir.x;
+    float t2 = (box.max.x - origin.x) * inv_dir.x;
+    float tmin = fminf(t1, t2), tmax = fmaxf(t1, t2);
+
+    t1 = (box.min.y - origin.y) * inv_dir.y;
+    t2 = (box.max.y - origin.y) * inv_dir.y;
+    tmin = fmaxf(tmin, fminf(t1, t2));
+    tmax = fminf(tmax, fmaxf(t1, t2));
+
+    t1 = (box.min.z - origin.z) * inv_dir.z;
+    t2 = (box.max.z - origin.z) * inv_dir.z;
+    tmin = fmaxf(tmin, fminf(t1, t2));
+    tmax = fminf(tmax, fmaxf(t1, t2));
+
+    if (tmax < 0.0f || tmin > tmax || tmin > limit) return FLT_MAX;
+    return tmin;
+}
+
+int PickIndexCast(PickIndex *index, Ray ray, RayCollision *collision) {
+    if (index->stale) Rebuild(index);
+    *collision = (RayCollision){0};
+    if (index->node_count == 0) return -1;
+    Refit(index, 0);
+
+    Vector3 inv_dir = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+
+    int best = -1;
+    float best_t = FLT_MAX;
+    int stack[PICK_STACK_SIZE];
+    int top = 0;
+    if (RayBoxEntry(ray.position, inv_dir, index->nodes[0].bounds, best_t) != FLT_MAX) stack[top++] = 0;
+
+    while (top > 0) {
+        const PickNode *node = &index->nodes[stack[--top]];
+
+        if (node->left < 0) {
+            for (int i = node->first; i < node->first + node->count; i++) {
+                int item = index->order[i];
+                RayCollision hit = PickQuadCollision(ray, &index->quads[item]);
+                if (hit.hit && hit.distance < best_t) {
+                    best_t = hit.distance;
+                    best = item;
+                    *collision = hit;
+                }
+            }
+            continue;
+        }
+
+        float tl = RayBoxEntry(ray.position, inv_dir, index->nodes[node->left].bounds, best_t);
+        float tr = RayBoxEntry(ray.position, inv_dir, index->nodes[node->right].bounds, best_t);
+
+        // Push the farther child first so the nearer one is searched first
+        // and its hits prune the other
+        if (tl <= tr) {
+            if (tr != FLT_MAX) stack[top++] = node->right;
+            if (tl != FLT_MAX) stack[top++] = node->left;
+        }
+        else {
+            if (tl != FLT_MAX) stack[top++] = node->left;
+            if (tr != FLT_MAX) stack[top++] = node->right;
+        }
+    }
+
+    return best;
+}
+
+void PickIndexFree(PickIndex *index) {
+    free(index->quads);
+    free(index->leaf_of);
+    free(index->order);
+    free(index->nodes);
+    memset(index, 0, sizeof(PickIndex));
+}
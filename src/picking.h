@@ -0,0 +1,60 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include "raylib.h"
+
+#include <stdbool.h>
+
+// Items per BVH leaf
+#define PICK_LEAF_SIZE 4
+
+// A window quad as a corner and its two edges, with what the ray test needs
+// precomputed. Covers any parallelogram, so scaled and sheared windows work.
+typedef struct {
+    Vector3 origin;
+    Vector3 u;
+    Vector3 v;
+    Vector3 normal;
+    float uu, uv, vv, inv_det;
+    BoundingBox bounds;
+    bool active;
+} PickQuad;
+
+typedef struct {
+    BoundingBox bounds;
+    int left;  // child nodes, -1 on leaves
+    int right;
+    int parent;
+    int first; // leaves: range of the index's order array
+    int count;
+    bool dirty;
+} PickNode;
+
+// Bounding volume hierarchy over window quads, addressed by item number.
+// Moving an item only refits the nodes above it; adding or removing items
+// rebuilds the tree on the next cast.
+typedef struct {
+    PickQuad *quads;
+    int *leaf_of; // item -> leaf node
+    int count;
+    int capacity;
+
+    PickNode *nodes;
+    int *order;
+    int node_count;
+    int node_capacity;
+    bool stale;
+} PickIndex;
+
+// corners as GetWindowCorners returns them: in mesh vertex order, where
+// corners[0] is adjacent to corners[1] and corners[2]
+PickQuad PickQuadFromCorners(const Vector3 corners[4]);
+RayCollision PickQuadCollision(Ray ray, const PickQuad *quad);
+
+void PickIndexSet(PickIndex *index, int item, const Vector3 corners[4]);
+void PickIndexRemove(PickIndex *index, int item);
+// Closest item the ray hits, -1 if none
+int PickIndexCast(PickIndex *index, Ray ray, RayCollision *collision);
+void PickIndexFree(PickIndex *index);
+
+#endif // PICKING_H
@@ -0,0 +1,200 @@
+#include "pixmap_texture.h"
+#include "capture.h"
+#include "rlgl.h"
+
+#include <GL/glx.h>
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    int depth;
+    bool searched;
+    bool found;
+    bool rgba;
+    GLXFBConfig config;
+} PixmapConfig;
+
+static Display *glx_display = NULL;
+static PFNGLXBINDTEXIMAGEEXTPROC BindTexImage = NULL;
+static PFNGLXRELEASETEXIMAGEEXTPROC ReleaseTexImage = NULL;
+
+// Binds between PixmapTextureBeginFrame and PixmapTextureEndFrame share one
+// error trap and one round trip
+static unsigned long frame = 0;
+static bool in_frame = false;
+static bool frame_failed = false;
+static int frame_binds = 0;
+
+// Windows are 24 bit, or 32 bit with an ARGB visual
+static PixmapConfig configs[] = {{.depth = 24}, {.depth = 32}};
+
+bool PixmapTextureInit(void) {
+    glx_display = glXGetCurrentDisplay();
+    if (glx_display == NULL) return false;
+
+    const char *extensions = glXQueryExtensionsString(glx_display, DefaultScreen(glx_display));
+    if (extensions == NULL || strstr(extensions, "GLX_EXT_texture_from_pixmap") == NULL) {
+        fprintf(stderr, "GLX_EXT_texture_from_pixmap unavailable, copying window contents\n");
+        glx_display = NULL;
+        return false;
+    }
+
+    BindTexImage = (PFNGLXBINDTEXIMAGEEXTPROC)glXGetProcAddress((const GLubyte *)"glXBindTexImageEXT");
+    ReleaseTexImage = (PFNGLXRELEASETEXIMAGEEXTPROC)glXGetProcAddress((const GLubyte *)"glXReleaseTexImageEXT");
+    if (BindTexImage == NULL || ReleaseTexImage == NULL) {
+        glx_display = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void FindConfig(PixmapConfig *pc) {
+    pc->searched = true;
+
+    int count = 0;
+    GLXFBConfig *all = glXGetFBConfigs(glx_display, DefaultScreen(glx_display), &count);
+    if (all == NULL) return;
+
+    for (int i = 0; i < count && !pc->found; i++) {
+        int value;
+        glXGetFBConfigAttrib(glx_display, all[i], GLX_DRAWABLE_TYPE, &value);
+        if (!(value & GLX_PIXMAP_BIT)) continue;
+
+        glXGetFBConfigAttrib(glx_display, all[i], GLX_BIND_TO_TEXTURE_TARGETS_EXT, &value);
+        if (!(value & GLX_TEXTURE_2D_BIT_EXT)) continue;
+
+        // Captured frames are uploaded top row first; only take configs
+        // whose textures come out the same way up
+        glXGetFBConfigAttrib(glx_display, all[i], GLX_Y_INVERTED_EXT, &value);
+        if (value == False) continue;
+
+        XVisualInfo *visual = glXGetVisualFromFBConfig(glx_display, all[i]);
+        if (visual == NULL) continue;
+        int depth = visual->depth;
+        XFree(visual);
+        if (depth != pc->depth) continue;
+
+        int rgba = False, rgb = False;
+        glXGetFBConfigAttrib(glx_display, all[i], GLX_BIND_TO_TEXTURE_RGBA_EXT, &rgba);
+        glXGetFBConfigAttrib(glx_display, all[i], GLX_BIND_TO_TEXTURE_RGB_EXT, &rgb);
+        if (depth == 32 ? !rgba : !(rgb || rgba)) continue;
+
+        pc->config = all[i];
+        pc->rgba = depth == 32 || !rgb;
+        pc->found = true;
+    }
+    XFree(all);
+}
+
+static PixmapConfig *GetConfig(int depth) {
+    if (glx_display == NULL) return NULL;
+
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        PixmapConfig *pc = &configs[i];
+        if (pc->depth != depth) continue;
+        if (!pc->searched) FindConfig(pc);
+        return pc->found ? pc : NULL;
+    }
+    return NULL;
+}
+
+bool PixmapTextureSupportsDepth(int depth) {
+    return GetConfig(depth) != NULL;
+}
+
+static void DestroyGlxPixmap(PixmapTexture *tex) {
+    if (tex->glx_pixmap == None) return;
+
+    rlEnableTexture(tex->id);
+    ReleaseTexImage(glx_display, tex->glx_pixmap, GLX_FRONT_LEFT_EXT);
+    rlDisableTexture();
+    glXDestroyPixmap(glx_display, tex->glx_pixmap);
+    tex->glx_pixmap = None;
+    tex->pixmap = None;
+}
+
+bool PixmapTextureBind(PixmapTexture *tex, Pixmap pixmap, int depth, int width, int height) {
+    PixmapConfig *pc = GetConfig(depth);
+    if (pc == NULL) return false;
+
+    if (tex->id == 0) {
+        // Storage is replaced by the pixmap on bind; this just reserves a name
+        tex->id = rlLoadTexture(NULL, 1, 1, RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1);
+        if (tex->id == 0) return false;
+    }
+
+    // The worker may free the pixmap (after renaming the window's new one)
+    // before we get to it; that only costs this frame, and the frame's trap
+    // catches it
+    if (tex->pixmap != pixmap) {
+        DestroyGlxPixmap(tex);
+
+        int attribs[] = {
+            GLX_TEXTURE_TARGET_EXT, GLX_TEXTURE_2D_EXT,
+            GLX_TEXTURE_FORMAT_EXT, pc->rgba ? GLX_TEXTURE_FORMAT_RGBA_EXT : GLX_TEXTURE_FORMAT_RGB_EXT,
+            None,
+        };
+        tex->glx_pixmap = glXCreatePixmap(glx_display, pc->config, pixmap, attribs);
+        tex->pixmap = pixmap;
+        tex->width = width;
+        tex->height = height;
+    }
+    else {
+        // Contents are only guaranteed to be current after a fresh bind
+        rlEnableTexture(tex->id);
+        ReleaseTexImage(glx_display, tex->glx_pixmap, GLX_FRONT_LEFT_EXT);
+        rlDisableTexture();
+    }
+
+    rlEnableTexture(tex->id);
+    BindTexImage(glx_display, tex->glx_pixmap, GLX_FRONT_LEFT_EXT, NULL);
+    rlDisableTexture();
+
+    tex->frame = frame;
+    frame_binds++;
+    return true;
+}
+
+void PixmapTextureBeginFrame(void) {
+    if (glx_display == NULL) return;
+    CaptureTrapErrors();
+    in_frame = true;
+    frame++;
+    frame_binds = 0;
+}
+
+bool PixmapTextureEndFrame(void) {
+    if (!in_frame) return true;
+    if (frame_binds > 0) XSync(glx_display, False);
+    in_frame = false;
+    frame_failed = !CaptureUntrapErrors();
+    return !frame_failed;
+}
+
+bool PixmapTextureDiscardFailed(PixmapTexture *tex) {
+    if (!frame_failed || tex->glx_pixmap == None || tex->frame != frame) return false;
+
+    CaptureTrapErrors();
+    DestroyGlxPixmap(tex);
+    XSync(glx_display, False);
+    CaptureUntrapErrors();
+    return true;
+}
+
+void PixmapTextureUnload(PixmapTexture *tex) {
+    if (glx_display != NULL && in_frame) {
+        // The frame's trap is already up, and traps don't nest
+        DestroyGlxPixmap(tex);
+    }
+    else if (glx_display != NULL) {
+        CaptureTrapErrors();
+        DestroyGlxPixmap(tex);
+        XSync(glx_display, False);
+        CaptureUntrapErrors();
+    }
+    if (tex->id != 0) {
+        rlUnloadTexture(tex->id);
+    }
+    memset(tex, 0, sizeof(PixmapTexture));
+}
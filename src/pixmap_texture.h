@@ -0,0 +1,36 @@
+#ifndef PIXMAP_TEXTURE_H
+#define PIXMAP_TEXTURE_H
+
+#include <X11/Xlib.h>
+
+#include <stdbool.h>
+
+// A redirected window's pixmap bound as a GL texture through
+// GLX_EXT_texture_from_pixmap, so its contents never pass through our memory
+typedef struct {
+    Pixmap pixmap;
+    XID glx_pixmap;
+    unsigned int id; // GL texture, kept across pixmaps
+    unsigned long frame; // of the last bind
+    int width;
+    int height;
+} PixmapTexture;
+
+// Call once after InitWindow. False when the context isn't GLX or the
+// extension is missing.
+bool PixmapTextureInit(void);
+bool PixmapTextureSupportsDepth(int depth);
+
+// Bind pixmap to the texture, or rebind it to pick up new contents. Binds
+// don't wait for the server; call them between PixmapTextureBeginFrame and
+// PixmapTextureEndFrame, which waits once for the whole frame's and returns
+// false if any failed, e.g. because a pixmap was already replaced by a newer
+// one. PixmapTextureDiscardFailed then drops the texture's pixmap if it was
+// bound in that frame, and returns whether it did.
+bool PixmapTextureBind(PixmapTexture *tex, Pixmap pixmap, int depth, int width, int height);
+void PixmapTextureBeginFrame(void);
+bool PixmapTextureEndFrame(void);
+bool PixmapTextureDiscardFailed(PixmapTexture *tex);
+void PixmapTextureUnload(PixmapTexture *tex);
+
+#endif // PIXMAP_TEXTURE_H
@@ -0,0 +1,229 @@
+#include "profile.h"
+
+#ifdef PROFILE_ENABLED
+
+#include <stdatomic.h>
+#include <time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Spans in flight between the recording threads and ProfileCollect. Several
+// frames' worth, so a slow frame doesn't lose any.
+#define RING_SIZE 16384
+// Spans per stage the percentiles are taken over
+#define WINDOW_SIZE 512
+// How often the percentiles and rates are recomputed
+#define STATS_INTERVAL_NS 500000000ull
+
+// seq is the span's index in the ring plus one once it's fully written, 0
+// while it's being written
+typedef struct {
+    atomic_uint_least64_t seq;
+    atomic_uint_least64_t start;
+    atomic_uint_least64_t end;
+    atomic_uint stage_thread; // stage in the low byte, thread above it
+} ProfileSlot;
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    unsigned char stage;
+    unsigned int thread;
+} ProfileSpan;
+
+static ProfileSlot ring[RING_SIZE];
+static atomic_uint_least64_t ring_head;
+static atomic_uint_least64_t counters[PROFILE_COUNTER_COUNT];
+static atomic_uint next_thread = 1;
+static _Thread_local unsigned int thread_id;
+
+// Render thread only
+static uint64_t ring_tail;
+static float window[PROFILE_STAGE_COUNT][WINDOW_SIZE];
+static int window_count[PROFILE_STAGE_COUNT];
+static int window_next[PROFILE_STAGE_COUNT];
+static ProfileStats stats;
+static uint64_t stats_time;
+static uint64_t stats_counters[PROFILE_COUNTER_COUNT];
+
+static bool tracing;
+static uint64_t trace_start;
+static ProfileSpan *trace;
+static size_t trace_count;
+static size_t trace_capacity;
+
+static const char *stage_names[PROFILE_STAGE_COUNT] = {
+    [PROFILE_FRAME] = "frame",
+    [PROFILE_CAPTURE] = "capture",
+    [PROFILE_SWIZZLE] = "swizzle",
+    [PROFILE_UPLOAD] = "upload",
+    [PROFILE_PICK] = "pick",
+    [PROFILE_BILLBOARD] = "billboard",
+    [PROFILE_OCCLUSION] = "occlusion",
+    [PROFILE_DRAW] = "draw",
+};
+
+uint64_t ProfileNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void ProfileRecord(ProfileStage stage, uint64_t start, uint64_t end) {
+    if (thread_id == 0) thread_id = atomic_fetch_add(&next_thread, 1);
+
+    uint64_t n = atomic_fetch_add_explicit(&ring_head, 1, memory_order_relaxed);
+    ProfileSlot *slot = &ring[n % RING_SIZE];
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->start, start, memory_order_relaxed);
+    atomic_store_explicit(&slot->end, end, memory_order_relaxed);
+    atomic_store_explicit(&slot->stage_thread, stage | thread_id << 8, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, n + 1, memory_order_release);
+}
+
+void ProfileCount(ProfileCounter counter, uint64_t amount) {
+    atomic_fetch_add_explicit(&counters[counter], amount, memory_order_relaxed);
+}
+
+static void TraceAppend(const ProfileSpan *span) {
+    if (trace_count == trace_capacity) {
+        size_t capacity = trace_capacity == 0 ? 4096 : trace_capacity * 2;
+        ProfileSpan *grown = realloc(trace, capacity * sizeof(ProfileSpan));
+        if (grown == NULL) {
+            fprintf(stderr, "Failed to allocate memory for trace, stopping it\n");
+            tracing = false;
+            return;
+        }
+        trace = grown;
+        trace_capacity = capacity;
+    }
+    trace[trace_count++] = *span;
+}
+
+// Copy out the span at index n. False if it isn't written yet (try again
+// later) or was already written over (skip it), told apart by seq.
+static bool ReadSlot(uint64_t n, ProfileSpan *span, bool *lapped) {
+    ProfileSlot *slot = &ring[n % RING_SIZE];
+    uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    span->start = atomic_load_explicit(&slot->start, memory_order_relaxed);
+    span->end = atomic_load_explicit(&slot->end, memory_order_relaxed);
+    unsigned int stage_thread = atomic_load_explicit(&slot->stage_thread, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t again = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    *lapped = seq > n + 1 || again > n + 1;
+    if (seq != n + 1 || again != n + 1) return false;
+    span->stage = stage_thread & 0xff;
+    span->thread = stage_thread >> 8;
+    return true;
+}
+
+static int CompareFloat(const void *a, const void *b) {
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static void UpdateStats(uint64_t now) {
+    float sorted[WINDOW_SIZE];
+    for (int s = 0; s < PROFILE_STAGE_COUNT; s++) {
+        int count = window_count[s];
+        ProfileStageStats *out = &stats.stages[s];
+        out->samples = count;
+        if (count == 0) {
+            out->p50_ms = out->p99_ms = out->max_ms = 0.0f;
+            continue;
+        }
+        memcpy(sorted, window[s], count * sizeof(float));
+        qsort(sorted, count, sizeof(float), CompareFloat);
+        out->p50_ms = sorted[count / 2];
+        out->p99_ms = sorted[(count * 99) / 100];
+        out->max_ms = sorted[count - 1];
+    }
+
+    double seconds = (now - stats_time) / 1e9;
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+        uint64_t total = atomic_load_explicit(&counters[c], memory_order_relaxed);
+        stats.per_second[c] = stats_time == 0 ? 0.0 : (total - stats_counters[c]) / seconds;
+        stats_counters[c] = total;
+    }
+    stats_time = now;
+}
+
+void ProfileCollect(void) {
+    uint64_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    // Whatever the writers already went around past is gone
+    if (head - ring_tail > RING_SIZE) ring_tail = head - RING_SIZE;
+
+    for (; ring_tail < head; ring_tail++) {
+        ProfileSpan span;
+        bool lapped;
+        if (!ReadSlot(ring_tail, &span, &lapped)) {
+            if (lapped) continue;
+            break;
+        }
+
+        int s = span.stage;
+        window[s][window_next[s]] = (span.end - span.start) / 1e6f;
+        window_next[s] = (window_next[s] + 1) % WINDOW_SIZE;
+        if (window_count[s] < WINDOW_SIZE) window_count[s]++;
+
+        if (tracing && span.start >= trace_start) TraceAppend(&span);
+    }
+
+    uint64_t now = ProfileNow();
+    if (now - stats_time >= STATS_INTERVAL_NS) UpdateStats(now);
+}
+
+const ProfileStats *ProfileGetStats(void) {
+    return &stats;
+}
+
+const char *ProfileStageName(ProfileStage stage) {
+    return stage_names[stage];
+}
+
+void ProfileTraceStart(void) {
+    tracing = true;
+    trace_start = ProfileNow();
+    trace_count = 0;
+}
+
+bool ProfileTraceRecording(void) {
+    return tracing;
+}
+
+bool ProfileTraceStop(const char *path) {
+    tracing = false;
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to write trace to %s\n", path);
+        return false;
+    }
+
+    // Complete events, in microseconds from the start of the recording
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < trace_count; i++) {
+        const ProfileSpan *span = &trace[i];
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}%s\n",
+                stage_names[span->stage], (span->start - trace_start) / 1e3, (span->end - span->start) / 1e3,
+                span->thread, i + 1 < trace_count ? "," : "");
+    }
+    fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool ok = ferror(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) fprintf(stderr, "Unable to write trace to %s\n", path);
+
+    free(trace);
+    trace = NULL;
+    trace_count = 0;
+    trace_capacity = 0;
+    return ok;
+}
+
+#endif // PROFILE_ENABLED
@@ -0,0 +1,77 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    PROFILE_FRAME,     // one whole pass of the main loop
+    PROFILE_CAPTURE,   // X requests on a capture worker
+    PROFILE_SWIZZLE,   // converting captured pixels into a frame
+    PROFILE_UPLOAD,    // one window's texture update
+    PROFILE_PICK,
+    PROFILE_BILLBOARD,
+    PROFILE_OCCLUSION,
+    PROFILE_DRAW,
+    PROFILE_STAGE_COUNT,
+} ProfileStage;
+
+typedef enum {
+    PROFILE_BYTES_CAPTURED,
+    PROFILE_BYTES_UPLOADED,
+    PROFILE_COUNTER_COUNT,
+} ProfileCounter;
+
+// Build with PROFILE_ENABLED (premake --profile) to time the stages. Without
+// it the macros expand to nothing and none of this is compiled in.
+//
+//     PROFILE_BEGIN(PROFILE_DRAW);
+//     DrawWindows(wm);
+//     PROFILE_END(PROFILE_DRAW);
+//
+// Any thread can record. Spans go into a lock-free ring that the render
+// thread drains once a frame with ProfileCollect.
+#ifdef PROFILE_ENABLED
+
+#define PROFILE_BEGIN(stage) uint64_t profile_start_##stage = ProfileNow()
+#define PROFILE_END(stage) ProfileRecord(stage, profile_start_##stage, ProfileNow())
+#define PROFILE_COUNT(counter, amount) ProfileCount(counter, amount)
+
+typedef struct {
+    float p50_ms;
+    float p99_ms;
+    float max_ms;
+    int samples;
+} ProfileStageStats;
+
+// Over the last few hundred spans of each stage
+typedef struct {
+    ProfileStageStats stages[PROFILE_STAGE_COUNT];
+    double per_second[PROFILE_COUNTER_COUNT];
+} ProfileStats;
+
+// Monotonic nanoseconds
+uint64_t ProfileNow(void);
+void ProfileRecord(ProfileStage stage, uint64_t start, uint64_t end);
+void ProfileCount(ProfileCounter counter, uint64_t amount);
+
+// Render thread only from here on
+void ProfileCollect(void);
+const ProfileStats *ProfileGetStats(void);
+const char *ProfileStageName(ProfileStage stage);
+
+// Keep every span collected until ProfileTraceStop, which writes them out as
+// Chrome trace JSON (chrome://tracing, Perfetto)
+void ProfileTraceStart(void);
+bool ProfileTraceStop(const char *path);
+bool ProfileTraceRecording(void);
+
+#else
+
+#define PROFILE_BEGIN(stage) ((void)0)
+#define PROFILE_END(stage) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+
+#endif // PROFILE_ENABLED
+
+#endif // PROFILE_H
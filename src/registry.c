@@ -0,0 +1,159 @@
+#include "registry.h"
+#include "raymath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_SLOT UINT32_MAX
+
+void WindowRegistryInit(WindowRegistry *reg, size_t payload_size) {
+    memset(reg, 0, sizeof(WindowRegistry));
+    reg->payload_size = payload_size;
+    reg->free_slot = NO_SLOT;
+}
+
+void WindowRegistryFree(WindowRegistry *reg) {
+    free(reg->transform);
+    free(reg->size);
+    free(reg->texture);
+    free(reg->schedule);
+    free(reg->flags);
+    free(reg->slot_of);
+    free(reg->payload);
+    free(reg->index_of);
+    free(reg->generation);
+    WindowRegistryInit(reg, reg->payload_size);
+}
+
+static void *Grow(void *column, int capacity, size_t size) {
+    void *grown = realloc(column, (size_t)capacity * size);
+    if (grown == NULL) {
+        fprintf(stderr, "Failed to allocate memory for window registry\n");
+        exit(1);
+    }
+    return grown;
+}
+
+static void Reserve(WindowRegistry *reg) {
+    if (reg->count < reg->capacity) return;
+
+    int capacity = reg->capacity == 0 ? 16 : reg->capacity * 2;
+    reg->transform = Grow(reg->transform, capacity, sizeof(Matrix));
+    reg->size = Grow(reg->size, capacity, sizeof(Vector2));
+    reg->texture = Grow(reg->texture, capacity, sizeof(Texture));
+    reg->schedule = Grow(reg->schedule, capacity, sizeof(WindowSchedule));
+    reg->flags = Grow(reg->flags, capacity, sizeof(unsigned char));
+    reg->slot_of = Grow(reg->slot_of, capacity, sizeof(uint32_t));
+    if (reg->payload_size > 0) {
+        reg->payload = Grow(reg->payload, capacity, reg->payload_size);
+    }
+    reg->capacity = capacity;
+}
+
+static uint32_t TakeSlot(WindowRegistry *reg) {
+    if (reg->free_slot != NO_SLOT) {
+        uint32_t slot = reg->free_slot;
+        reg->free_slot = reg->index_of[slot];
+        return slot;
+    }
+
+    if (reg->slot_count == reg->slot_capacity) {
+        int capacity = reg->slot_capacity == 0 ? 16 : reg->slot_capacity * 2;
+        reg->index_of = Grow(reg->index_of, capacity, sizeof(uint32_t));
+        reg->generation = Grow(reg->generation, capacity, sizeof(uint32_t));
+        reg->slot_capacity = capacity;
+    }
+    reg->generation[reg->slot_count] = 0;
+    return reg->slot_count++;
+}
+
+WindowHandle WindowRegistryAdd(WindowRegistry *reg) {
+    Reserve(reg);
+
+    uint32_t slot = TakeSlot(reg);
+    if (++reg->generation[slot] == 0) reg->generation[slot] = 1;
+
+    int i = reg->count++;
+    reg->index_of[slot] = i;
+    reg->slot_of[i] = slot;
+
+    reg->transform[i] = (Matrix){1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    reg->size[i] = (Vector2){0};
+    reg->texture[i] = (Texture){0};
+    memset(&reg->schedule[i], 0, sizeof(WindowSchedule));
+    reg->flags[i] = 0;
+    if (reg->payload_size > 0) {
+        memset(WindowRegistryPayload(reg, i), 0, reg->payload_size);
+    }
+
+    return (WindowHandle){slot, reg->generation[slot]};
+}
+
+void WindowRegistryRemove(WindowRegistry *reg, WindowHandle handle) {
+    int i = WindowRegistryIndex(reg, handle);
+    if (i < 0) return;
+
+    // Fill the hole with the last window
+    int last = --reg->count;
+    if (i != last) {
+        reg->transform[i] = reg->transform[last];
+        reg->size[i] = reg->size[last];
+        reg->texture[i] = reg->texture[last];
+        reg->schedule[i] = reg->schedule[last];
+        reg->flags[i] = reg->flags[last];
+        reg->slot_of[i] = reg->slot_of[last];
+        if (reg->payload_size > 0) {
+            memcpy(WindowRegistryPayload(reg, i), WindowRegistryPayload(reg, last), reg->payload_size);
+        }
+        reg->index_of[reg->slot_of[i]] = i;
+    }
+
+    // Bumping the generation is what invalidates outstanding handles
+    reg->generation[handle.slot]++;
+    reg->index_of[handle.slot] = reg->free_slot;
+    reg->free_slot = handle.slot;
+}
+
+int WindowRegistryIndex(const WindowRegistry *reg, WindowHandle handle) {
+    if (handle.generation == 0 || handle.slot >= (uint32_t)reg->slot_count) return -1;
+    if (reg->generation[handle.slot] != handle.generation) return -1;
+    return reg->index_of[handle.slot];
+}
+
+int WindowRegistrySlotIndex(const WindowRegistry *reg, uint32_t slot) {
+    if (slot >= (uint32_t)reg->slot_count) return -1;
+    return WindowRegistryIndex(reg, (WindowHandle){slot, reg->generation[slot]});
+}
+
+WindowHandle WindowRegistryHandle(const WindowRegistry *reg, int index) {
+    if (index < 0 || index >= reg->count) return WINDOW_HANDLE_NONE;
+    uint32_t slot = reg->slot_of[index];
+    return (WindowHandle){slot, reg->generation[slot]};
+}
+
+void GetWindowCorners(const WindowRegistry *reg, int i, Vector3 corners[4]) {
+    float x = reg->size[i].x / 2.0f;
+    float z = reg->size[i].y / 2.0f;
+    Matrix transform = reg->transform[i];
+
+    corners[0] = Vector3Transform((Vector3){-x, 0.0f, -z}, transform);
+    corners[1] = Vector3Transform((Vector3){x, 0.0f, -z}, transform);
+    corners[2] = Vector3Transform((Vector3){-x, 0.0f, z}, transform);
+    corners[3] = Vector3Transform((Vector3){x, 0.0f, z}, transform);
+}
+
+Vector3 GetWindowNormal(const WindowRegistry *reg, int i) {
+    Matrix transform = reg->transform[i];
+
+    // The window faces +Y in its local space
+    Vector3 normal = Vector3Transform((Vector3){0, 1, 0}, transform);
+    Vector3 transformedVec = Vector3Transform((Vector3){0, 0, 0}, transform);
+    normal = Vector3Subtract(normal, transformedVec);
+    return Vector3Normalize(normal);
+}
+
+Vector3 GetWindowCenter(const WindowRegistry *reg, int i) {
+    // The quad is centered on its local origin
+    return Vector3Transform((Vector3){0, 0, 0}, reg->transform[i]);
+}
@@ -0,0 +1,73 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "raylib.h"
+#include "scheduler.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WINDOW_VISIBLE 0x1
+#define WINDOW_OCCLUDED 0x2 // behind other windows as of the last schedule
+
+// Refers to a window for as long as it exists. Once it's removed the handle
+// stops resolving, even after its slot is reused by another window.
+typedef struct {
+    uint32_t slot;
+    uint32_t generation; // never 0 for a live window
+} WindowHandle;
+
+#define WINDOW_HANDLE_NONE ((WindowHandle){0, 0})
+
+// Windows stored column by column, densely packed: index i of every column
+// is the same window, and per-frame passes walk the columns front to back.
+// Removing a window moves the last one into its place, so indices are only
+// good until the next removal; hold on to handles instead.
+typedef struct {
+    int count;
+    int capacity;
+
+    Matrix *transform;
+    Vector2 *size; // quad width and height in world units
+    Texture *texture;
+    WindowSchedule *schedule;
+    unsigned char *flags;
+    uint32_t *slot_of; // index -> slot
+
+    // Whatever else the owner keeps per window, payload_size bytes each
+    unsigned char *payload;
+    size_t payload_size;
+
+    // Slot -> index for live slots; free slots chain through it instead
+    uint32_t *index_of;
+    uint32_t *generation;
+    int slot_count;
+    int slot_capacity;
+    uint32_t free_slot;
+} WindowRegistry;
+
+void WindowRegistryInit(WindowRegistry *reg, size_t payload_size);
+void WindowRegistryFree(WindowRegistry *reg);
+
+// New windows start out zeroed apart from an identity transform, and are
+// added at index count - 1
+WindowHandle WindowRegistryAdd(WindowRegistry *reg);
+void WindowRegistryRemove(WindowRegistry *reg, WindowHandle handle);
+
+// -1 once the window is gone
+int WindowRegistryIndex(const WindowRegistry *reg, WindowHandle handle);
+int WindowRegistrySlotIndex(const WindowRegistry *reg, uint32_t slot);
+WindowHandle WindowRegistryHandle(const WindowRegistry *reg, int index);
+
+static inline void *WindowRegistryPayload(const WindowRegistry *reg, int index) {
+    return reg->payload + (size_t)index * reg->payload_size;
+}
+
+// World space corners of the window quad, in the order GenMeshPlane lays out
+// its vertices: the window lies in its local XZ plane, facing +Y
+void GetWindowCorners(const WindowRegistry *reg, int i, Vector3 corners[4]);
+Vector3 GetWindowNormal(const WindowRegistry *reg, int i);
+Vector3 GetWindowCenter(const WindowRegistry *reg, int i);
+
+#endif // REGISTRY_H
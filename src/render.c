@@ -0,0 +1,205 @@
+#include "render.h"
+#include "raymath.h"
+#include "rlgl.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Corner markers, in world units, and the border, in pixels
+#define MARKER_RADIUS 0.04f
+#define BORDER_PIXELS 1.5f
+
+enum {
+    ATTRIB_CORNER,
+    ATTRIB_ORIGIN,
+    ATTRIB_U,
+    ATTRIB_V,
+    ATTRIB_SLOT,
+    ATTRIB_BORDER,
+};
+
+static const char *vertex_shader =
+    "#version 330\n"
+    "layout(location = 0) in vec2 corner;\n"
+    "layout(location = 1) in vec3 origin;\n"
+    "layout(location = 2) in vec3 edgeU;\n"
+    "layout(location = 3) in vec3 edgeV;\n"
+    "layout(location = 4) in float slot;\n"
+    "layout(location = 5) in vec4 border;\n"
+    "uniform mat4 mvp;\n"
+    "out vec2 fragTexCoord;\n"
+    "out vec2 fragSize;\n"
+    "out vec4 fragBorder;\n"
+    "flat out int fragSlot;\n"
+    "void main() {\n"
+    "    fragTexCoord = corner;\n"
+    "    fragSize = vec2(length(edgeU), length(edgeV));\n"
+    "    fragBorder = border;\n"
+    "    fragSlot = int(slot);\n"
+    "    gl_Position = mvp * vec4(origin + corner.x * edgeU + corner.y * edgeV, 1.0);\n"
+    "}\n";
+
+// GLSL 3.30 only allows constant sampler array indices, hence the switch
+static const char *fragment_shader =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec2 fragSize;\n"
+    "in vec4 fragBorder;\n"
+    "flat in int fragSlot;\n"
+    "uniform sampler2D textures[16];\n"
+    "uniform float borderPixels;\n"
+    "uniform float markerRadius;\n"
+    "out vec4 finalColor;\n"
+    "vec4 Sample(vec2 uv) {\n"
+    "    switch (fragSlot) {\n"
+    "        case 0: return texture(textures[0], uv);\n"
+    "        case 1: return texture(textures[1], uv);\n"
+    "        case 2: return texture(textures[2], uv);\n"
+    "        case 3: return texture(textures[3], uv);\n"
+    "        case 4: return texture(textures[4], uv);\n"
+    "        case 5: return texture(textures[5], uv);\n"
+    "        case 6: return texture(textures[6], uv);\n"
+    "        case 7: return texture(textures[7], uv);\n"
+    "        case 8: return texture(textures[8], uv);\n"
+    "        case 9: return texture(textures[9], uv);\n"
+    "        case 10: return texture(textures[10], uv);\n"
+    "        case 11: return texture(textures[11], uv);\n"
+    "        case 12: return texture(textures[12], uv);\n"
+    "        case 13: return texture(textures[13], uv);\n"
+    "        case 14: return texture(textures[14], uv);\n"
+    "        default: return texture(textures[15], uv);\n"
+    "    }\n"
+    "}\n"
+    "const vec4 markers[4] = vec4[4](\n"
+    "    vec4(0.90, 0.16, 0.22, 1.0), vec4(0.99, 0.98, 0.0, 1.0),\n"
+    "    vec4(0.0, 0.89, 0.19, 1.0), vec4(0.0, 0.47, 0.95, 1.0));\n"
+    "void main() {\n"
+    "    vec4 color = Sample(fragTexCoord);\n"
+    "    vec2 fromEdge = min(fragTexCoord, 1.0 - fragTexCoord);\n"
+    "    vec2 pixels = fromEdge / fwidth(fragTexCoord);\n"
+    "    if (min(pixels.x, pixels.y) < borderPixels) color = fragBorder;\n"
+    "    if (length(fromEdge * fragSize) < markerRadius) {\n"
+    "        int corner = int(fragTexCoord.x > 0.5) + 2 * int(fragTexCoord.y > 0.5);\n"
+    "        color = markers[corner];\n"
+    "    }\n"
+    "    finalColor = color;\n"
+    "}\n";
+
+bool WindowRendererInit(WindowRenderer *r) {
+    memset(r, 0, sizeof(WindowRenderer));
+    if (rlGetVersion() != RL_OPENGL_33 && rlGetVersion() != RL_OPENGL_43) {
+        TraceLog(LOG_INFO, "RENDER: Instancing needs OpenGL 3.3, drawing windows one by one");
+        return false;
+    }
+
+    r->shader = rlLoadShaderCode(vertex_shader, fragment_shader);
+    if (r->shader == 0) {
+        TraceLog(LOG_WARNING, "RENDER: Unable to compile window shader, drawing windows one by one");
+        return false;
+    }
+    r->mvp_loc = rlGetLocationUniform(r->shader, "mvp");
+
+    rlEnableShader(r->shader);
+    int units[RENDER_BATCH_SIZE];
+    for (int i = 0; i < RENDER_BATCH_SIZE; i++) {
+        units[i] = i;
+    }
+    rlSetUniform(rlGetLocationUniform(r->shader, "textures"), units, RL_SHADER_UNIFORM_INT, RENDER_BATCH_SIZE);
+    float border = BORDER_PIXELS;
+    float radius = MARKER_RADIUS;
+    rlSetUniform(rlGetLocationUniform(r->shader, "borderPixels"), &border, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlSetUniform(rlGetLocationUniform(r->shader, "markerRadius"), &radius, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlDisableShader();
+
+    // Two triangles over the unit square, matching GenMeshPlane's texcoords
+    static const float quad[12] = {0, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 1};
+
+    r->vao = rlLoadVertexArray();
+    rlEnableVertexArray(r->vao);
+
+    r->quad_vbo = rlLoadVertexBuffer(quad, sizeof(quad), false);
+    rlSetVertexAttribute(ATTRIB_CORNER, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(ATTRIB_CORNER);
+
+    r->instance_vbo = rlLoadVertexBuffer(NULL, sizeof(r->instances), true);
+    int stride = sizeof(WindowInstance);
+    rlSetVertexAttribute(ATTRIB_ORIGIN, 3, RL_FLOAT, false, stride, offsetof(WindowInstance, origin));
+    rlSetVertexAttribute(ATTRIB_U, 3, RL_FLOAT, false, stride, offsetof(WindowInstance, u));
+    rlSetVertexAttribute(ATTRIB_V, 3, RL_FLOAT, false, stride, offsetof(WindowInstance, v));
+    rlSetVertexAttribute(ATTRIB_SLOT, 1, RL_FLOAT, false, stride, offsetof(WindowInstance, slot));
+    rlSetVertexAttribute(ATTRIB_BORDER, 4, RL_UNSIGNED_BYTE, true, stride, offsetof(WindowInstance, border));
+    for (int a = ATTRIB_ORIGIN; a <= ATTRIB_BORDER; a++) {
+        rlEnableVertexAttribute(a);
+        rlSetVertexAttributeDivisor(a, 1);
+    }
+
+    rlDisableVertexArray();
+    TraceLog(LOG_INFO, "RENDER: Drawing windows instanced, %d per draw call", RENDER_BATCH_SIZE);
+    return true;
+}
+
+void WindowRendererUnload(WindowRenderer *r) {
+    if (r->shader == 0) return;
+    rlUnloadVertexArray(r->vao);
+    rlUnloadVertexBuffer(r->quad_vbo);
+    rlUnloadVertexBuffer(r->instance_vbo);
+    rlUnloadShaderProgram(r->shader);
+    memset(r, 0, sizeof(WindowRenderer));
+}
+
+void WindowRendererBegin(WindowRenderer *r) {
+    r->count = 0;
+    r->draw_calls = 0;
+}
+
+static void Flush(WindowRenderer *r) {
+    if (r->count == 0) return;
+
+    // Whatever raylib has queued goes first, with its own state
+    rlDrawRenderBatchActive();
+
+    rlEnableShader(r->shader);
+    rlSetUniformMatrix(r->mvp_loc, MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+    for (int i = 0; i < r->count; i++) {
+        rlActiveTextureSlot(i);
+        rlEnableTexture(r->textures[i]);
+    }
+
+    rlEnableVertexArray(r->vao);
+    rlUpdateVertexBuffer(r->instance_vbo, r->instances, r->count * sizeof(WindowInstance), 0);
+
+    // Windows can be seen from behind too
+    rlDisableBackfaceCulling();
+    rlDrawVertexArrayInstanced(0, 6, r->count);
+    rlEnableBackfaceCulling();
+
+    rlDisableVertexArray();
+    for (int i = r->count - 1; i >= 0; i--) {
+        rlActiveTextureSlot(i);
+        rlDisableTexture();
+    }
+    rlDisableShader();
+
+    r->draw_calls++;
+    r->count = 0;
+}
+
+void WindowRendererAdd(WindowRenderer *r, const Vector3 corners[4], unsigned int texture, Color border) {
+    if (r->count == RENDER_BATCH_SIZE) Flush(r);
+
+    Vector3 u = Vector3Subtract(corners[1], corners[0]);
+    Vector3 v = Vector3Subtract(corners[2], corners[0]);
+    r->instances[r->count] = (WindowInstance){
+        .origin = {corners[0].x, corners[0].y, corners[0].z},
+        .u = {u.x, u.y, u.z},
+        .v = {v.x, v.y, v.z},
+        .slot = (float)r->count,
+        .border = {border.r, border.g, border.b, border.a},
+    };
+    r->textures[r->count] = texture != 0 ? texture : rlGetTextureIdDefault();
+    r->count++;
+}
+
+void WindowRendererEnd(WindowRenderer *r) {
+    Flush(r);
+}
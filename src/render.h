@@ -0,0 +1,46 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "raylib.h"
+
+#include <stdbool.h>
+
+// Windows per draw call; each one gets its own texture unit
+#define RENDER_BATCH_SIZE 16
+
+typedef struct {
+    float origin[3];
+    float u[3];
+    float v[3];
+    float slot;
+    unsigned char border[4];
+} WindowInstance;
+
+// Draws window quads instanced, RENDER_BATCH_SIZE to a draw call. Borders
+// and corner markers are drawn by the same shader instead of as lines and
+// spheres.
+typedef struct {
+    unsigned int shader;
+    int mvp_loc;
+    unsigned int vao;
+    unsigned int quad_vbo;
+    unsigned int instance_vbo;
+
+    WindowInstance instances[RENDER_BATCH_SIZE];
+    unsigned int textures[RENDER_BATCH_SIZE];
+    int count;
+    int draw_calls; // this frame, for the curious
+} WindowRenderer;
+
+// Call after InitWindow. False when instancing isn't available (anything
+// before GL 3.3); draw windows with DrawModel then.
+bool WindowRendererInit(WindowRenderer *r);
+void WindowRendererUnload(WindowRenderer *r);
+
+// Between BeginMode3D and EndMode3D. corners are in mesh vertex order, as
+// GetWindowCorners returns them; texture 0 draws plain white.
+void WindowRendererBegin(WindowRenderer *r);
+void WindowRendererAdd(WindowRenderer *r, const Vector3 corners[4], unsigned int texture, Color border);
+void WindowRendererEnd(WindowRenderer *r);
+
+#endif // RENDER_H
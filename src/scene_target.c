@@ -0,0 +1,137 @@
+#include "scene_target.h"
+#include "rlgl.h"
+
+#if defined(GRAPHICS_API_OPENGL_33) || defined(GRAPHICS_API_OPENGL_43)
+#define SCENE_TIMER_QUERIES 1
+#include "external/glad.h" // function pointers are loaded by rlgl
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#define SETTLE_FRAMES 8  // timed frames at a scale before changing it again
+#define SCALE_STEP 0.05f // back up, once there's room
+#define HEADROOM 0.75f   // of target_ms, to scale up below
+#define MAX_DROP 0.75f   // of the scale, in one step
+
+static int Scaled(const SceneTarget *scene, int size) {
+    int scaled = (int)(size * scene->scale + 0.5f);
+    return scaled > 0 ? scaled : 1;
+}
+
+static void Adjust(SceneTarget *scene, float ms) {
+    scene->scene_ms = scene->samples == 0 ? ms : scene->scene_ms + (ms - scene->scene_ms) * 0.2f;
+    if (scene->samples < SETTLE_FRAMES) scene->samples++;
+    if (scene->samples < SETTLE_FRAMES) return;
+
+    float scale = scene->scale;
+    if (scene->scene_ms > scene->target_ms) {
+        // Most of the cost is per pixel, which goes with the square of the scale
+        scale *= fmaxf(sqrtf(scene->target_ms / scene->scene_ms), MAX_DROP);
+    }
+    else if (scene->scene_ms < scene->target_ms * HEADROOM) {
+        scale += SCALE_STEP;
+    }
+    scale = fminf(fmaxf(scale, SCENE_MIN_SCALE), 1.0f);
+    if (fabsf(scale - scene->scale) < 0.01f) return;
+
+    scene->scale = scale;
+    scene->samples = 0;
+}
+
+static void ReadQueries(SceneTarget *scene) {
+#ifdef SCENE_TIMER_QUERIES
+    while (scene->read != scene->begun) {
+        int i = scene->read % SCENE_QUERIES;
+        GLint available = 0;
+        glGetQueryObjectiv(scene->queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(scene->queries[i], GL_QUERY_RESULT, &ns);
+        scene->read++;
+        // Frames still in flight from before the last change don't count
+        if (scene->query_scale[i] == scene->scale) Adjust(scene, ns / 1e6f);
+    }
+#else
+    (void)scene;
+#endif
+}
+
+bool SceneTargetInit(SceneTarget *scene, float target_ms) {
+    memset(scene, 0, sizeof(SceneTarget));
+    scene->target_ms = target_ms;
+    scene->scale = 1.0f;
+#ifdef SCENE_TIMER_QUERIES
+    if (rlGetVersion() >= RL_OPENGL_33) {
+        glGenQueries(SCENE_QUERIES, scene->queries);
+        TraceLog(LOG_INFO, "SCENE: Scaling the resolution to draw the scene in %.1f ms", target_ms);
+        return true;
+    }
+#endif
+    TraceLog(LOG_WARNING, "SCENE: Resolution scaling needs timer queries, drawing at full resolution");
+    return false;
+}
+
+void SceneTargetUnload(SceneTarget *scene) {
+    if (scene->target.id != 0) {
+        UnloadRenderTexture(scene->target);
+    }
+#ifdef SCENE_TIMER_QUERIES
+    if (scene->queries[0] != 0) {
+        glDeleteQueries(SCENE_QUERIES, scene->queries);
+    }
+#endif
+    memset(scene, 0, sizeof(SceneTarget));
+}
+
+void SceneTargetBegin(SceneTarget *scene, Color background) {
+    int width = GetRenderWidth();
+    int height = GetRenderHeight();
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    // Allocated at full size, so changing the scale is only a viewport change
+    if (scene->target.texture.width != width || scene->target.texture.height != height) {
+        if (scene->target.id != 0) UnloadRenderTexture(scene->target);
+        scene->target = LoadRenderTexture(width, height);
+        SetTextureFilter(scene->target.texture, TEXTURE_FILTER_BILINEAR);
+    }
+
+    ReadQueries(scene);
+    BeginTextureMode(scene->target);
+    ClearBackground(background);
+    // BeginMode3D takes its aspect ratio from the whole target, which the
+    // scaled viewport keeps
+    rlViewport(0, 0, Scaled(scene, width), Scaled(scene, height));
+
+#ifdef SCENE_TIMER_QUERIES
+    if (scene->begun - scene->read < SCENE_QUERIES) {
+        int i = scene->begun % SCENE_QUERIES;
+        scene->query_scale[i] = scene->scale;
+        glBeginQuery(GL_TIME_ELAPSED, scene->queries[i]);
+        scene->timing = true;
+    }
+#endif
+}
+
+void SceneTargetEnd(SceneTarget *scene) {
+    EndTextureMode();
+
+    // Render textures are upside down, and the scene is in their bottom left
+    Rectangle source = {
+        0.0f, 0.0f,
+        (float)Scaled(scene, scene->target.texture.width),
+        -(float)Scaled(scene, scene->target.texture.height),
+    };
+    Rectangle dest = {0.0f, 0.0f, (float)GetScreenWidth(), (float)GetScreenHeight()};
+    DrawTexturePro(scene->target.texture, source, dest, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+    rlDrawRenderBatchActive();
+
+#ifdef SCENE_TIMER_QUERIES
+    if (scene->timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        scene->begun++;
+        scene->timing = false;
+    }
+#endif
+}
@@ -0,0 +1,43 @@
+#ifndef SCENE_TARGET_H
+#define SCENE_TARGET_H
+
+#include "raylib.h"
+
+#include <stdbool.h>
+
+#define SCENE_MIN_SCALE 0.25f
+// Timer queries in flight; results are read a few frames late so reading
+// them never stalls
+#define SCENE_QUERIES 4
+
+// Draws the 3d scene offscreen at a fraction of the screen's resolution and
+// scales it up, lowering the fraction while the scene takes longer than
+// target_ms of GPU time and raising it again once there's room. The time
+// comes from timer queries, not the frame time, which vsync holds at the
+// refresh interval however little the scene costs.
+typedef struct {
+    RenderTexture target; // screen sized; the scene only fills scale of it
+    float target_ms;
+    float scale;
+    float scene_ms;       // smoothed, at the current scale
+    int samples;          // since the scale last changed
+
+    unsigned int queries[SCENE_QUERIES];
+    float query_scale[SCENE_QUERIES];
+    unsigned int begun;   // queries ever started
+    unsigned int read;    // and read back
+    bool timing;          // one is running
+} SceneTarget;
+
+// False without timer queries, in which case the scene should be drawn
+// straight to the screen
+bool SceneTargetInit(SceneTarget *scene, float target_ms);
+void SceneTargetUnload(SceneTarget *scene);
+
+// Around the 3d pass, which then draws into the target cleared to
+// background. SceneTargetEnd scales it over the whole screen, so whatever
+// is drawn after is at full resolution.
+void SceneTargetBegin(SceneTarget *scene, Color background);
+void SceneTargetEnd(SceneTarget *scene);
+
+#endif // SCENE_TARGET_H
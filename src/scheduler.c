@@ -0,0 +1,111 @@
+#include "scheduler.h"
+#include "raymath.h"
+
+// raylib's BeginMode3D clip planes
+#define VIEW_NEAR 0.01
+#define VIEW_FAR 1000.0
+
+SchedulerView SchedulerViewFromCamera(Camera camera, int width, int height) {
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix proj = MatrixPerspective(camera.fovy * DEG2RAD, (double)width / height, VIEW_NEAR, VIEW_FAR);
+    return (SchedulerView){
+        .view_proj = MatrixMultiply(view, proj),
+        .width = width,
+        .height = height,
+    };
+}
+
+static Vector4 ToClip(Matrix m, Vector3 v) {
+    return (Vector4){
+        m.m0 * v.x + m.m4 * v.y + m.m8 * v.z + m.m12,
+        m.m1 * v.x + m.m5 * v.y + m.m9 * v.z + m.m13,
+        m.m2 * v.x + m.m6 * v.y + m.m10 * v.z + m.m14,
+        m.m3 * v.x + m.m7 * v.y + m.m11 * v.z + m.m15,
+    };
+}
+
+// A quad is out of view only if all of its corners are past the same plane
+static bool InFrustum(const Vector4 clip[4]) {
+    int outside[6] = {0};
+    for (int i = 0; i < 4; i++) {
+        Vector4 c = clip[i];
+        outside[0] += c.x < -c.w;
+        outside[1] += c.x > c.w;
+        outside[2] += c.y < -c.w;
+        outside[3] += c.y > c.w;
+        outside[4] += c.z < -c.w;
+        outside[5] += c.z > c.w;
+    }
+    for (int p = 0; p < 6; p++) {
+        if (outside[p] == 4) return false;
+    }
+    return true;
+}
+
+static float ScreenFraction(const SchedulerView *view, const Vector4 clip[4]) {
+    Vector2 screen[4];
+    for (int i = 0; i < 4; i++) {
+        // Straddling the camera; it's right in front of us
+        if (clip[i].w <= VIEW_NEAR) return 1.0f;
+        screen[i] = (Vector2){
+            (clip[i].x / clip[i].w + 1.0f) * 0.5f * view->width,
+            (1.0f - clip[i].y / clip[i].w) * 0.5f * view->height,
+        };
+    }
+
+    // Shoelace formula
+    float area = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        Vector2 a = screen[i];
+        Vector2 b = screen[(i + 1) % 4];
+        area += a.x * b.y - b.x * a.y;
+    }
+    float fraction = fabsf(area) * 0.5f / (view->width * view->height);
+    return fraction > 1.0f ? 1.0f : fraction;
+}
+
+// The coarsest level that is still at least as big as the window is on
+// screen. Going finer happens right away, going coarser only once the window
+// is well below the next level, so a window near the edge doesn't flip.
+static int PickLod(const SchedulerView *view, const SchedulerConfig *config, const WindowSchedule *s) {
+    if (s->width <= 0 || s->height <= 0 || s->screen_fraction <= 0.0f) return s->lod;
+
+    float on_screen = s->screen_fraction * view->width * view->height;
+    // Window pixels per screen pixel along each axis
+    float scale = sqrtf((float)s->width * s->height / on_screen);
+
+    int lod = s->lod > config->max_lod ? config->max_lod : s->lod;
+    while (lod > 0 && scale < (float)(1 << lod)) lod--;
+    while (lod < config->max_lod && scale >= (float)(2 << lod) * 1.25f) lod++;
+    return lod;
+}
+
+float ScheduleWindow(const SchedulerView *view, const SchedulerConfig *config, WindowSchedule *s,
+                     const Vector3 corners[4], bool visible, bool focused, double now) {
+    Vector4 clip[4];
+    for (int i = 0; i < 4; i++) {
+        clip[i] = ToClip(view->view_proj, corners[i]);
+    }
+
+    bool in_view = visible && InFrustum(clip);
+    s->screen_fraction = in_view ? ScreenFraction(view, clip) : 0.0f;
+    if (in_view) s->last_seen = now;
+    s->lod = PickLod(view, config, s);
+
+    if (!in_view) s->rate_hz = 0.0f;
+    else if (s->refresh_hz != SCHEDULER_AUTO_HZ) s->rate_hz = s->refresh_hz;
+    else s->rate_hz = focused ? config->focused_hz : config->background_hz;
+
+    // Focus first, then what covers the most of the screen. Waiting raises
+    // priority so small windows aren't starved by big busy ones.
+    float waited = (float)(now - s->last_update);
+    if (waited > 1.0f) waited = 1.0f;
+    s->priority = (focused ? 100.0f : 0.0f) + s->screen_fraction * 10.0f + waited;
+
+    return s->rate_hz;
+}
+
+void ScheduleRecordUpdate(WindowSchedule *s, double now, float ms) {
+    s->last_update = now;
+    s->update_ms = s->update_ms == 0.0f ? ms : s->update_ms * 0.8f + ms * 0.2f;
+}
@@ -0,0 +1,45 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "raylib.h"
+
+#define SCHEDULER_AUTO_HZ -1.0f
+
+typedef struct {
+    float focused_hz;    // refresh rate of the selected window
+    float background_hz; // other windows in view; anything out of view gets 0
+    float budget_ms;     // render thread time per frame for texture updates
+    int max_lod;         // coarsest capture level, 0 always captures at full size
+} SchedulerConfig;
+
+// Per-window scheduling state
+typedef struct {
+    float refresh_hz; // per-window override, SCHEDULER_AUTO_HZ to go by focus
+    float rate_hz;    // rate picked this frame
+    float priority;
+    float screen_fraction; // projected area over screen area, 0 when out of view
+    double last_update;
+    double last_seen; // last time it was in view
+    float update_ms; // moving average of what an update costs
+    int width;       // window size in pixels, 0 until the first frame
+    int height;
+    int lod; // capture at 1/2^lod of the window's size
+} WindowSchedule;
+
+// Camera data shared by every window in a frame
+typedef struct {
+    Matrix view_proj;
+    float width;
+    float height;
+} SchedulerView;
+
+SchedulerView SchedulerViewFromCamera(Camera camera, int width, int height);
+
+// Pick the window's refresh rate, capture level and its priority for this
+// frame's update budget. corners are the window quad in world space, in perimeter order.
+float ScheduleWindow(const SchedulerView *view, const SchedulerConfig *config, WindowSchedule *s,
+                     const Vector3 corners[4], bool visible, bool focused, double now);
+
+void ScheduleRecordUpdate(WindowSchedule *s, double now, float ms);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,167 @@
+#include "session.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t entry_size; // so a build with another layout doesn't misread it
+    Vector3 camera_position;
+    Vector3 camera_target;
+} SessionHeader;
+
+struct Session {
+    const unsigned char *data;
+    size_t size;
+    const SessionHeader *header;
+    const SessionEntry *entries;
+};
+
+Session *SessionOpen(const char *path) {
+    // No session yet is the usual first run, not an error
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SessionHeader)) {
+        fprintf(stderr, "Ignoring session %s, it's too short\n", path);
+        close(fd);
+        return NULL;
+    }
+    size_t size = st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Unable to map session %s\n", path);
+        return NULL;
+    }
+
+    const SessionHeader *header = data;
+    if (memcmp(header->magic, SESSION_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SESSION_VERSION || header->entry_size != sizeof(SessionEntry) ||
+        header->count > (size - sizeof(SessionHeader)) / sizeof(SessionEntry)) {
+        fprintf(stderr, "Ignoring session %s, it's not one this version can read\n", path);
+        munmap(data, size);
+        return NULL;
+    }
+
+    Session *session = malloc(sizeof(Session));
+    if (session == NULL) {
+        fprintf(stderr, "Failed to allocate memory for session\n");
+        munmap(data, size);
+        return NULL;
+    }
+    session->data = data;
+    session->size = size;
+    session->header = header;
+    session->entries = (const SessionEntry *)(session->data + sizeof(SessionHeader));
+    return session;
+}
+
+void SessionClose(Session *session) {
+    munmap((void *)session->data, session->size);
+    free(session);
+}
+
+void SessionCamera(const Session *session, Camera *camera) {
+    camera->position = session->header->camera_position;
+    camera->target = session->header->camera_target;
+}
+
+const SessionEntry *SessionFind(const Session *session, uint32_t window) {
+    for (uint32_t i = 0; i < session->header->count; i++) {
+        if (session->entries[i].window == window) return &session->entries[i];
+    }
+    return NULL;
+}
+
+Image SessionThumbnail(const Session *session, const SessionEntry *entry) {
+    Image image = {0};
+    if (entry->thumb_width <= 0 || entry->thumb_height <= 0 || entry->thumb_bytes == 0) return image;
+    if (entry->thumb_offset > session->size || entry->thumb_bytes > session->size - entry->thumb_offset) return image;
+
+    int size = 0;
+    unsigned char *pixels = DecompressData(session->data + entry->thumb_offset, entry->thumb_bytes, &size);
+    if (pixels == NULL) return image;
+    if (size != entry->thumb_width * entry->thumb_height * 4) {
+        MemFree(pixels);
+        return image;
+    }
+    return (Image){
+        .data = pixels,
+        .width = entry->thumb_width,
+        .height = entry->thumb_height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+}
+
+bool SessionSave(const char *path, const Camera *camera, SessionEntry *entries, const Image *thumbnails, int count) {
+    unsigned char **packed = calloc(count > 0 ? count : 1, sizeof(unsigned char *));
+    if (packed == NULL) {
+        fprintf(stderr, "Failed to allocate memory for session thumbnails\n");
+        return false;
+    }
+
+    size_t offset = sizeof(SessionHeader) + (size_t)count * sizeof(SessionEntry);
+    for (int i = 0; i < count; i++) {
+        SessionEntry *entry = &entries[i];
+        entry->thumb_width = entry->thumb_height = 0;
+        entry->thumb_offset = entry->thumb_bytes = 0;
+        const Image *thumb = &thumbnails[i];
+        if (thumb->data == NULL) continue;
+
+        int bytes = 0;
+        packed[i] = CompressData(thumb->data, thumb->width * thumb->height * 4, &bytes);
+        if (packed[i] == NULL || offset + bytes > UINT32_MAX) continue;
+        entry->thumb_width = thumb->width;
+        entry->thumb_height = thumb->height;
+        entry->thumb_offset = offset;
+        entry->thumb_bytes = bytes;
+        offset += bytes;
+    }
+
+    SessionHeader header = {
+        .version = SESSION_VERSION,
+        .count = count,
+        .entry_size = sizeof(SessionEntry),
+        .camera_position = camera->position,
+        .camera_target = camera->target,
+    };
+    memcpy(header.magic, SESSION_MAGIC, sizeof(header.magic));
+
+    // Written next to it and renamed over it, so a crash halfway through
+    // leaves the last session, and a mapping of it stays valid
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *file = fopen(temp, "wb");
+    bool ok = file != NULL;
+    if (ok) {
+        fwrite(&header, sizeof(header), 1, file);
+        if (count > 0) fwrite(entries, sizeof(SessionEntry), count, file);
+        for (int i = 0; i < count; i++) {
+            if (entries[i].thumb_bytes > 0) fwrite(packed[i], 1, entries[i].thumb_bytes, file);
+        }
+        ok = !ferror(file);
+        ok = fclose(file) == 0 && ok;
+        ok = ok && rename(temp, path) == 0;
+        if (!ok) remove(temp);
+    }
+    if (!ok) {
+        fprintf(stderr, "Unable to save session to %s\n", path);
+    }
+
+    for (int i = 0; i < count; i++) {
+        MemFree(packed[i]);
+    }
+    free(packed);
+    return ok;
+}
@@ -0,0 +1,48 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "raylib.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SESSION_MAGIC "3dwmsess"
+#define SESSION_VERSION 1
+
+// One window as it was when the session was saved. Laid out as it is in
+// the file, so entries are read straight from the mapping.
+typedef struct {
+    uint32_t window;       // X window id
+    int32_t width;         // in pixels
+    int32_t height;
+    Matrix transform;
+    uint32_t flags;        // WindowRegistry flags
+    float refresh_hz;
+    int32_t thumb_width;   // 0 without a thumbnail
+    int32_t thumb_height;
+    uint32_t thumb_offset; // deflated RGBA, from the start of the file
+    uint32_t thumb_bytes;
+} SessionEntry;
+
+// Where the windows were and what they last showed, mapped from the file
+// the last run saved on exit, so the scene is there from the first frame
+// while captures start up. Windows are matched by X id, which outlives us
+// as long as the X server and the client do.
+typedef struct Session Session;
+
+// NULL if there's no snapshot at path or it isn't one this build reads
+Session *SessionOpen(const char *path);
+void SessionClose(Session *session);
+
+void SessionCamera(const Session *session, Camera *camera);
+// NULL if the window wasn't in the session
+const SessionEntry *SessionFind(const Session *session, uint32_t window);
+// Inflated RGBA; data is NULL without a thumbnail. Unload with UnloadImage.
+Image SessionThumbnail(const Session *session, const SessionEntry *entry);
+
+// Write entries, with thumbnails[i] (RGBA, or NULL data for none) for
+// entry i, replacing whatever was at path once it's all written. The
+// entries' thumb fields are filled in here.
+bool SessionSave(const char *path, const Camera *camera, SessionEntry *entries, const Image *thumbnails, int count);
+
+#endif // SESSION_H
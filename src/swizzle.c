@@ -0,0 +1,266 @@
+#include "swizzle.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SWIZZLE_X86 1
+#include <immintrin.h>
+#endif
+
+// Source pixels the downsampler sums at a time; a multiple of every block size
+#define DOWNSAMPLE_STRIP 256
+
+typedef void (*SwizzleRowFn)(unsigned char *dst, const unsigned char *src, int width);
+typedef void (*AccumulateRowFn)(uint16_t *acc, const unsigned char *src, int count);
+typedef void (*ReduceRowFn)(unsigned char *dst, uint16_t *acc, int width, int lod);
+
+static void SwizzleRowScalar(unsigned char *dst, const unsigned char *src, int width) {
+    for (int x = 0; x < width; x++) {
+        unsigned char b = src[0];
+        unsigned char g = src[1];
+        unsigned char r = src[2];
+        unsigned char a = src[3];
+        dst[0] = r;
+        dst[1] = g;
+        dst[2] = b;
+        dst[3] = a;
+        src += 4;
+        dst += 4;
+    }
+}
+
+#ifdef SWIZZLE_X86
+__attribute__((target("ssse3")))
+static void SwizzleRowSSSE3(unsigned char *dst, const unsigned char *src, int width) {
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + x * 4));
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_shuffle_epi8(px, mask));
+    }
+    SwizzleRowScalar(dst + x * 4, src + x * 4, width - x);
+}
+
+__attribute__((target("avx2")))
+static void SwizzleRowAVX2(unsigned char *dst, const unsigned char *src, int width) {
+    // vpshufb shuffles within each 128-bit lane, so the mask repeats
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + x * 4));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + x * 4 + 32));
+        _mm256_storeu_si256((__m256i *)(dst + x * 4), _mm256_shuffle_epi8(a, mask));
+        _mm256_storeu_si256((__m256i *)(dst + x * 4 + 32), _mm256_shuffle_epi8(b, mask));
+    }
+    for (; x + 8 <= width; x += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + x * 4));
+        _mm256_storeu_si256((__m256i *)(dst + x * 4), _mm256_shuffle_epi8(a, mask));
+    }
+    SwizzleRowScalar(dst + x * 4, src + x * 4, width - x);
+}
+#endif
+
+static void AccumulateRowScalar(uint16_t *acc, const unsigned char *src, int count) {
+    for (int i = 0; i < count; i++) {
+        acc[i] += src[i];
+    }
+}
+
+// Sum each run of 2^lod pixels of the column sums, average and write RGBA
+static void ReduceRowScalar(unsigned char *dst, uint16_t *acc, int width, int lod) {
+    int block = 1 << lod;
+    int shift = 2 * lod;
+    unsigned int round = 1u << (shift - 1);
+
+    for (int x = 0; x < width; x += block) {
+        unsigned int b = 0, g = 0, r = 0, a = 0;
+        for (int i = x; i < x + block; i++) {
+            b += acc[i * 4 + 0];
+            g += acc[i * 4 + 1];
+            r += acc[i * 4 + 2];
+            a += acc[i * 4 + 3];
+        }
+        dst[0] = (unsigned char)((r + round) >> shift);
+        dst[1] = (unsigned char)((g + round) >> shift);
+        dst[2] = (unsigned char)((b + round) >> shift);
+        dst[3] = (unsigned char)((a + round) >> shift);
+        dst += 4;
+    }
+}
+
+#ifdef SWIZZLE_X86
+// Widen bytes to 16 bits and add them to the column sums. Every SSSE3 or
+// AVX2 machine has SSE2, so this goes with either of those kernels.
+__attribute__((target("sse2")))
+static void AccumulateRowSSE2(uint16_t *acc, const unsigned char *src, int count) {
+    const __m128i zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_loadu_si128((const __m128i *)(acc + i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(acc + i + 8));
+        _mm_storeu_si128((__m128i *)(acc + i), _mm_add_epi16(lo, _mm_unpacklo_epi8(px, zero)));
+        _mm_storeu_si128((__m128i *)(acc + i + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(px, zero)));
+    }
+    AccumulateRowScalar(acc + i, src + i, count - i);
+}
+
+// Add neighbouring pixels pairwise lod times over, in place, then round,
+// swap R and B while still 16 bits wide and narrow to bytes
+__attribute__((target("sse2")))
+static void ReduceRowSSE2(unsigned char *dst, uint16_t *acc, int width, int lod) {
+    for (int level = 0; level < lod; level++, width /= 2) {
+        int x = 0;
+        for (; x + 4 <= width; x += 4) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(acc + x * 4));
+            __m128i b = _mm_loadu_si128((const __m128i *)(acc + x * 4 + 8));
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+            _mm_storeu_si128((__m128i *)(acc + x * 2), sum);
+        }
+        for (; x < width; x += 2) {
+            for (int c = 0; c < 4; c++) {
+                acc[x * 2 + c] = acc[x * 4 + c] + acc[x * 4 + 4 + c];
+            }
+        }
+    }
+
+    const __m128i round = _mm_set1_epi16((short)(1 << (2 * lod - 1)));
+    const __m128i shift = _mm_cvtsi32_si128(2 * lod);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(acc + x * 4));
+        __m128i b = _mm_loadu_si128((const __m128i *)(acc + x * 4 + 8));
+        a = _mm_srl_epi16(_mm_add_epi16(a, round), shift);
+        b = _mm_srl_epi16(_mm_add_epi16(b, round), shift);
+        a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+        b = _mm_shufflehi_epi16(_mm_shufflelo_epi16(b, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(a, b));
+    }
+    for (; x < width; x++) {
+        unsigned int r = 1u << (2 * lod - 1);
+        dst[x * 4 + 0] = (unsigned char)((acc[x * 4 + 2] + r) >> (2 * lod));
+        dst[x * 4 + 1] = (unsigned char)((acc[x * 4 + 1] + r) >> (2 * lod));
+        dst[x * 4 + 2] = (unsigned char)((acc[x * 4 + 0] + r) >> (2 * lod));
+        dst[x * 4 + 3] = (unsigned char)((acc[x * 4 + 3] + r) >> (2 * lod));
+    }
+}
+#endif
+
+static const SwizzleRowFn kernels[SWIZZLE_KERNEL_COUNT] = {
+    [SWIZZLE_SCALAR] = SwizzleRowScalar,
+#ifdef SWIZZLE_X86
+    [SWIZZLE_SSSE3] = SwizzleRowSSSE3,
+    [SWIZZLE_AVX2] = SwizzleRowAVX2,
+#endif
+};
+
+static const AccumulateRowFn accumulators[SWIZZLE_KERNEL_COUNT] = {
+    [SWIZZLE_SCALAR] = AccumulateRowScalar,
+#ifdef SWIZZLE_X86
+    [SWIZZLE_SSSE3] = AccumulateRowSSE2,
+    [SWIZZLE_AVX2] = AccumulateRowSSE2,
+#endif
+};
+
+static const ReduceRowFn reducers[SWIZZLE_KERNEL_COUNT] = {
+    [SWIZZLE_SCALAR] = ReduceRowScalar,
+#ifdef SWIZZLE_X86
+    [SWIZZLE_SSSE3] = ReduceRowSSE2,
+    [SWIZZLE_AVX2] = ReduceRowSSE2,
+#endif
+};
+
+static atomic_int active_kernel = -1;
+
+static bool KernelSupported(SwizzleKernel kernel) {
+    switch (kernel) {
+        case SWIZZLE_SCALAR: return true;
+#ifdef SWIZZLE_X86
+        case SWIZZLE_SSSE3: return __builtin_cpu_supports("ssse3");
+        case SWIZZLE_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+SwizzleKernel SwizzleBestKernel(void) {
+    for (int k = SWIZZLE_KERNEL_COUNT - 1; k > SWIZZLE_SCALAR; k--) {
+        if (KernelSupported(k)) return k;
+    }
+    return SWIZZLE_SCALAR;
+}
+
+bool SwizzleSetKernel(SwizzleKernel kernel) {
+    if (kernel >= SWIZZLE_KERNEL_COUNT || !KernelSupported(kernel)) return false;
+    atomic_store(&active_kernel, kernel);
+    return true;
+}
+
+const char *SwizzleKernelName(SwizzleKernel kernel) {
+    switch (kernel) {
+        case SWIZZLE_SCALAR: return "scalar";
+        case SWIZZLE_SSSE3: return "ssse3";
+        case SWIZZLE_AVX2: return "avx2";
+        default: return "unknown";
+    }
+}
+
+static SwizzleKernel ActiveKernel(void) {
+    int kernel = atomic_load_explicit(&active_kernel, memory_order_relaxed);
+    if (kernel < 0) {
+        // Racing threads all resolve to the same kernel, so first store wins
+        kernel = SwizzleBestKernel();
+        atomic_store_explicit(&active_kernel, kernel, memory_order_relaxed);
+    }
+    return kernel;
+}
+
+void SwizzleBGRAToRGBA(unsigned char *dst, size_t dst_stride,
+                       const unsigned char *src, size_t src_stride,
+                       int width, int height) {
+    SwizzleRowFn row = kernels[ActiveKernel()];
+
+    for (int y = 0; y < height; y++) {
+        row(dst + (size_t)y * dst_stride, src + (size_t)y * src_stride, width);
+    }
+}
+
+void SwizzleDownsampleBGRAToRGBA(unsigned char *dst, size_t dst_stride,
+                                 const unsigned char *src, size_t src_stride,
+                                 int width, int height, int lod) {
+    if (lod <= 0) {
+        SwizzleBGRAToRGBA(dst, dst_stride, src, src_stride, width, height);
+        return;
+    }
+    if (lod > SWIZZLE_MAX_LOD) lod = SWIZZLE_MAX_LOD;
+
+    SwizzleKernel kernel = ActiveKernel();
+    AccumulateRowFn accumulate = accumulators[kernel];
+    ReduceRowFn reduce = reducers[kernel];
+    int block = 1 << lod;
+    int used_width = (width >> lod) << lod;
+    uint16_t acc[DOWNSAMPLE_STRIP * 4];
+
+    for (int y = 0; y < height >> lod; y++) {
+        const unsigned char *rows = src + (size_t)y * block * src_stride;
+        unsigned char *out = dst + (size_t)y * dst_stride;
+
+        for (int x0 = 0; x0 < used_width; x0 += DOWNSAMPLE_STRIP) {
+            int strip = used_width - x0 < DOWNSAMPLE_STRIP ? used_width - x0 : DOWNSAMPLE_STRIP;
+
+            // Sum the block's rows column by column, then across each block
+            memset(acc, 0, (size_t)strip * 4 * sizeof(uint16_t));
+            for (int r = 0; r < block; r++) {
+                accumulate(acc, rows + (size_t)r * src_stride + (size_t)x0 * 4, strip * 4);
+            }
+
+            reduce(out + (size_t)(x0 >> lod) * 4, acc, strip, lod);
+        }
+    }
+}
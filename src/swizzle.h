@@ -0,0 +1,37 @@
+#ifndef SWIZZLE_H
+#define SWIZZLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Largest downsample is 16x16; any bigger and the box sums overflow
+#define SWIZZLE_MAX_LOD 4
+
+typedef enum {
+    SWIZZLE_SCALAR,
+    SWIZZLE_SSSE3,
+    SWIZZLE_AVX2,
+    SWIZZLE_KERNEL_COUNT,
+} SwizzleKernel;
+
+// Convert BGRA rows (as X hands them out) to RGBA. Strides are in bytes and
+// may include padding; dst may equal src for an in-place swap, otherwise the
+// conversion doubles as the copy into the destination buffer.
+void SwizzleBGRAToRGBA(unsigned char *dst, size_t dst_stride,
+                       const unsigned char *src, size_t src_stride,
+                       int width, int height);
+
+// Swizzle and box filter in one pass: every output pixel averages a
+// 2^lod x 2^lod block of the source. The output is (width >> lod) by
+// (height >> lod), like a GL mip level; leftover edge pixels are dropped.
+void SwizzleDownsampleBGRAToRGBA(unsigned char *dst, size_t dst_stride,
+                                 const unsigned char *src, size_t src_stride,
+                                 int width, int height, int lod);
+
+// The fastest kernel the CPU supports is picked on first use. These exist
+// so the benchmark can compare kernels against each other.
+SwizzleKernel SwizzleBestKernel(void);
+bool SwizzleSetKernel(SwizzleKernel kernel);
+const char *SwizzleKernelName(SwizzleKernel kernel);
+
+#endif // SWIZZLE_H
@@ -0,0 +1,471 @@
+#include "tap.h"
+#include "raylib.h"
+#include "rlgl.h"
+
+#if defined(GRAPHICS_API_OPENGL_33) || defined(GRAPHICS_API_OPENGL_43)
+#define TAP_PBO 1
+#include "external/glad.h" // function pointers are loaded by rlgl
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How often the writer looks for a reader on a fifo, or for room in it
+#define WRITER_POLL_MS 100
+// How long a frame may take from drawn to queued for the writer; the last
+// one is only repeated once a newer one can't still be on its way
+#define WRITER_LAG 0.1
+
+#ifdef TAP_PBO
+
+typedef struct {
+    unsigned int pbo;
+    GLsync fence; // NULL when the buffer is free
+    double time;  // drawn at
+} TapReadback;
+
+struct FrameTap {
+    // Render thread only
+    TapReadback readbacks[TAP_READBACKS];
+    int next;    // readback to start next
+    int oldest;  // readback to finish next
+    int pending;
+    bool warned; // about a resize
+
+    char *path;
+    int fps;
+    pthread_t thread;
+    atomic_bool stop;
+
+    // Everything below is shared with the writer
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    bool open;   // there's somewhere to write to
+    bool closed; // and then there wasn't
+    int width;   // of the stream, 0 until the first frame
+    int height;
+    unsigned char *frames[TAP_FRAMES]; // RGBA, bottom row first as read back
+    double times[TAP_FRAMES];
+    int head;    // oldest queued frame
+    int count;
+    long written;
+    long dropped;
+};
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void Drop(FrameTap *tap) {
+    pthread_mutex_lock(&tap->lock);
+    tap->dropped++;
+    pthread_mutex_unlock(&tap->lock);
+}
+
+// Full range BT.601, which is what C420jpeg means
+static void ToI420(const unsigned char *rgba, int width, int height, unsigned char *yuv) {
+    int chroma_width = (width + 1) / 2;
+    int chroma_height = (height + 1) / 2;
+    unsigned char *y_plane = yuv;
+    unsigned char *u_plane = y_plane + (size_t)width * height;
+    unsigned char *v_plane = u_plane + (size_t)chroma_width * chroma_height;
+    size_t stride = (size_t)width * 4;
+
+    for (int y = 0; y < height; y++) {
+        // Read back upside down
+        const unsigned char *row = rgba + (height - 1 - y) * stride;
+        unsigned char *out = y_plane + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            const unsigned char *p = row + x * 4;
+            out[x] = (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+        }
+    }
+
+    for (int cy = 0; cy < chroma_height; cy++) {
+        int y0 = cy * 2;
+        int y1 = y0 + 1 < height ? y0 + 1 : y0;
+        const unsigned char *row0 = rgba + (height - 1 - y0) * stride;
+        const unsigned char *row1 = rgba + (height - 1 - y1) * stride;
+        for (int cx = 0; cx < chroma_width; cx++) {
+            int x0 = cx * 2;
+            int x1 = x0 + 1 < width ? x0 + 1 : x0;
+            int r = row0[x0 * 4] + row0[x1 * 4] + row1[x0 * 4] + row1[x1 * 4];
+            int g = row0[x0 * 4 + 1] + row0[x1 * 4 + 1] + row1[x0 * 4 + 1] + row1[x1 * 4 + 1];
+            int b = row0[x0 * 4 + 2] + row0[x1 * 4 + 2] + row1[x0 * 4 + 2] + row1[x1 * 4 + 2];
+            // Sums of four, so shift two more
+            size_t i = (size_t)cy * chroma_width + cx;
+            u_plane[i] = ((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128;
+            v_plane[i] = ((128 * r - 107 * g - 21 * b + 512) >> 10) + 128;
+        }
+    }
+}
+
+// Blocks only in poll, and gives up once the tap is stopped
+static bool WriteAll(FrameTap *tap, int fd, const void *data, size_t size) {
+    const unsigned char *p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n > 0) {
+            p += n;
+            size -= n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) {
+            if (atomic_load(&tap->stop)) return false;
+            struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+            poll(&pfd, 1, WRITER_POLL_MS);
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+// A fifo can't be opened for writing without blocking until it has a
+// reader, so keep trying without blocking instead
+static int OpenOutput(FrameTap *tap) {
+    while (!atomic_load(&tap->stop)) {
+        int fd = open(tap->path, O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+        if (fd >= 0) return fd;
+        if (errno != ENXIO) {
+            fprintf(stderr, "Unable to open %s for the output tap\n", tap->path);
+            return -1;
+        }
+        struct timespec wait = {0, WRITER_POLL_MS * 1000000L};
+        nanosleep(&wait, NULL);
+    }
+    return -1;
+}
+
+// Write the held frame for every stream frame before until
+static bool Repeat(FrameTap *tap, int fd, const unsigned char *yuv, size_t size, long *ticks, long until) {
+    for (; *ticks < until; (*ticks)++) {
+        if (!WriteAll(tap, fd, "FRAME\n", 6) || !WriteAll(tap, fd, yuv, size)) return false;
+        pthread_mutex_lock(&tap->lock);
+        tap->written++;
+        pthread_mutex_unlock(&tap->lock);
+    }
+    return true;
+}
+
+// The stream runs on a clock of its own, starting with the first frame: each
+// of its frames is the newest one drawn by then. Frames drawn faster than
+// that are dropped, and while none are drawn (idle, or slow frames) the last
+// one is repeated, so the stream keeps to real time.
+static void *WriterMain(void *arg) {
+    FrameTap *tap = arg;
+    int fd = OpenOutput(tap);
+
+    pthread_mutex_lock(&tap->lock);
+    tap->open = fd >= 0;
+    tap->closed = fd < 0;
+    pthread_mutex_unlock(&tap->lock);
+
+    unsigned char *yuv = NULL; // the held frame, converted
+    size_t size = 0;
+    bool held = false;
+    bool shown = false; // the held frame was written at least once
+    double start = 0.0;
+    long ticks = 0;     // stream frames written
+    bool ok = fd >= 0;
+    while (ok) {
+        pthread_mutex_lock(&tap->lock);
+        while (tap->count == 0 && !atomic_load(&tap->stop)) {
+            if (!held) {
+                pthread_cond_wait(&tap->ready, &tap->lock);
+                continue;
+            }
+            double due = start + (double)ticks / tap->fps + WRITER_LAG;
+            struct timespec wait = {(time_t)due, (long)((due - floor(due)) * 1e9)};
+            if (pthread_cond_timedwait(&tap->ready, &tap->lock, &wait) == ETIMEDOUT) break;
+        }
+        bool fresh = tap->count > 0;
+        bool stopping = !fresh && atomic_load(&tap->stop);
+        const unsigned char *frame = tap->frames[tap->head];
+        double drawn = tap->times[tap->head];
+        int width = tap->width;
+        int height = tap->height;
+        pthread_mutex_unlock(&tap->lock);
+        if (!held && !fresh) break;
+
+        if (held) {
+            // Up to the new frame, or as far as the clock has surely gone
+            // without one
+            long until;
+            if (fresh) until = (long)ceil((drawn - start) * tap->fps);
+            else if (stopping) until = (long)floor((Now() - start) * tap->fps) + 1;
+            else until = (long)floor((Now() - WRITER_LAG - start) * tap->fps) + 1;
+            if (stopping && !shown && until <= ticks) until = ticks + 1;
+
+            if (until > ticks) {
+                ok = Repeat(tap, fd, yuv, size, &ticks, until);
+                shown = true;
+            }
+            else if (fresh && !shown) {
+                Drop(tap);
+            }
+        }
+        if (!ok || stopping) break;
+        if (!fresh) continue;
+
+        // The render thread only fills the other slots meanwhile
+        if (!held) {
+            size = (size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+            yuv = malloc(size);
+            char text[128];
+            int length = snprintf(text, sizeof(text), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, tap->fps);
+            ok = yuv != NULL && WriteAll(tap, fd, text, length);
+            start = drawn;
+        }
+        if (ok) {
+            ToI420(frame, width, height, yuv);
+            held = true;
+            shown = false;
+        }
+
+        pthread_mutex_lock(&tap->lock);
+        tap->head = (tap->head + 1) % TAP_FRAMES;
+        tap->count--;
+        pthread_mutex_unlock(&tap->lock);
+    }
+
+    pthread_mutex_lock(&tap->lock);
+    if (!ok && fd >= 0) {
+        // The reader went away, or we're stopping; nothing more is sent
+        if (!atomic_load(&tap->stop)) fprintf(stderr, "Output tap stopped writing to %s\n", tap->path);
+        tap->dropped += tap->count + (held && !shown);
+        tap->count = 0;
+        tap->closed = true;
+    }
+    tap->open = false;
+    pthread_mutex_unlock(&tap->lock);
+
+    free(yuv);
+    if (fd >= 0) close(fd);
+    return NULL;
+}
+
+FrameTap *TapStart(const char *path, int fps) {
+    if (rlGetVersion() < RL_OPENGL_33) {
+        TraceLog(LOG_WARNING, "TAP: Asynchronous readback needs OpenGL 3.3, not tapping output");
+        return NULL;
+    }
+
+    FrameTap *tap = malloc(sizeof(FrameTap));
+    if (tap == NULL) {
+        fprintf(stderr, "Failed to allocate memory for output tap\n");
+        return NULL;
+    }
+    memset(tap, 0, sizeof(FrameTap));
+    tap->path = strdup(path);
+    tap->fps = fps > 0 ? fps : 60;
+    if (tap->path == NULL) {
+        fprintf(stderr, "Failed to allocate memory for output tap\n");
+        free(tap);
+        return NULL;
+    }
+
+    // A reader going away should end the stream, not us
+    signal(SIGPIPE, SIG_IGN);
+
+    // The writer waits on the stream's clock, which is monotonic
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&tap->lock, NULL);
+    pthread_cond_init(&tap->ready, &attr);
+    pthread_condattr_destroy(&attr);
+    atomic_init(&tap->stop, false);
+    if (pthread_create(&tap->thread, NULL, WriterMain, tap) != 0) {
+        fprintf(stderr, "Unable to start output tap thread\n");
+        pthread_cond_destroy(&tap->ready);
+        pthread_mutex_destroy(&tap->lock);
+        free(tap->path);
+        free(tap);
+        return NULL;
+    }
+    TraceLog(LOG_INFO, "TAP: Streaming frames to %s", path);
+    return tap;
+}
+
+void TapStop(FrameTap *tap) {
+    pthread_mutex_lock(&tap->lock);
+    atomic_store(&tap->stop, true);
+    pthread_cond_signal(&tap->ready);
+    pthread_mutex_unlock(&tap->lock);
+    pthread_join(tap->thread, NULL);
+    // Still being read back
+    tap->dropped += tap->pending;
+    TraceLog(LOG_INFO, "TAP: %ld frames written, %ld dropped", tap->written, tap->dropped);
+
+    for (int i = 0; i < TAP_READBACKS; i++) {
+        if (tap->readbacks[i].fence != NULL) glDeleteSync(tap->readbacks[i].fence);
+        if (tap->readbacks[i].pbo != 0) glDeleteBuffers(1, &tap->readbacks[i].pbo);
+    }
+    for (int i = 0; i < TAP_FRAMES; i++) {
+        free(tap->frames[i]);
+    }
+    pthread_cond_destroy(&tap->ready);
+    pthread_mutex_destroy(&tap->lock);
+    free(tap->path);
+    free(tap);
+}
+
+// Hand a finished readback to the writer, if it has a free frame
+static void Publish(FrameTap *tap, const TapReadback *rb) {
+    pthread_mutex_lock(&tap->lock);
+    bool room = tap->open && !tap->closed && tap->count < TAP_FRAMES;
+    if (!room) tap->dropped++;
+    int slot = (tap->head + tap->count) % TAP_FRAMES;
+    size_t size = (size_t)tap->width * tap->height * 4;
+    pthread_mutex_unlock(&tap->lock);
+    if (!room) return;
+    tap->times[slot] = rb->time;
+
+    // The writer doesn't touch the slot until it's counted
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+    const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    bool mapped = pixels != NULL;
+    if (mapped) {
+        memcpy(tap->frames[slot], pixels, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pthread_mutex_lock(&tap->lock);
+    if (mapped) {
+        tap->count++;
+        pthread_cond_signal(&tap->ready);
+    }
+    else {
+        tap->dropped++;
+    }
+    pthread_mutex_unlock(&tap->lock);
+}
+
+// Everything the GPU has finished reading back, oldest first
+static void FinishReadbacks(FrameTap *tap) {
+    while (tap->pending > 0) {
+        TapReadback *rb = &tap->readbacks[tap->oldest];
+        GLenum status = glClientWaitSync(rb->fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) return;
+
+        glDeleteSync(rb->fence);
+        rb->fence = NULL;
+        tap->oldest = (tap->oldest + 1) % TAP_READBACKS;
+        tap->pending--;
+        if (status == GL_WAIT_FAILED) Drop(tap);
+        else Publish(tap, rb);
+    }
+}
+
+// Buffers for frames of the stream's size, which the first frame sets
+static bool Allocate(FrameTap *tap, int width, int height) {
+    size_t size = (size_t)width * height * 4;
+    for (int i = 0; i < TAP_FRAMES; i++) {
+        tap->frames[i] = malloc(size);
+        if (tap->frames[i] == NULL) {
+            fprintf(stderr, "Failed to allocate memory for output tap frames\n");
+            return false;
+        }
+    }
+    for (int i = 0; i < TAP_READBACKS; i++) {
+        glGenBuffers(1, &tap->readbacks[i].pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, tap->readbacks[i].pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void TapCapture(FrameTap *tap) {
+    FinishReadbacks(tap);
+
+    int width = GetRenderWidth();
+    int height = GetRenderHeight();
+    pthread_mutex_lock(&tap->lock);
+    bool closed = tap->closed;
+    bool fresh = tap->width == 0;
+    if (fresh && !closed) {
+        tap->width = width;
+        tap->height = height;
+    }
+    bool resized = tap->width != width || tap->height != height;
+    pthread_mutex_unlock(&tap->lock);
+    if (closed) return;
+
+    if (fresh && !Allocate(tap, width, height)) {
+        pthread_mutex_lock(&tap->lock);
+        tap->closed = true;
+        pthread_mutex_unlock(&tap->lock);
+        return;
+    }
+    if (resized) {
+        if (!tap->warned) TraceLog(LOG_WARNING, "TAP: Window resized, dropping frames that don't fit the stream");
+        tap->warned = true;
+        Drop(tap);
+        return;
+    }
+    // The GPU is that far behind; waiting for it is what the tap avoids
+    if (tap->pending == TAP_READBACKS) {
+        Drop(tap);
+        return;
+    }
+
+    rlDrawRenderBatchActive();
+    TapReadback *rb = &tap->readbacks[tap->next];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    rb->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    rb->time = Now();
+    tap->next = (tap->next + 1) % TAP_READBACKS;
+    tap->pending++;
+}
+
+void TapGetStats(FrameTap *tap, long *written, long *dropped) {
+    pthread_mutex_lock(&tap->lock);
+    *written = tap->written;
+    *dropped = tap->dropped;
+    pthread_mutex_unlock(&tap->lock);
+}
+
+#else
+
+FrameTap *TapStart(const char *path, int fps) {
+    (void)path;
+    (void)fps;
+    TraceLog(LOG_WARNING, "TAP: Asynchronous readback needs OpenGL 3.3, not tapping output");
+    return NULL;
+}
+
+void TapStop(FrameTap *tap) {
+    (void)tap;
+}
+
+void TapCapture(FrameTap *tap) {
+    (void)tap;
+}
+
+void TapGetStats(FrameTap *tap, long *written, long *dropped) {
+    (void)tap;
+    *written = *dropped = 0;
+}
+
+#endif // TAP_PBO
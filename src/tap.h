@@ -0,0 +1,33 @@
+#ifndef TAP_H
+#define TAP_H
+
+#include <stdbool.h>
+
+// Readbacks in flight on the GPU
+#define TAP_READBACKS 3
+// Frames read back and waiting for the writer
+#define TAP_FRAMES 4
+
+typedef struct FrameTap FrameTap;
+
+// Streams what's drawn to path (a file or, to feed an encoder, a fifo) as
+// YUV4MPEG2 at fps, each video frame the newest frame drawn by its time:
+// frames drawn faster are dropped, and the last one is repeated while
+// nothing new is drawn (as in idle mode). Frames are read back through
+// a ring of pixel buffers and only mapped once their fence has passed, then
+// converted and written on a thread of its own, so nothing the tap does
+// waits on the GPU or the reader: when either falls behind, frames are
+// dropped and counted. A fifo without a reader yet drops frames until one
+// opens it.
+FrameTap *TapStart(const char *path, int fps);
+void TapStop(FrameTap *tap);
+
+// Render thread, with the frame to send drawn to the default framebuffer.
+// The stream keeps the size of the first frame; frames of another size are
+// dropped.
+void TapCapture(FrameTap *tap);
+
+// Any thread
+void TapGetStats(FrameTap *tap, long *written, long *dropped);
+
+#endif // TAP_H
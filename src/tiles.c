@@ -0,0 +1,184 @@
+#include "tiles.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t Mix(uint64_t h, uint64_t v) {
+    h ^= v * 0xff51afd7ed558ccdull;
+    h = (h << 31 | h >> 33) * 0x9e3779b97f4a7c15ull;
+    return h;
+}
+
+// Not cryptographic, just quick and unlikely to miss a change
+static uint64_t HashTile(const unsigned char *pixels, size_t stride, int width, int height) {
+    size_t row = (size_t)width * 4;
+    uint64_t h = (uint64_t)width << 32 | (uint32_t)height;
+    for (int y = 0; y < height; y++) {
+        const unsigned char *p = pixels + y * stride;
+        size_t i = 0;
+        for (; i + 8 <= row; i += 8) {
+            uint64_t v;
+            memcpy(&v, p + i, 8);
+            h = Mix(h, v);
+        }
+        if (i < row) {
+            uint32_t v;
+            memcpy(&v, p + i, 4);
+            h = Mix(h, v);
+        }
+    }
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    // 0 is kept for tiles that aren't known
+    return h != 0 ? h : 1;
+}
+
+static bool Resize(TileHashes *tiles, int width, int height) {
+    int columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+    int rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+    size_t count = (size_t)columns * rows;
+
+    tiles->width = tiles->height = 0;
+    uint64_t *hashes = realloc(tiles->hashes, count * sizeof(uint64_t));
+    if (hashes != NULL) tiles->hashes = hashes;
+    unsigned char *changed = realloc(tiles->changed, count);
+    if (changed != NULL) tiles->changed = changed;
+    if (hashes == NULL || changed == NULL) {
+        fprintf(stderr, "Failed to allocate memory for tile hashes\n");
+        return false;
+    }
+
+    memset(tiles->hashes, 0, count * sizeof(uint64_t));
+    tiles->columns = columns;
+    tiles->rows = rows;
+    tiles->width = width;
+    tiles->height = height;
+    return true;
+}
+
+// Changed tiles as rects in tile units, stacking a row's runs onto the ones
+// above them where they line up. With whole_rows each row's changes become
+// one run from the first to the last. -1 if there are more than max.
+static int CollectRuns(const TileHashes *tiles, bool whole_rows, XRectangle *rects, int max) {
+    int count = 0;
+    for (int r = 0; r < tiles->rows; r++) {
+        const unsigned char *changed = tiles->changed + (size_t)r * tiles->columns;
+        int c = 0;
+        while (c < tiles->columns) {
+            if (!changed[c]) {
+                c++;
+                continue;
+            }
+
+            int c0 = c;
+            int c1 = c;
+            if (whole_rows) {
+                for (int k = c; k < tiles->columns; k++) {
+                    if (changed[k]) c1 = k + 1;
+                }
+                c = tiles->columns;
+            }
+            else {
+                while (c < tiles->columns && changed[c]) c++;
+                c1 = c;
+            }
+
+            bool stacked = false;
+            for (int s = 0; s < count && !stacked; s++) {
+                XRectangle *above = &rects[s];
+                if (above->y + above->height == r && above->x == c0 && above->x + above->width == c1) {
+                    above->height++;
+                    stacked = true;
+                }
+            }
+            if (!stacked) {
+                if (count == max) return -1;
+                rects[count++] = (XRectangle){c0, r, c1 - c0, 1};
+            }
+        }
+    }
+    return count;
+}
+
+int TileHashesDiff(TileHashes *tiles, const unsigned char *pixels, int width, int height,
+                   XRectangle *rects, int max_rects) {
+    bool fresh = width != tiles->width || height != tiles->height;
+    if (fresh && !Resize(tiles, width, height)) return -1;
+
+    size_t stride = (size_t)width * 4;
+    int changed_count = 0;
+    for (int r = 0; r < tiles->rows; r++) {
+        int y = r * TILE_SIZE;
+        int tile_height = height - y < TILE_SIZE ? height - y : TILE_SIZE;
+        for (int c = 0; c < tiles->columns; c++) {
+            int x = c * TILE_SIZE;
+            int tile_width = width - x < TILE_SIZE ? width - x : TILE_SIZE;
+            size_t i = (size_t)r * tiles->columns + c;
+            uint64_t h = HashTile(pixels + y * stride + (size_t)x * 4, stride, tile_width, tile_height);
+            tiles->changed[i] = h != tiles->hashes[i];
+            tiles->hashes[i] = h;
+            changed_count += tiles->changed[i];
+        }
+    }
+
+    // Cutting most of a frame up into rects costs more than sending it
+    int total = tiles->columns * tiles->rows;
+    if (fresh || changed_count * 4 > total * 3) return -1;
+    if (changed_count == 0) return 0;
+
+    int count = CollectRuns(tiles, false, rects, max_rects);
+    if (count < 0) count = CollectRuns(tiles, true, rects, max_rects);
+    if (count < 0) {
+        // Down to one box around all of it
+        int c0 = tiles->columns, r0 = tiles->rows, c1 = 0, r1 = 0;
+        for (int r = 0; r < tiles->rows; r++) {
+            for (int c = 0; c < tiles->columns; c++) {
+                if (!tiles->changed[(size_t)r * tiles->columns + c]) continue;
+                if (c < c0) c0 = c;
+                if (r < r0) r0 = r;
+                if (c + 1 > c1) c1 = c + 1;
+                if (r + 1 > r1) r1 = r + 1;
+            }
+        }
+        rects[0] = (XRectangle){c0, r0, c1 - c0, r1 - r0};
+        count = 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int x0 = rects[i].x * TILE_SIZE;
+        int y0 = rects[i].y * TILE_SIZE;
+        int x1 = (rects[i].x + rects[i].width) * TILE_SIZE;
+        int y1 = (rects[i].y + rects[i].height) * TILE_SIZE;
+        if (x1 > width) x1 = width;
+        if (y1 > height) y1 = height;
+        rects[i] = (XRectangle){x0, y0, x1 - x0, y1 - y0};
+    }
+    return count;
+}
+
+void TileHashesForget(TileHashes *tiles, const XRectangle *rects, int count, int lod) {
+    if (tiles->hashes == NULL) return;
+
+    for (int i = 0; i < count; i++) {
+        int c0 = (rects[i].x >> lod) / TILE_SIZE;
+        int r0 = (rects[i].y >> lod) / TILE_SIZE;
+        int c1 = (((rects[i].x + rects[i].width) >> lod) + TILE_SIZE - 1) / TILE_SIZE;
+        int r1 = (((rects[i].y + rects[i].height) >> lod) + TILE_SIZE - 1) / TILE_SIZE;
+        if (c1 > tiles->columns) c1 = tiles->columns;
+        if (r1 > tiles->rows) r1 = tiles->rows;
+        for (int r = r0; r < r1; r++) {
+            for (int c = c0; c < c1; c++) {
+                tiles->hashes[(size_t)r * tiles->columns + c] = 0;
+            }
+        }
+    }
+}
+
+void TileHashesFree(TileHashes *tiles) {
+    free(tiles->hashes);
+    free(tiles->changed);
+    memset(tiles, 0, sizeof(TileHashes));
+}
@@ -0,0 +1,34 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <X11/Xlib.h>
+
+#include <stdint.h>
+
+#define TILE_SIZE 64
+
+// A hash of every TILE_SIZE square of the last full frame of a window, to
+// find out which parts of the next one actually changed. Many clients
+// repaint (and damage) their whole window when little or nothing in it
+// changed, and without the damage extension every frame is a full one.
+typedef struct {
+    uint64_t *hashes; // 0 where the contents aren't known
+    unsigned char *changed;
+    int columns;
+    int rows;
+    int width; // frame size the hashes are for
+    int height;
+} TileHashes;
+
+// Hash a whole RGBA frame, packed rows, and list the tiles that differ from
+// the last one as up to max_rects rects in its pixels. Returns -1 when
+// there's nothing to compare against or so much changed that the whole
+// frame may as well go; either way the hashes are the new frame's after.
+int TileHashesDiff(TileHashes *tiles, const unsigned char *pixels, int width, int height,
+                   XRectangle *rects, int max_rects);
+// The rects (in window coordinates, of a frame scaled down by 2^lod) were
+// sent some other way, so their tiles have to be compared from scratch
+void TileHashesForget(TileHashes *tiles, const XRectangle *rects, int count, int lod);
+void TileHashesFree(TileHashes *tiles);
+
+#endif // TILES_H
@@ -0,0 +1,230 @@
+#include "tracker.h"
+#include "capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *Grow(void *items, int *capacity, int needed, size_t size) {
+    if (needed <= *capacity) return items;
+
+    int grown = *capacity == 0 ? 16 : *capacity;
+    while (grown < needed) grown *= 2;
+    items = realloc(items, (size_t)grown * size);
+    if (items == NULL) {
+        fprintf(stderr, "Failed to allocate memory for window tracker\n");
+        exit(1);
+    }
+    *capacity = grown;
+    return items;
+}
+
+static int Find(const WindowTracker *t, Window window) {
+    for (int i = 0; i < t->count; i++) {
+        if (t->windows[i].window == window) return i;
+    }
+    return -1;
+}
+
+static void Report(WindowTracker *t, TrackerChangeType type, const TrackedWindow *w) {
+    t->changes = Grow(t->changes, &t->change_capacity, t->change_count + 1, sizeof(TrackerChange));
+    t->changes[t->change_count++] = (TrackerChange){type, *w};
+}
+
+// One round trip, for windows we know nothing about yet. False if the
+// window is already gone.
+static bool Query(WindowTracker *t, TrackedWindow *w) {
+    XWindowAttributes attr;
+    CaptureTrapErrors();
+    Status status = XGetWindowAttributes(t->display, w->window, &attr);
+    if (!CaptureUntrapErrors() || status == 0) return false;
+
+    w->x = attr.x;
+    w->y = attr.y;
+    w->width = attr.width;
+    w->height = attr.height;
+    w->mapped = attr.map_state != IsUnmapped;
+    w->override_redirect = attr.override_redirect;
+    w->input_only = attr.class == InputOnly;
+    w->class_known = true;
+    return true;
+}
+
+static bool Showable(const WindowTracker *t, const TrackedWindow *w) {
+    if (!w->mapped || w->override_redirect || w->input_only) return false;
+    if (w->window == t->own || w->window == t->own_frame) return false;
+    return w->width > 1 && w->height > 1;
+}
+
+// Report whatever a change to window i amounts to
+static void Refresh(WindowTracker *t, int i) {
+    TrackedWindow *w = &t->windows[i];
+    if (w->mapped && !w->class_known && !Query(t, w)) {
+        w->mapped = false;
+    }
+
+    bool show = Showable(t, w);
+    if (show && !w->shown) {
+        w->shown = true;
+        Report(t, TRACKER_SHOW, w);
+    }
+    else if (!show && w->shown) {
+        w->shown = false;
+        Report(t, TRACKER_HIDE, w);
+    }
+}
+
+static void Add(WindowTracker *t, const TrackedWindow *w) {
+    t->windows = Grow(t->windows, &t->capacity, t->count + 1, sizeof(TrackedWindow));
+    t->windows[t->count++] = *w;
+    Refresh(t, t->count - 1);
+}
+
+static void Remove(WindowTracker *t, int i) {
+    if (t->windows[i].shown) {
+        Report(t, TRACKER_HIDE, &t->windows[i]);
+    }
+    t->windows[i] = t->windows[--t->count];
+}
+
+// The root child our window ends up in, which is its frame under a
+// reparenting window manager
+static Window FindOwnFrame(WindowTracker *t) {
+    Window window = t->own;
+    CaptureTrapErrors();
+    while (window != None) {
+        Window root, parent, *children = NULL;
+        unsigned int count;
+        if (!XQueryTree(t->display, window, &root, &parent, &children, &count)) break;
+        if (children != NULL) XFree(children);
+        if (parent == t->root) break;
+        window = parent;
+    }
+    CaptureUntrapErrors();
+    return window;
+}
+
+bool WindowTrackerInit(WindowTracker *t, Display *display, Window own) {
+    memset(t, 0, sizeof(WindowTracker));
+    t->display = display;
+    t->root = DefaultRootWindow(display);
+    t->own = own;
+
+    // Select first, so nothing created while we list the windows is missed
+    XSelectInput(display, t->root, SubstructureNotifyMask);
+    t->own_frame = own != None ? FindOwnFrame(t) : None;
+
+    Window root, parent, *children = NULL;
+    unsigned int count;
+    if (!XQueryTree(display, t->root, &root, &parent, &children, &count)) {
+        fprintf(stderr, "Unable to list windows\n");
+        return false;
+    }
+
+    // Bottom to top, so the topmost windows get added last
+    for (unsigned int i = 0; i < count; i++) {
+        TrackedWindow w = {.window = children[i]};
+        if (Query(t, &w)) Add(t, &w);
+    }
+    if (children != NULL) XFree(children);
+    return true;
+}
+
+void WindowTrackerFree(WindowTracker *t) {
+    if (t->display != NULL) {
+        XSelectInput(t->display, t->root, NoEventMask);
+    }
+    free(t->windows);
+    free(t->changes);
+    memset(t, 0, sizeof(WindowTracker));
+}
+
+static void HandleEvent(WindowTracker *t, const XEvent *event) {
+    switch (event->type) {
+        case CreateNotify: {
+            const XCreateWindowEvent *e = &event->xcreatewindow;
+            if (e->parent != t->root || Find(t, e->window) >= 0) break;
+            TrackedWindow w = {
+                .window = e->window,
+                .x = e->x,
+                .y = e->y,
+                .width = e->width,
+                .height = e->height,
+                .override_redirect = e->override_redirect,
+            };
+            Add(t, &w);
+            break;
+        }
+        case DestroyNotify: {
+            int i = Find(t, event->xdestroywindow.window);
+            if (i >= 0) Remove(t, i);
+            break;
+        }
+        case MapNotify:
+        case UnmapNotify: {
+            Window window = event->type == MapNotify ? event->xmap.window : event->xunmap.window;
+            int i = Find(t, window);
+            if (i < 0) break;
+            t->windows[i].mapped = event->type == MapNotify;
+            if (event->type == MapNotify) {
+                t->windows[i].override_redirect = event->xmap.override_redirect;
+            }
+            Refresh(t, i);
+            break;
+        }
+        case ConfigureNotify: {
+            const XConfigureEvent *e = &event->xconfigure;
+            int i = Find(t, e->window);
+            if (i < 0) break;
+            TrackedWindow *w = &t->windows[i];
+            bool resized = w->width != e->width || w->height != e->height;
+            w->x = e->x;
+            w->y = e->y;
+            w->width = e->width;
+            w->height = e->height;
+            w->override_redirect = e->override_redirect;
+            if (resized && w->shown && Showable(t, w)) {
+                Report(t, TRACKER_RESIZE, w);
+            }
+            Refresh(t, i);
+            break;
+        }
+        case ReparentNotify: {
+            const XReparentEvent *e = &event->xreparent;
+            if (e->window == t->own) {
+                // Our window went into a frame (or back out of one); stop
+                // showing whatever holds it
+                Window old_frame = t->own_frame;
+                t->own_frame = e->parent == t->root ? t->own : e->parent;
+                int i = Find(t, old_frame);
+                if (i >= 0) Refresh(t, i);
+                i = Find(t, t->own_frame);
+                if (i >= 0) Refresh(t, i);
+            }
+
+            int i = Find(t, e->window);
+            if (e->parent == t->root && i < 0) {
+                TrackedWindow w = {.window = e->window};
+                if (Query(t, &w)) Add(t, &w);
+            }
+            else if (e->parent != t->root && i >= 0) {
+                Remove(t, i);
+            }
+            break;
+        }
+    }
+}
+
+int WindowTrackerPoll(WindowTracker *t, const TrackerChange **changes) {
+    // XPending only reads what's already on the socket
+    while (XPending(t->display)) {
+        XEvent event;
+        XNextEvent(t->display, &event);
+        HandleEvent(t, &event);
+    }
+
+    *changes = t->changes;
+    int count = t->change_count;
+    t->change_count = 0;
+    return count;
+}
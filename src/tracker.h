@@ -0,0 +1,61 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <X11/Xlib.h>
+
+#include <stdbool.h>
+
+// A child of the root window, as last reported by the server
+typedef struct {
+    Window window;
+    int x;
+    int y;
+    int width;
+    int height;
+    bool mapped;
+    bool override_redirect;
+    bool input_only;
+    bool class_known; // input_only is only looked up once the window maps
+    bool shown;       // reported through TRACKER_SHOW and not hidden since
+} TrackedWindow;
+
+typedef enum {
+    TRACKER_SHOW,   // a window worth showing appeared
+    TRACKER_HIDE,   // it was unmapped, destroyed or reparented away
+    TRACKER_RESIZE, // a shown window changed size
+} TrackerChangeType;
+
+typedef struct {
+    TrackerChangeType type;
+    TrackedWindow window;
+} TrackerChange;
+
+// Keeps the list of top-level windows current from the root window's
+// SubstructureNotify events, so nobody has to ask the server about them.
+// Only mapped InputOutput windows that aren't override-redirect (menus,
+// tooltips) are shown, and never our own.
+typedef struct {
+    Display *display;
+    Window root;
+    Window own;       // the window we draw into
+    Window own_frame; // the root child holding it, if a window manager reparented it
+
+    TrackedWindow *windows;
+    int count;
+    int capacity;
+
+    TrackerChange *changes;
+    int change_count;
+    int change_capacity;
+} WindowTracker;
+
+// Lists the existing windows (a few round trips, once) and reports the
+// showable ones as TRACKER_SHOW on the first poll
+bool WindowTrackerInit(WindowTracker *t, Display *display, Window own);
+void WindowTrackerFree(WindowTracker *t);
+
+// Handle whatever events have already arrived, without waiting on the
+// server. The changes are valid until the next call.
+int WindowTrackerPoll(WindowTracker *t, const TrackerChange **changes);
+
+#endif // TRACKER_H
@@ -0,0 +1,104 @@
+#include "upload.h"
+#include "rlgl.h"
+
+#if defined(GRAPHICS_API_OPENGL_33) || defined(GRAPHICS_API_OPENGL_43)
+#define UPLOAD_PBO 1
+#include "external/glad.h" // function pointers are loaded by rlgl
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+static bool stream_pbo = false;
+
+void TextureStreamInit(bool use_pbo) {
+#ifdef UPLOAD_PBO
+    stream_pbo = use_pbo && rlGetVersion() >= RL_OPENGL_33;
+#else
+    (void)use_pbo;
+    stream_pbo = false;
+#endif
+    TraceLog(LOG_INFO, "UPLOAD: Window textures use %s", stream_pbo ? "pixel buffer streaming" : "synchronous updates");
+}
+
+bool TextureStreamUsesPbo(void) {
+    return stream_pbo;
+}
+
+static void UpdateTextureSync(Texture texture, const Rectangle *rects, int rect_count, const unsigned char *pixels) {
+    if (rects == NULL) {
+        UpdateTexture(texture, pixels);
+        return;
+    }
+
+    for (int i = 0; i < rect_count; i++) {
+        UpdateTextureRec(texture, rects[i], pixels);
+        pixels += (size_t)rects[i].width * (size_t)rects[i].height * 4;
+    }
+}
+
+#ifdef UPLOAD_PBO
+static bool UpdateTexturePbo(TextureStream *stream, Texture texture, const Rectangle *rects, int rect_count, const unsigned char *pixels) {
+    Rectangle whole = {0, 0, texture.width, texture.height};
+    if (rects == NULL) {
+        rects = &whole;
+        rect_count = 1;
+    }
+
+    size_t size = 0;
+    for (int i = 0; i < rect_count; i++) {
+        size += (size_t)rects[i].width * (size_t)rects[i].height * 4;
+    }
+
+    if (stream->pbo[0] == 0) {
+        glGenBuffers(UPLOAD_RING_SIZE, stream->pbo);
+    }
+    unsigned int pbo = stream->pbo[stream->next];
+    stream->next = (stream->next + 1) % UPLOAD_RING_SIZE;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+
+    // Orphan the old storage: if the GPU is still reading the previous upload
+    // the driver hands us fresh memory instead of waiting for it
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dst == NULL) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    memcpy(dst, pixels, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // With an unpack buffer bound the data pointer is an offset into it
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    uintptr_t offset = 0;
+    for (int i = 0; i < rect_count; i++) {
+        Rectangle r = rects[i];
+        glTexSubImage2D(GL_TEXTURE_2D, 0, (int)r.x, (int)r.y, (int)r.width, (int)r.height,
+                        GL_RGBA, GL_UNSIGNED_BYTE, (const void *)offset);
+        offset += (uintptr_t)r.width * (uintptr_t)r.height * 4;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return true;
+}
+#endif
+
+void TextureStreamUpdate(TextureStream *stream, Texture texture, const Rectangle *rects, int rect_count, const void *pixels) {
+#ifdef UPLOAD_PBO
+    if (stream_pbo && UpdateTexturePbo(stream, texture, rects, rect_count, pixels)) return;
+#else
+    (void)stream;
+#endif
+    UpdateTextureSync(texture, rects, rect_count, pixels);
+}
+
+void TextureStreamUnload(TextureStream *stream) {
+#ifdef UPLOAD_PBO
+    if (stream->pbo[0] != 0) {
+        glDeleteBuffers(UPLOAD_RING_SIZE, stream->pbo);
+    }
+#endif
+    memset(stream, 0, sizeof(TextureStream));
+}
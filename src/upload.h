@@ -0,0 +1,28 @@
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include "raylib.h"
+
+#include <stdbool.h>
+
+#define UPLOAD_RING_SIZE 3
+
+// Streams pixels into a texture through a ring of pixel buffer objects.
+// The copy into the PBO returns immediately and the GPU pulls the data in
+// when it gets to it, instead of glTexSubImage2D blocking on client memory.
+typedef struct {
+    unsigned int pbo[UPLOAD_RING_SIZE];
+    int next;
+} TextureStream;
+
+// Call once after InitWindow. Without PBO support (GL 1.1/ES2) or with
+// use_pbo = false every update goes through UpdateTexture.
+void TextureStreamInit(bool use_pbo);
+bool TextureStreamUsesPbo(void);
+
+// Upload rects of the texture, their pixels packed back to back as RGBA.
+// rects == NULL updates the whole texture.
+void TextureStreamUpdate(TextureStream *stream, Texture texture, const Rectangle *rects, int rect_count, const void *pixels);
+void TextureStreamUnload(TextureStream *stream);
+
+#endif // UPLOAD_H
@@ -0,0 +1,1271 @@
+#include "wm.h"
+#define GLFW_INCLUDE_NONE
+#include "GLFW/glfw3.h"
+#define GLFW_EXPOSE_NATIVE_X11
+#include "GLFW/glfw3native.h"
+#include "rcamera.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include "swizzle.h"
+#include "billboard.h"
+#include "profile.h"
+#include "da.h"
+
+#include <X11/Xutil.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define SCREEN_WIDTH 800
+#define SCREEN_HEIGHT 600
+#define PROFILE_TRACE_PATH "3dwm-trace.json"
+// Longest an idle loop sleeps, in case something changes without waking it
+#define IDLE_TIMEOUT 1.0
+// Long side of the stand-in an evicted window's texture is shrunk to
+#define PLACEHOLDER_SIZE 128
+// Between the selected window and the rest, so a window that comes back
+// into view loses its placeholder quickly
+#define PLACEHOLDER_PRIORITY 50.0f
+
+const Vector3 ORIGIN = {0.0f, 0.0f, 0.0f};
+
+Color GetModeColor(ControlMode m) {
+    switch (m) {
+        case CameraMovement: return BLUE;
+        case CursorMovement: return GREEN;
+        case ScaleWindow:
+        case MoveWindowZ:
+        case MoveWindowXY: return RED;
+        case InteractWindow: return PURPLE;
+        default: return BLACK;
+    }
+}
+
+const char *GetModeText(ControlMode m) {
+    switch (m) {
+        case CameraMovement: return "Camera Movement";
+        case CursorMovement: return "Cursor Movement";
+        case ScaleWindow: return "Scale Window";
+        case MoveWindowZ:
+        case MoveWindowXY: return "Move Window";
+        case InteractWindow: return "Interact";
+        default: return "Unknown Mode";
+    }
+}
+
+void MyUpdateCamera(Camera *camera) {
+#define CAMERA_MOUSE_MOVE_SENSITIVITY 0.005f
+#define CAMERA_MOVE_SPEED 10.0f // Units per second
+    bool moveInWorldPlane = true;
+    bool rotateAroundTarget = false;
+    bool lockView = false;
+    bool rotateUp = false;
+
+    // Keyboard support. The first frame after sleeping in WMWait counts the
+    // whole sleep, so don't let it jump.
+    float frameTime = GetFrameTime();
+    if (frameTime > 0.1f) frameTime = 0.1f;
+    float cameraMoveSpeed = CAMERA_MOVE_SPEED * frameTime;
+    if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W))
+        CameraMoveForward(camera, cameraMoveSpeed, moveInWorldPlane);
+    if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S))
+        CameraMoveForward(camera, -cameraMoveSpeed, moveInWorldPlane);
+
+    if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A))
+        CameraMoveRight(camera, -cameraMoveSpeed, moveInWorldPlane);
+    if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D))
+        CameraMoveRight(camera, cameraMoveSpeed, moveInWorldPlane);
+
+    if (IsKeyPressed(KEY_F2))
+        camera->target.x = camera->target.y = camera->target.z = 0.0f;
+    if (IsKeyDown(KEY_F3))
+        CameraMoveUp(camera, -cameraMoveSpeed);
+    if (IsKeyDown(KEY_F4))
+        CameraMoveUp(camera, cameraMoveSpeed);
+
+    // Mouse-based rotation
+    Vector2 mousePosition = GetMousePosition();
+    Vector2 screenCenter = {GetScreenWidth() / 2.0f, GetScreenHeight() / 2.0f};
+    Vector2 mouseDelta = {mousePosition.x - screenCenter.x, mousePosition.y - screenCenter.y};
+
+    float rotationSpeed = CAMERA_MOUSE_MOVE_SENSITIVITY;
+    CameraYaw(camera, -mouseDelta.x * rotationSpeed, rotateAroundTarget);
+    CameraPitch(camera, -mouseDelta.y * rotationSpeed, lockView, rotateAroundTarget, rotateUp);
+
+    // Reset mouse position to center of the screen, unless it's there
+    // already: every warp is another event to wake up for
+    if (mouseDelta.x != 0.0f || mouseDelta.y != 0.0f) {
+        SetMousePosition(screenCenter.x, screenCenter.y);
+    }
+
+    // print camera position
+    //  printf("Camera position: (%f, %f, %f)\n", camera->position.x, camera->position.y, camera->position.z);
+    //  printf("Camera target: (%f, %f, %f)\n", camera->target.x, camera->target.y, camera->target.z);
+}
+
+WindowResources *GetWindowResources(WMState *wm, int i) {
+    return WindowRegistryPayload(&wm->windows, i);
+}
+
+// Index of the selected window, -1 if there isn't one (anymore)
+int GetSelectedIndex(const WMState *wm) {
+    return WindowRegistryIndex(&wm->windows, wm->selected);
+}
+
+void SetWindowTexture(WMState *wm, int i, Texture texture) {
+    wm->windows.texture[i] = texture;
+    SetTextureFilter(texture, texture.mipmaps > 1 ? TEXTURE_FILTER_TRILINEAR : TEXTURE_FILTER_BILINEAR);
+}
+
+// Bind the window's redirected pixmap straight into its texture
+void MyUpdatePixmapTexture(WMState *wm, int i, const CaptureFrame *frame) {
+    WindowResources *res = GetWindowResources(wm, i);
+    if (!PixmapTextureSupportsDepth(frame->depth)) {
+        // Nothing to bind this visual to, fall back to reading pixels
+        PixmapTextureUnload(&res->pixmap_texture);
+        wm->windows.texture[i] = (Texture){0};
+        CaptureSourceRequestCopies(res->source);
+        return;
+    }
+
+    unsigned int id = res->pixmap_texture.id;
+    if (!PixmapTextureBind(&res->pixmap_texture, frame->pixmap, frame->depth, frame->width, frame->height)) return;
+
+    Texture texture = wm->windows.texture[i];
+    if (id != res->pixmap_texture.id || texture.width != frame->width || texture.height != frame->height) {
+        SetWindowTexture(wm, i, (Texture){
+            .id = res->pixmap_texture.id,
+            .width = frame->width,
+            .height = frame->height,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        });
+    }
+}
+
+// Upload the newest frame the capture workers published for this window.
+// Returns the frame if it made it into the texture.
+const CaptureFrame *MyUpdateTexture(WMState *wm, int i) {
+    WindowResources *res = GetWindowResources(wm, i);
+    CaptureFrame *frame = CaptureSourceLatest(res->source);
+    if (frame == NULL) return NULL;
+
+    WindowSchedule *schedule = &wm->windows.schedule[i];
+    schedule->width = frame->width;
+    schedule->height = frame->height;
+
+    // The placeholder stays up until there's a whole frame to replace it
+    if (res->placeholder) {
+        if (frame->pixmap == None && frame->rect_count != CAPTURE_FULL) {
+            CaptureSourceRequestFull(res->source);
+            return NULL;
+        }
+        UnloadTexture(wm->windows.texture[i]);
+        wm->windows.texture[i] = (Texture){0};
+        res->placeholder = false;
+    }
+
+    if (frame->pixmap != None) {
+        MyUpdatePixmapTexture(wm, i, frame);
+        return frame;
+    }
+
+    // The texture is only as big as the level the window was captured at
+    Texture *texture = &wm->windows.texture[i];
+    int lod = frame->lod;
+    int width = frame->width >> lod;
+    int height = frame->height >> lod;
+    bool resized = texture->width != width || texture->height != height;
+    if (frame->rect_count != CAPTURE_FULL) {
+        if (texture->id == 0 || resized) {
+            // Partial update for a texture we don't have; start over
+            CaptureSourceRequestFull(res->source);
+            return NULL;
+        }
+
+        Rectangle rects[CAPTURE_MAX_RECTS];
+        for (int r = 0; r < frame->rect_count; r++) {
+            XRectangle rect = frame->rects[r];
+            rects[r] = (Rectangle){rect.x >> lod, rect.y >> lod, rect.width >> lod, rect.height >> lod};
+        }
+        TextureStreamUpdate(&res->stream, *texture, rects, frame->rect_count, frame->pixels);
+        for (int r = 0; r < frame->rect_count; r++) {
+            PROFILE_COUNT(PROFILE_BYTES_UPLOADED, (size_t)(rects[r].width * rects[r].height) * 4);
+        }
+    }
+    else if (texture->id == 0 || resized) {
+        if (texture->id != 0) {
+            UnloadTexture(*texture);
+        }
+
+        // The frame pixels stay owned by the capture worker
+        Image rlImg = {
+            .data = frame->pixels,
+            .width = width,
+            .height = height,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, // Raylib does not have a B8R8G8 format
+        };
+
+        Texture loaded = LoadTextureFromImage(rlImg);
+        if (loaded.id == 0) {
+            fprintf(stderr, "Unable to load texture\n");
+            exit(1);
+        }
+        GenTextureMipmaps(&loaded);
+        SetWindowTexture(wm, i, loaded);
+        res->mips_stale = false;
+        PROFILE_COUNT(PROFILE_BYTES_UPLOADED, (size_t)width * height * 4);
+        return frame;
+    }
+    else {
+        TextureStreamUpdate(&res->stream, *texture, NULL, 0, frame->pixels);
+        PROFILE_COUNT(PROFILE_BYTES_UPLOADED, (size_t)width * height * 4);
+    }
+
+    // The smaller levels catch up in UpdateMipmaps
+    res->mips_stale = true;
+    return frame;
+}
+
+// Whether the window covers fewer pixels on screen than its texture has,
+// which is when the smaller mip levels get sampled
+static bool DrawnMinified(const WMState *wm, int i) {
+    Texture texture = wm->windows.texture[i];
+    float pixels = wm->windows.schedule[i].screen_fraction * GetScreenWidth() * GetScreenHeight();
+    return pixels > 0.0f && pixels < (float)texture.width * texture.height;
+}
+
+// Keep the smaller levels in step so minified windows don't alias. Windows
+// drawn at full size or bigger, or not at all, never read them, so a
+// blinking cursor in one doesn't rebuild the whole chain every frame; they
+// catch up once the window shrinks.
+static void UpdateMipmaps(WMState *wm, int i) {
+    WindowResources *res = GetWindowResources(wm, i);
+    Texture *texture = &wm->windows.texture[i];
+    if (!res->mips_stale || texture->mipmaps <= 1 || !DrawnMinified(wm, i)) return;
+
+    PROFILE_BEGIN(PROFILE_UPLOAD);
+    GenTextureMipmaps(texture);
+    PROFILE_END(PROFILE_UPLOAD);
+    res->mips_stale = false;
+}
+
+void UpdateWindowPick(WMState *wm, int i) {
+    Vector3 corners[4];
+    GetWindowCorners(&wm->windows, i, corners);
+    PickIndexSet(&wm->pick, wm->windows.slot_of[i], corners);
+}
+
+// What the input thread needs to turn pointer positions into window pixels
+void GetInputView(WMState *wm, int i, InputView *view) {
+    const WindowRegistry *reg = &wm->windows;
+    *view = (InputView){
+        .position = wm->camera.position,
+        .target = wm->camera.target,
+        .up = wm->camera.up,
+        .fovy = wm->camera.fovy,
+        .screen_width = GetScreenWidth(),
+        .screen_height = GetScreenHeight(),
+        .window = GetWindowResources(wm, i)->window,
+        .inverse = MatrixInvert(reg->transform[i]),
+        .size = reg->size[i],
+        .width = reg->schedule[i].width,
+        .height = reg->schedule[i].height,
+        .source = GetWindowResources(wm, i)->source,
+    };
+}
+
+// Every transform change goes through here so picking sees it
+void SetWindowTransform(WMState *wm, int i, Matrix transform) {
+    wm->windows.transform[i] = transform;
+    UpdateWindowPick(wm, i);
+    wm->billboard_stale = true;
+    wm->redraw = true;
+}
+
+// Turn every window to face the camera, unless neither has moved since last time
+void WMBillboardWindows(WMState *wm) {
+    Vector3 eye = wm->camera.position;
+    Vector3 last = wm->billboard_target;
+    if (!wm->billboard_stale && eye.x == last.x && eye.y == last.y && eye.z == last.z) return;
+
+    PROFILE_BEGIN(PROFILE_BILLBOARD);
+    WindowRegistry *reg = &wm->windows;
+    BillboardTransforms(reg->transform, reg->count, eye);
+    for (int i = 0; i < reg->count; i++) {
+        UpdateWindowPick(wm, i);
+    }
+    PROFILE_END(PROFILE_BILLBOARD);
+
+    wm->billboard_target = eye;
+    wm->billboard_stale = false;
+    wm->redraw = true;
+}
+
+void DrawWindowBorder(const WindowRegistry *reg, int i, Color color) {
+    Vector3 corners[4];
+    GetWindowCorners(reg, i, corners);
+    Vector3 v1 = corners[0], v2 = corners[1], v3 = corners[2], v4 = corners[3];
+
+    DrawSphere(v1, 0.02f, RED);
+    DrawSphere(v2, 0.02f, YELLOW);
+    DrawSphere(v3, 0.02f, GREEN);
+    DrawSphere(v4, 0.02f, BLUE);
+
+    DrawLine3D(v1, v2, color);
+    DrawLine3D(v2, v4, color);
+    DrawLine3D(v4, v3, color);
+    DrawLine3D(v3, v1, color);
+}
+
+void DrawWindowNormal(const WindowRegistry *reg, int i, Color color) {
+    Vector3 normal = GetWindowNormal(reg, i);
+    Vector3 center = GetWindowCenter(reg, i);
+
+    // Draw the normal vector
+    Vector3 endPoint = Vector3Add(center, Vector3Scale(normal, 0.5f)); // Adjust the 0.5f to change the length of the normal
+    DrawLine3D(center, endPoint, color);
+
+    // Draw a small sphere at the end of the normal vector
+    DrawSphere(endPoint, 0.02f, color);
+}
+
+size_t TextureBytes(Texture texture) {
+    if (texture.id == 0) return 0;
+    size_t bytes = (size_t)texture.width * texture.height * 4;
+    // A full mip chain adds a third
+    return texture.mipmaps > 1 ? bytes + bytes / 3 : bytes;
+}
+
+// Shrink a texture into a new one no bigger than PLACEHOLDER_SIZE on the GPU
+Texture MakePlaceholder(Texture texture) {
+    int width = texture.width;
+    int height = texture.height;
+    while (width > PLACEHOLDER_SIZE || height > PLACEHOLDER_SIZE) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+
+    RenderTexture target = LoadRenderTexture(width, height);
+    if (target.id == 0) return (Texture){0};
+    BeginTextureMode(target);
+    ClearBackground(BLANK);
+    // Render targets come out upside down; flip on the way in so the
+    // placeholder is drawn like any other texture
+    Rectangle source = {0.0f, 0.0f, (float)texture.width, -(float)texture.height};
+    DrawTexturePro(texture, source, (Rectangle){0.0f, 0.0f, width, height}, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+    EndTextureMode();
+
+    // Only the color attachment is kept
+    rlUnloadFramebuffer(target.id);
+    SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);
+    return target.texture;
+}
+
+// Swap a window's texture for a placeholder, or drop the placeholder if it
+// already has one
+void EvictTexture(WMState *wm, int i) {
+    WindowResources *res = GetWindowResources(wm, i);
+    Texture texture = wm->windows.texture[i];
+    if (res->placeholder) {
+        UnloadTexture(texture);
+        wm->windows.texture[i] = (Texture){0};
+        res->placeholder = false;
+        return;
+    }
+
+    Texture placeholder = MakePlaceholder(texture);
+    if (texture.id == res->pixmap_texture.id) {
+        PixmapTextureUnload(&res->pixmap_texture);
+    }
+    else {
+        UnloadTexture(texture);
+    }
+    TextureStreamUnload(&res->stream);
+    wm->windows.texture[i] = placeholder;
+    res->placeholder = placeholder.id != 0;
+    res->evicted = true;
+}
+
+// The out of view window that was seen the longest ago and still has a full
+// texture, or only a placeholder if !full. -1 if there is none.
+int FindEviction(WMState *wm, bool full) {
+    const WindowRegistry *reg = &wm->windows;
+    int oldest = -1;
+    for (int i = 0; i < reg->count; i++) {
+        if (reg->schedule[i].screen_fraction > 0.0f || reg->texture[i].id == 0) continue;
+        if (GetWindowResources(wm, i)->placeholder == full) continue;
+        if (oldest < 0 || reg->schedule[i].last_seen < reg->schedule[oldest].last_seen) oldest = i;
+    }
+    return oldest;
+}
+
+// Keep window textures within options.texture_budget_mb: demote windows out
+// of view to placeholders, least recently seen first, and then drop their
+// placeholders too. Windows in view are never touched, so what's on screen
+// can still go over the budget.
+void EnforceTextureBudget(WMState *wm) {
+    const WindowRegistry *reg = &wm->windows;
+    size_t total = 0;
+    for (int i = 0; i < reg->count; i++) {
+        total += TextureBytes(reg->texture[i]);
+    }
+
+    size_t budget = (size_t)(wm->options.texture_budget_mb * 1024.0f * 1024.0f);
+    while (budget > 0 && total > budget) {
+        int i = FindEviction(wm, true);
+        if (i < 0) i = FindEviction(wm, false);
+        if (i < 0) break;
+
+        total -= TextureBytes(reg->texture[i]);
+        EvictTexture(wm, i);
+        total += TextureBytes(reg->texture[i]);
+    }
+    wm->texture_bytes = total;
+}
+
+int CompareUpdatePriority(const void *a, const void *b) {
+    float pa = ((const UpdateEntry *)a)->priority;
+    float pb = ((const UpdateEntry *)b)->priority;
+    return (pa < pb) - (pa > pb);
+}
+
+// Tell the capture workers how often each window should be refreshed, then
+// upload waiting frames in priority order until the frame's budget is spent
+void WMScheduleUpdates(WMState *wm) {
+    const SchedulerConfig *config = &wm->options.schedule;
+    SchedulerView view = SchedulerViewFromCamera(wm->camera, GetScreenWidth(), GetScreenHeight());
+    WindowRegistry *reg = &wm->windows;
+    int selected = GetSelectedIndex(wm);
+    double now = GetTime();
+
+    // Windows completely behind others are as good as out of view: neither
+    // drawn nor captured
+    OcclusionBegin(&wm->occlusion, &view, wm->options.no_occlusion ? 0 : reg->count);
+    if (!wm->options.no_occlusion) {
+        PROFILE_BEGIN(PROFILE_OCCLUSION);
+        for (int i = 0; i < reg->count; i++) {
+            if (!(reg->flags[i] & WINDOW_VISIBLE)) continue;
+            Vector3 corners[4];
+            GetWindowCorners(reg, i, corners);
+            Vector3 perimeter[4] = {corners[0], corners[1], corners[3], corners[2]};
+            OcclusionAdd(&wm->occlusion, i, perimeter);
+        }
+        OcclusionResolve(&wm->occlusion);
+        PROFILE_END(PROFILE_OCCLUSION);
+    }
+
+    wm->update_queue.count = 0;
+    for (int i = 0; i < reg->count; i++) {
+        Vector3 corners[4];
+        GetWindowCorners(reg, i, corners);
+        // Mesh vertex order zigzags; the scheduler wants the perimeter
+        Vector3 perimeter[4] = {corners[0], corners[1], corners[3], corners[2]};
+
+        bool occluded = OcclusionHidden(&wm->occlusion, i);
+        bool visible = (reg->flags[i] & WINDOW_VISIBLE) && !occluded;
+        float hz = ScheduleWindow(&view, config, &reg->schedule[i], perimeter, visible, i == selected, now);
+        WindowResources *res = GetWindowResources(wm, i);
+        CaptureSourceSetRate(res->source, hz);
+        CaptureSourceSetLod(res->source, reg->schedule[i].lod);
+
+        if (!occluded && (reg->flags[i] & WINDOW_OCCLUDED)) {
+            // Uncovered, with a texture from when it was covered
+            CaptureSourceExpedite(res->source);
+        }
+        if (occluded) reg->flags[i] |= WINDOW_OCCLUDED;
+        else reg->flags[i] &= ~WINDOW_OCCLUDED;
+
+        if (res->evicted && reg->schedule[i].screen_fraction > 0.0f) {
+            // Back in view: recapture it whole, right away
+            res->evicted = false;
+            CaptureSourceRequestFull(res->source);
+            CaptureSourceExpedite(res->source);
+        }
+
+        if (CaptureSourcePending(res->source)) {
+            float priority = reg->schedule[i].priority + (res->placeholder ? PLACEHOLDER_PRIORITY : 0.0f);
+            da_append(&wm->update_queue, ((UpdateEntry){i, priority}));
+        }
+    }
+
+    qsort(wm->update_queue.items, wm->update_queue.count, sizeof(UpdateEntry), CompareUpdatePriority);
+    // Whatever the budget leaves waiting is picked up on the next frame
+    if (wm->update_queue.count > 0) wm->redraw = true;
+
+    // Always make some progress, even if one update alone blows the budget
+    double spent_ms = 0.0;
+    PixmapTextureBeginFrame();
+    for (size_t q = 0; q < wm->update_queue.count; q++) {
+        int i = wm->update_queue.items[q].index;
+        if (q > 0 && spent_ms + reg->schedule[i].update_ms > config->budget_ms) continue;
+
+        double start = GetTime();
+        PROFILE_BEGIN(PROFILE_UPLOAD);
+        const CaptureFrame *frame = MyUpdateTexture(wm, i);
+        PROFILE_END(PROFILE_UPLOAD);
+        double end = GetTime();
+        if (frame != NULL && wm->on_upload != NULL) {
+            wm->on_upload(wm->on_upload_data, i, frame);
+        }
+
+        float ms = (float)((end - start) * 1000.0);
+        ScheduleRecordUpdate(&reg->schedule[i], end, ms);
+        spent_ms += ms;
+    }
+    if (!PixmapTextureEndFrame()) {
+        // Some pixmap went before we bound it; have the workers send the
+        // windows' current ones
+        for (size_t q = 0; q < wm->update_queue.count; q++) {
+            WindowResources *res = GetWindowResources(wm, wm->update_queue.items[q].index);
+            if (PixmapTextureDiscardFailed(&res->pixmap_texture)) {
+                CaptureSourceRequestFull(res->source);
+            }
+        }
+    }
+
+    for (int i = 0; i < reg->count; i++) {
+        UpdateMipmaps(wm, i);
+    }
+    EnforceTextureBudget(wm);
+}
+
+// Put a window back the way the last session left it, showing the frame it
+// had then until its first capture comes in
+void RestoreWindow(WMState *wm, int i) {
+    WindowResources *res = GetWindowResources(wm, i);
+    const SessionEntry *saved = SessionFind(wm->session, (uint32_t)res->window);
+    if (saved == NULL) return;
+
+    WindowRegistry *reg = &wm->windows;
+    reg->flags[i] = saved->flags & WINDOW_VISIBLE;
+    reg->schedule[i].refresh_hz = saved->refresh_hz;
+    SetWindowTransform(wm, i, saved->transform);
+
+    // It was resized since; the thumbnail would be stretched
+    if (saved->width != res->width || saved->height != res->height) return;
+    Image thumbnail = SessionThumbnail(wm->session, saved);
+    if (thumbnail.data == NULL) return;
+    Texture texture = LoadTextureFromImage(thumbnail);
+    UnloadImage(thumbnail);
+    if (texture.id == 0) return;
+
+    // Replaced by the first full frame, like an evicted window's
+    SetWindowTexture(wm, i, texture);
+    res->placeholder = true;
+}
+
+// Where every window is and a thumbnail of what it shows, for the next run
+void SaveSession(WMState *wm) {
+    const WindowRegistry *reg = &wm->windows;
+    int count = reg->count;
+    SessionEntry *entries = calloc(count > 0 ? count : 1, sizeof(SessionEntry));
+    Image *thumbnails = calloc(count > 0 ? count : 1, sizeof(Image));
+    if (entries == NULL || thumbnails == NULL) {
+        fprintf(stderr, "Failed to allocate memory for session\n");
+        free(entries);
+        free(thumbnails);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        WindowResources *res = GetWindowResources(wm, i);
+        entries[i] = (SessionEntry){
+            .window = (uint32_t)res->window,
+            .width = res->width,
+            .height = res->height,
+            .transform = reg->transform[i],
+            .flags = reg->flags[i] & WINDOW_VISIBLE,
+            .refresh_hz = reg->schedule[i].refresh_hz,
+        };
+
+        Texture texture = reg->texture[i];
+        if (texture.id == 0) continue;
+        Texture small = res->placeholder ? texture : MakePlaceholder(texture);
+        if (small.id == 0) continue;
+        Image thumbnail = LoadImageFromTexture(small);
+        if (small.id != texture.id) UnloadTexture(small);
+        if (thumbnail.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) thumbnails[i] = thumbnail;
+        else UnloadImage(thumbnail);
+    }
+
+    SessionSave(wm->options.session_path, &wm->camera, entries, thumbnails, count);
+    for (int i = 0; i < count; i++) {
+        UnloadImage(thumbnails[i]);
+    }
+    free(entries);
+    free(thumbnails);
+}
+
+// Where a window first shows up: where it sits on the X screen, scaled the
+// same as its size, with later windows a little in front of earlier ones
+Vector3 GetWindowPlacement(const WMState *wm, const TrackedWindow *t) {
+    int screen = DefaultScreen(wm->display);
+    float cx = t->x + t->width / 2.0f - DisplayWidth(wm->display, screen) / 2.0f;
+    float cy = DisplayHeight(wm->display, screen) / 2.0f - (t->y + t->height / 2.0f);
+    return (Vector3){cx / 350.0f, cy / 350.0f + 2.0f, -2.0f + 0.05f * wm->windows.count};
+}
+
+// Start capturing an X window and place it in the scene, facing the camera
+WindowHandle WMAddWindow(WMState *wm, const TrackedWindow *t) {
+    // The texture is created once the first frame comes back from the workers
+    CaptureSource *source = CaptureSourceAdd(wm->capture, t->window);
+    if (source == NULL) {
+        return WINDOW_HANDLE_NONE;
+    }
+
+    WindowRegistry *reg = &wm->windows;
+    Vector3 pos = GetWindowPlacement(wm, t);
+    WindowHandle handle = WindowRegistryAdd(reg);
+    int i = WindowRegistryIndex(reg, handle);
+
+    WindowResources *res = GetWindowResources(wm, i);
+    res->window = t->window;
+    res->width = t->width;
+    res->height = t->height;
+    res->source = source;
+
+    reg->size[i] = (Vector2){t->width / 350.0f, t->height / 350.0f};
+    reg->schedule[i].refresh_hz = SCHEDULER_AUTO_HZ;
+    reg->flags[i] = WINDOW_VISIBLE;
+    SetWindowTransform(wm, i, LookAtTarget(MatrixTranslate(pos.x, pos.y, pos.z), wm->camera.position));
+    if (wm->session != NULL) {
+        RestoreWindow(wm, i);
+    }
+    return handle;
+}
+
+void WMRemoveWindow(WMState *wm, WindowHandle handle) {
+    int i = WindowRegistryIndex(&wm->windows, handle);
+    if (i < 0) return;
+
+    // The input thread holds on to the source while it forwards to it
+    if (wm->mode == InteractWindow && handle.slot == wm->selected.slot && wm->input != NULL) {
+        InputEnd(wm->input);
+    }
+
+    WindowResources *res = GetWindowResources(wm, i);
+    TextureStreamUnload(&res->stream);
+
+    // A bound pixmap's texture belongs to pixmap_texture
+    Texture texture = wm->windows.texture[i];
+    if (texture.id != 0 && texture.id != res->pixmap_texture.id) {
+        UnloadTexture(texture);
+    }
+    PixmapTextureUnload(&res->pixmap_texture);
+    // Only once nothing on this side uses its pixmap anymore
+    CaptureSourceRemove(res->source);
+
+    PickIndexRemove(&wm->pick, handle.slot);
+    WindowRegistryRemove(&wm->windows, handle);
+    wm->redraw = true;
+}
+
+int FindWindowIndex(WMState *wm, Window window) {
+    for (int i = 0; i < wm->windows.count; i++) {
+        if (GetWindowResources(wm, i)->window == window) return i;
+    }
+    return -1;
+}
+
+// Bring the scene in line with the windows that opened, closed or resized
+void WMSyncWindows(WMState *wm) {
+    const TrackerChange *changes;
+    int count = WindowTrackerPoll(&wm->tracker, &changes);
+
+    for (int c = 0; c < count; c++) {
+        const TrackedWindow *t = &changes[c].window;
+        int i = FindWindowIndex(wm, t->window);
+        switch (changes[c].type) {
+            case TRACKER_SHOW:
+                if (i < 0) {
+                    WindowHandle handle = WMAddWindow(wm, t);
+                    if (GetSelectedIndex(wm) < 0) wm->selected = handle;
+                }
+                break;
+            case TRACKER_HIDE:
+                if (i >= 0) WMRemoveWindow(wm, WindowRegistryHandle(&wm->windows, i));
+                break;
+            case TRACKER_RESIZE:
+                if (i >= 0) {
+                    WindowResources *res = GetWindowResources(wm, i);
+                    res->width = t->width;
+                    res->height = t->height;
+                    wm->windows.size[i] = (Vector2){t->width / 350.0f, t->height / 350.0f};
+                    SetWindowTransform(wm, i, wm->windows.transform[i]);
+                }
+                break;
+        }
+    }
+}
+
+float NextRefreshOverride(float hz) {
+    // auto -> 60 -> 30 -> 10 -> 0 -> auto
+    if (hz == SCHEDULER_AUTO_HZ) return 60.0f;
+    if (hz > 30.0f) return 30.0f;
+    if (hz > 10.0f) return 10.0f;
+    if (hz > 0.0f) return 0.0f;
+    return SCHEDULER_AUTO_HZ;
+}
+
+// What WMDraw shows besides the windows, to tell whether it changed
+typedef struct {
+    Camera camera;
+    ControlMode mode;
+    WindowHandle selected;
+    Ray ray;
+    bool show_controls;
+    bool show_profile;
+    int screen_width;
+    int screen_height;
+} ViewState;
+
+void GetViewState(const WMState *wm, ViewState *view) {
+    // Compared with memcmp, so no stray bytes in the padding
+    memset(view, 0, sizeof(ViewState));
+    view->camera = wm->camera;
+    view->mode = wm->mode;
+    view->selected = wm->selected;
+    view->ray = wm->ray;
+    view->show_controls = wm->show_controls;
+    view->show_profile = wm->show_profile;
+    view->screen_width = GetScreenWidth();
+    view->screen_height = GetScreenHeight();
+}
+
+void WMUpdate(WMState *wm) {
+    // Input was just polled; anything that wakes us from here on has to
+    // wake the next wait too
+    if (wm->idle != NULL) IdleRearm(wm->idle);
+    ViewState before;
+    GetViewState(wm, &before);
+
+    WMSyncWindows(wm);
+
+    WindowRegistry *reg = &wm->windows;
+    int selected = GetSelectedIndex(wm);
+    if (selected < 0 && wm->mode != CameraMovement) {
+        // The window being edited went away
+        wm->mode = CursorMovement;
+    }
+
+    if (wm->mode == CameraMovement) {
+        MyUpdateCamera(&wm->camera);
+        if (IsKeyPressed(KEY_Q) || IsKeyPressed(KEY_SPACE) || IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            wm->mode = CursorMovement;
+            EnableCursor();
+        }
+        else if (IsKeyPressed(KEY_H)) {
+            for (int i = 0; i < reg->count; i++) {
+                reg->flags[i] ^= WINDOW_VISIBLE;
+            }
+            wm->redraw = true;
+        }
+        else {
+            WMBillboardWindows(wm);
+        }
+    }
+    else if (wm->mode == CursorMovement) {
+        if (IsKeyPressed(KEY_SPACE)) {
+            wm->mode = CameraMovement;
+            DisableCursor();
+        }
+        else if (IsKeyPressed(KEY_H)) {
+            for (int i = 0; i < reg->count; i++) {
+                reg->flags[i] ^= WINDOW_VISIBLE;
+            }
+            wm->redraw = true;
+        }
+        else if (selected >= 0 && IsKeyPressed(KEY_R)) {
+            WindowSchedule *schedule = &reg->schedule[selected];
+            schedule->refresh_hz = NextRefreshOverride(schedule->refresh_hz);
+            wm->redraw = true;
+        }
+        else if (selected >= 0 && IsKeyPressed(KEY_S)) {
+            wm->mode = ScaleWindow;
+            wm->original_transform = reg->transform[selected];
+        }
+        else if (selected >= 0 && IsKeyPressed(KEY_Z)) {
+            wm->mode = MoveWindowZ;
+            wm->original_transform = reg->transform[selected];
+            wm->original_mouse_position = GetMousePosition();
+        }
+        else if (selected >= 0 && IsKeyPressed(KEY_G)) {
+            wm->mode = MoveWindowXY;
+            wm->original_transform = reg->transform[selected];
+            wm->original_mouse_position = GetMousePosition();
+        }
+        else if (selected >= 0 && wm->input != NULL && IsKeyPressed(KEY_ENTER)) {
+            InputView view;
+            GetInputView(wm, selected, &view);
+            InputBegin(wm->input, &view);
+            wm->mode = InteractWindow;
+        }
+        else {//if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            wm->ray = GetScreenToWorldRay(GetMousePosition(), wm->camera);
+
+            PROFILE_BEGIN(PROFILE_PICK);
+            int hit = PickIndexCast(&wm->pick, wm->ray, &wm->collision);
+            PROFILE_END(PROFILE_PICK);
+            if (hit >= 0) {
+                wm->selected = WindowRegistryHandle(reg, WindowRegistrySlotIndex(reg, hit));
+            }
+        }
+    }
+    else if (wm->mode == ScaleWindow) {
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            wm->mode = CursorMovement;
+        }
+        else if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_CAPS_LOCK)) {
+            wm->mode = CursorMovement;
+            SetWindowTransform(wm, selected, wm->original_transform);
+        }
+        else {
+            //TODO: maybe scale based on mouse velocity instead
+            //      maybe wrap around the screen
+
+            // scale based on mouse position distance from the center of the screen
+            // the closer to the center, the smaller the scale
+            // the further from the center, the larger the scale
+            // should scale quadratically
+
+            Vector2 mousePosition = GetMousePosition();
+            Vector2 screenCenter = {GetScreenWidth() / 2.0f, GetScreenHeight() / 2.0f};
+            Vector2 mouseDelta = {mousePosition.x - screenCenter.x, mousePosition.y - screenCenter.y};
+            float scale = Vector2Length(mouseDelta) / (GetScreenWidth() / 2.0f);
+            scale *= 5*scale; // scale quadratically
+            if (scale < 0.03f) scale = 0.03f; // minimum scale
+            if (scale > 10.0f) scale = 10.0f; // maximum scale
+            Matrix scaleMat = MatrixScale(scale, scale, scale);
+            SetWindowTransform(wm, selected, MatrixMultiply(scaleMat, wm->original_transform));
+        }
+    }
+    else if (wm->mode == MoveWindowZ) {
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            wm->mode = CursorMovement;
+        }
+        else if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_CAPS_LOCK)) {
+            wm->mode = CursorMovement;
+            SetWindowTransform(wm, selected, wm->original_transform);
+        }
+        else {
+            // move window toward the camera when mouse is above center
+            // move window away from the camera when mouse is below center
+
+            Vector3 pos = {wm->original_transform.m12, wm->original_transform.m13, wm->original_transform.m14};
+            Vector3 moveDirection = Vector3Subtract(pos, wm->camera.position);
+            float scalar = (wm->original_mouse_position.y - GetMouseY()) / 60.0f;
+            Vector3 moveVector = Vector3Scale(moveDirection, scalar);
+
+            Matrix m = MatrixTranslate(moveVector.x, moveVector.y, moveVector.z);
+            SetWindowTransform(wm, selected, MatrixMultiply(wm->original_transform, m));
+        }
+    }
+    else if (wm->mode == MoveWindowXY) {
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            wm->mode = CursorMovement;
+        }
+        else if (IsKeyPressed(KEY_ESCAPE) || IsKeyPressed(KEY_CAPS_LOCK)) {
+            wm->mode = CursorMovement;
+            SetWindowTransform(wm, selected, wm->original_transform);
+        }
+        else {
+            Vector2 mousePosition = GetMousePosition();
+            Matrix orig_t = wm->original_transform;
+            Vector3 pos = {orig_t.m12, orig_t.m13, orig_t.m14};
+            Vector3 directionOfWindow = Vector3Subtract(pos, wm->camera.position);
+
+            Vector3 forward = Vector3Normalize(Vector3Subtract(wm->camera.target, wm->camera.position));
+            Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, wm->camera.up));
+
+            Vector3 moveDirectionX = Vector3RotateByAxisAngle(directionOfWindow, wm->camera.up, (wm->original_mouse_position.x - mousePosition.x) / 800.0f);
+            Vector3 moveDirection = Vector3RotateByAxisAngle(moveDirectionX, right, (wm->original_mouse_position.y - mousePosition.y) / 800.0f);
+
+            Vector3 moveVector = Vector3Subtract(moveDirection, directionOfWindow);
+
+            float scale = Vector3Length((Vector3){orig_t.m0, orig_t.m1, orig_t.m2});
+            Vector3 newPos = Vector3Add(pos, moveVector);
+
+            Matrix m = MatrixMultiply(
+                MatrixScale(scale, scale, scale),
+                MatrixTranslate(newPos.x, newPos.y, newPos.z));
+            SetWindowTransform(wm, selected, LookAtTarget(m, wm->camera.position));
+        }
+    }
+    else if (wm->mode == InteractWindow) {
+        // Input goes straight from the input thread to the window; this only
+        // keeps it up to date with where the window is
+        if (!InputActive(wm->input)) {
+            wm->mode = CursorMovement;
+        }
+        else {
+            InputView view;
+            GetInputView(wm, selected, &view);
+            InputUpdate(wm->input, &view);
+        }
+    }
+
+    WMScheduleUpdates(wm);
+
+    if (IsKeyPressed(KEY_F1)) {
+        wm->show_controls = !wm->show_controls;
+    }
+#ifdef PROFILE_ENABLED
+    if (IsKeyPressed(KEY_F5)) {
+        wm->show_profile = !wm->show_profile;
+    }
+    if (IsKeyPressed(KEY_F6)) {
+        if (!ProfileTraceRecording()) {
+            ProfileTraceStart();
+        }
+        else if (ProfileTraceStop(PROFILE_TRACE_PATH)) {
+            printf("Wrote trace to %s\n", PROFILE_TRACE_PATH);
+        }
+    }
+#endif
+
+    ViewState after;
+    GetViewState(wm, &after);
+    if (memcmp(&before, &after, sizeof(ViewState)) != 0) wm->redraw = true;
+}
+
+bool WMNeedsDraw(WMState *wm) {
+    if (!wm->options.on_demand || wm->idle == NULL) return true;
+    // Keep the numbers moving
+    if (wm->show_profile) return true;
+    return wm->redraw;
+}
+
+void WMWait(WMState *wm) {
+    // Events already read off the socket wouldn't wake the watcher
+    if (wm->idle == NULL || XEventsQueued(wm->display, QueuedAlready) > 0) {
+        PollInputEvents();
+        return;
+    }
+    IdleWait(wm->idle, IDLE_TIMEOUT);
+}
+
+void WakeForFrame(void *data) {
+    IdleWake(data);
+}
+
+WMState *WMInit(const WMOptions *options) {
+    // Capture threads open their own connections
+    XInitThreads();
+
+    // Tell the window to use vsync and work on high DPI displays
+    // A scaled scene is drawn offscreen, where the hint doesn't reach
+    unsigned int flags = FLAG_WINDOW_HIGHDPI;
+    if (options->scene_ms <= 0.0f) flags |= FLAG_MSAA_4X_HINT;
+    if (!options->uncapped) flags |= FLAG_VSYNC_HINT;
+    SetConfigFlags(flags);
+
+    // Create the window and OpenGL context
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "3dwm");
+
+    WMState *wm = (WMState *)malloc(sizeof(WMState));
+    if (wm == NULL) {
+        fprintf(stderr, "Failed to allocate memory for window manager state\n");
+        return NULL;
+    }
+    memset(wm, 0, sizeof(WMState));
+    wm->options = *options;
+
+    TextureStreamInit(!options->sync_upload);
+    wm->instanced = WindowRendererInit(&wm->renderer);
+    if (!wm->instanced) {
+        wm->plane = LoadModelFromMesh(GenMeshPlane(1.0f, 1.0f, 1, 1));
+    }
+    if (options->scene_ms > 0.0f) {
+        wm->scaled = SceneTargetInit(&wm->scene, options->scene_ms);
+    }
+    if (options->tap_path != NULL) {
+        // At the rate SetTargetFPS aims for
+        wm->tap = TapStart(options->tap_path, 60);
+    }
+    WindowRegistryInit(&wm->windows, sizeof(WindowResources));
+
+    wm->camera.up = (Vector3){0.0f, 1.0f, 0.0f}; // Camera up vector (rotation towards target)
+    wm->camera.fovy = 45.0f;                     // Camera field-of-view Y
+    wm->camera.projection = CAMERA_PERSPECTIVE;  // Camera projection type
+
+    wm->camera.position = (Vector3){0, 2, 8};
+    wm->camera.target = (Vector3){0, 0, -3};
+
+    // Windows that are still open come back where they were, with their
+    // last frame, from the first frame on
+    if (options->session_path != NULL) {
+        wm->session = SessionOpen(options->session_path);
+        if (wm->session != NULL) SessionCamera(wm->session, &wm->camera);
+    }
+
+    SetTargetFPS(options->uncapped ? 0 : 60);
+    wm->show_controls = true;
+
+    wm->display = XOpenDisplay(NULL);
+    if (wm->display == NULL) {
+        fprintf(stderr, "Unable to open X display\n");
+        return NULL;
+    }
+
+    // Binding pixmaps needs GLX on the render side; otherwise read them back
+    CompositeMode composite = options->composite;
+    if (composite == COMPOSITE_PIXMAP && !PixmapTextureInit()) {
+        composite = COMPOSITE_COPY;
+    }
+
+    wm->capture = CaptureSystemInit(DisplayString(wm->display), 0, composite, options->capture);
+    if (wm->capture == NULL) {
+        fprintf(stderr, "Unable to start window capture\n");
+        return NULL;
+    }
+
+    // Sleep until there's input, a new frame or a tracker event
+    wm->idle = IdleStart(ConnectionNumber(wm->display));
+    if (wm->idle != NULL) {
+        CaptureSystemSetNotify(wm->capture, WakeForFrame, wm->idle);
+    }
+
+    // Show every window that's already open, then follow them as they come and go
+    Window own = glfwGetX11Window((GLFWwindow *)GetWindowHandle());
+    if (!WindowTrackerInit(&wm->tracker, wm->display, own)) {
+        return NULL;
+    }
+    WMSyncWindows(wm);
+    wm->mode = CursorMovement;
+    wm->redraw = true;
+
+    wm->input = InputStart(DisplayString(wm->display), own);
+
+    // disable the escape key
+    SetExitKey(-1);
+
+    return wm;
+}
+
+void DrawWindows(WMState *wm) {
+    const WindowRegistry *reg = &wm->windows;
+    int selected = GetSelectedIndex(wm);
+    if (wm->instanced) {
+        WindowRendererBegin(&wm->renderer);
+    }
+
+    for (int i = 0; i < reg->count; i++) {
+        // The scheduler already checked this frame's camera: nothing hidden
+        // or out of view has any screen area
+        if (reg->schedule[i].screen_fraction <= 0.0f) continue;
+
+        Color color = i == selected ? RED : BLACK;
+        if (wm->instanced) {
+            Vector3 corners[4];
+            GetWindowCorners(reg, i, corners);
+            WindowRendererAdd(&wm->renderer, corners, reg->texture[i].id, color);
+        }
+        else {
+            // One unit plane stretched to each window in turn
+            Texture texture = reg->texture[i];
+            if (texture.id == 0) {
+                texture = (Texture){rlGetTextureIdDefault(), 1, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+            }
+            wm->plane.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture;
+            wm->plane.transform = MatrixMultiply(MatrixScale(reg->size[i].x, 1.0f, reg->size[i].y), reg->transform[i]);
+            DrawModel(wm->plane, ORIGIN, 1.0f, WHITE);
+            DrawWindowBorder(reg, i, color);
+        }
+    }
+
+    if (wm->instanced) {
+        WindowRendererEnd(&wm->renderer);
+    }
+
+    if (selected >= 0 && reg->schedule[selected].screen_fraction > 0.0f) {
+        DrawWindowNormal(reg, selected, GREEN);
+    }
+}
+
+void DrawModeText(WMState *wm) {
+    const char *modeText = GetModeText(wm->mode);
+    Color modeColor = GetModeColor(wm->mode);
+    const int FONTSIZE = 10;
+    DrawText(TextFormat("Mode: %s", modeText), 5, 0, FONTSIZE, modeColor);
+
+    int selected = GetSelectedIndex(wm);
+    if (selected >= 0) {
+        const WindowSchedule *schedule = &wm->windows.schedule[selected];
+        float hz = schedule->refresh_hz;
+        const char *refresh = hz == SCHEDULER_AUTO_HZ ? "auto" : TextFormat("%.0f Hz", hz);
+        DrawText(TextFormat("Refresh: %s  Scale: 1/%d", refresh, 1 << schedule->lod),
+                 150, 0, FONTSIZE, modeColor);
+    }
+}
+
+void DrawControls(WMState *wm) {
+    if (!wm->show_controls) return;
+
+    const char* controlsText[] = {
+        "- Press [Space] to toggle cursor/camera movement",
+        "- Use [F1] to toggle controls display",
+#ifdef PROFILE_ENABLED
+        "- Use [F5] to toggle the profiler",
+        "- Use [F6] to start/stop recording a trace",
+#endif
+        "Mode: Cursor Movement",
+        "- Press H to toggle visibility of all windows",
+        "- Press R to cycle refresh rate of selected window",
+        "- Press S to scale selected window",
+        "- Press Z to move selected window in the Z direction",
+        "- Press G to move selected window in the XY plane",
+        "- Press [Enter] to send input to selected window",
+        "  and [Caps Lock] to stop",
+        "- Left-click to confirm change",
+        "- Press [Escape] to cancel change",
+        "Mode: Camera Movement",
+        "- Use WASD to move",
+        "- Use [F3/F4] to move up/down",
+    };
+
+    const int ROW_HEIGHT = 20;
+    const int ROW_COUNT = sizeof(controlsText) / sizeof(controlsText[0]);
+    DrawRectangle(10, 10, 285, ROW_COUNT * ROW_HEIGHT + 10, Fade(SKYBLUE, 0.5f));
+    DrawRectangleLines(10, 10, 285, ROW_COUNT * ROW_HEIGHT + 10, BLUE);
+
+    const int FONTSIZE = 10;
+    const int INDENTX = 20;
+    for (int i = 0; i < ROW_COUNT; i++) {
+        DrawText(controlsText[i], INDENTX, (i+1) * ROW_HEIGHT, FONTSIZE, DARKGRAY);
+    }
+}
+
+// Where each stage's time goes, over the last few hundred frames
+void DrawProfile(WMState *wm) {
+#ifdef PROFILE_ENABLED
+    if (ProfileTraceRecording()) {
+        DrawText("Recording trace, [F6] to stop", GetScreenWidth() / 2 - 80, 0, 10, RED);
+    }
+    if (!wm->show_profile) return;
+
+    const ProfileStats *stats = ProfileGetStats();
+    const int FONTSIZE = 10;
+    const int ROW_HEIGHT = 14;
+    const int WIDTH = 230;
+    int x = GetScreenWidth() - WIDTH - 10;
+    int y = 35;
+    int rows = PROFILE_STAGE_COUNT + 5 + wm->scaled + (wm->tap != NULL);
+    DrawRectangle(x, y, WIDTH, rows * ROW_HEIGHT + 10, Fade(SKYBLUE, 0.5f));
+    DrawRectangleLines(x, y, WIDTH, rows * ROW_HEIGHT + 10, BLUE);
+
+    x += 10;
+    y += 5;
+    DrawText("ms", x, y, FONTSIZE, DARKGRAY);
+    DrawText("p50", x + 80, y, FONTSIZE, DARKGRAY);
+    DrawText("p99", x + 125, y, FONTSIZE, DARKGRAY);
+    DrawText("max", x + 170, y, FONTSIZE, DARKGRAY);
+    for (int s = 0; s < PROFILE_STAGE_COUNT; s++) {
+        const ProfileStageStats *stage = &stats->stages[s];
+        y += ROW_HEIGHT;
+        DrawText(ProfileStageName(s), x, y, FONTSIZE, DARKGRAY);
+        DrawText(TextFormat("%.2f", stage->p50_ms), x + 80, y, FONTSIZE, DARKGRAY);
+        DrawText(TextFormat("%.2f", stage->p99_ms), x + 125, y, FONTSIZE, DARKGRAY);
+        DrawText(TextFormat("%.2f", stage->max_ms), x + 170, y, FONTSIZE, DARKGRAY);
+    }
+    y += ROW_HEIGHT;
+    DrawText(TextFormat("captured %.1f MB/s", stats->per_second[PROFILE_BYTES_CAPTURED] / 1e6), x, y, FONTSIZE, DARKGRAY);
+    y += ROW_HEIGHT;
+    DrawText(TextFormat("uploaded %.1f MB/s", stats->per_second[PROFILE_BYTES_UPLOADED] / 1e6), x, y, FONTSIZE, DARKGRAY);
+    y += ROW_HEIGHT;
+    DrawText(TextFormat("textures %.1f MB", wm->texture_bytes / (1024.0 * 1024.0)), x, y, FONTSIZE, DARKGRAY);
+    y += ROW_HEIGHT;
+    DrawText(TextFormat("occluded %d of %d windows", wm->occlusion.occluded, wm->occlusion.tested), x, y, FONTSIZE, DARKGRAY);
+    if (wm->scaled) {
+        y += ROW_HEIGHT;
+        DrawText(TextFormat("scene %.2f ms at %.0f%%", wm->scene.scene_ms, wm->scene.scale * 100.0f), x, y, FONTSIZE, DARKGRAY);
+    }
+    if (wm->tap != NULL) {
+        long written, dropped;
+        TapGetStats(wm->tap, &written, &dropped);
+        y += ROW_HEIGHT;
+        DrawText(TextFormat("tap %ld frames, %ld dropped", written, dropped), x, y, FONTSIZE, DARKGRAY);
+    }
+#else
+    (void)wm;
+#endif
+}
+
+void WMDraw(WMState *wm) {
+    wm->redraw = false;
+    ClearBackground(RAYWHITE);
+    if (wm->scaled) {
+        SceneTargetBegin(&wm->scene, RAYWHITE);
+    }
+
+    BeginMode3D(wm->camera);
+
+    DrawGrid(10, 1.0f);
+
+    // draw collision box
+    if (wm->collision.hit) {
+        DrawCube(wm->collision.point, 0.1f, 0.1f, 0.1f, RED);
+    }
+    DrawRay(wm->ray, GREEN);
+
+    PROFILE_BEGIN(PROFILE_DRAW);
+    DrawWindows(wm);
+    PROFILE_END(PROFILE_DRAW);
+
+    EndMode3D();
+    if (wm->scaled) {
+        SceneTargetEnd(&wm->scene);
+    }
+    // The scene, without the text drawn over it
+    if (wm->tap != NULL) {
+        TapCapture(wm->tap);
+    }
+
+    // display frame rate on screen
+    int screenWidth = GetScreenWidth();
+    DrawFPS(screenWidth - 80, 10);
+
+    DrawModeText(wm);
+    DrawControls(wm);
+    DrawProfile(wm);
+}
+
+void WMShutdown(WMState *wm) {
+    if (wm->input != NULL) {
+        InputStop(wm->input);
+    }
+    if (wm->options.session_path != NULL) {
+        SaveSession(wm);
+    }
+    if (wm->session != NULL) {
+        SessionClose(wm->session);
+    }
+    while (wm->windows.count > 0) {
+        WMRemoveWindow(wm, WindowRegistryHandle(&wm->windows, wm->windows.count - 1));
+    }
+    CaptureSystemShutdown(wm->capture);
+    if (wm->idle != NULL) {
+        IdleStop(wm->idle);
+    }
+    WindowRegistryFree(&wm->windows);
+    WindowTrackerFree(&wm->tracker);
+    if (!wm->instanced) {
+        // Don't let the model take the last window's texture down with it
+        wm->plane.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture.id = rlGetTextureIdDefault();
+        UnloadModel(wm->plane);
+    }
+    WindowRendererUnload(&wm->renderer);
+    SceneTargetUnload(&wm->scene);
+    if (wm->tap != NULL) {
+        TapStop(wm->tap);
+    }
+    da_free(wm->update_queue);
+    PickIndexFree(&wm->pick);
+    OcclusionFree(&wm->occlusion);
+    XCloseDisplay(wm->display);
+    CloseWindow();
+    free(wm);
+}
@@ -0,0 +1,136 @@
+#ifndef WM_H
+#define WM_H
+
+#include <X11/Xlib.h>
+#include "capture_worker.h"
+#include "pixmap_texture.h"
+#include "tracker.h"
+#define Font XFont
+
+#include "raylib.h"
+#undef Font
+#define Font XFont
+#include "upload.h"
+#include "scheduler.h"
+#include "picking.h"
+#include "render.h"
+#include "registry.h"
+#include "input.h"
+#include "idle.h"
+#include "scene_target.h"
+#include "occlusion.h"
+#include "session.h"
+#include "tap.h"
+
+typedef enum {
+    CameraMovement,
+    CursorMovement,
+    ScaleWindow,
+    MoveWindowZ,
+    MoveWindowXY,
+    InteractWindow,
+} ControlMode;
+
+// Command line options, see PrintUsage
+typedef struct {
+    bool sync_upload;
+    bool uncapped;     // no vsync or frame limit, for benchmarks
+    bool on_demand;    // only draw frames that differ from the last one
+    bool no_occlusion; // draw and capture windows hidden behind others too
+    CompositeMode composite;
+    CaptureBackend capture;
+    SchedulerConfig schedule;
+    float texture_budget_mb;  // 0 for no limit
+    float scene_ms;           // 0 to always draw the scene at full resolution
+    const char *session_path; // NULL to start from scratch and not save
+    const char *tap_path;     // where to stream the scene to, NULL for nowhere
+} WMOptions;
+
+// What WMState.windows keeps per window besides its registry columns; only
+// touched when the window's texture is updated or it goes away
+typedef struct {
+    Window window;
+    int width; // in pixels
+    int height;
+    TextureStream stream;
+    PixmapTexture pixmap_texture;
+    CaptureSource *source;
+    bool placeholder; // the texture is a small stand-in, see EnforceTextureBudget
+    bool evicted;     // recapture once it's back in view
+    bool mips_stale;  // the smaller mip levels lag the texture, see UpdateMipmaps
+} WindowResources;
+
+typedef struct {
+    int index;
+    float priority;
+} UpdateEntry;
+
+typedef struct {
+    UpdateEntry *items;
+    size_t count;
+    size_t capacity;
+} DA_update;
+
+typedef struct {
+    WMOptions options;
+    Display *display;
+    WindowTracker tracker;
+    CaptureSystem *capture;
+    InputForwarder *input;    // NULL if input can't be forwarded
+    IdleWaiter *idle;         // NULL if the loop can't sleep
+    Session *session;         // what the last run left, NULL if nothing
+    FrameTap *tap;            // NULL unless options.tap_path is set
+    Camera camera;
+    ControlMode mode;
+    WindowRegistry windows;   // WindowResources alongside each
+    DA_update update_queue;   // scratch for WMScheduleUpdates
+    PickIndex pick;           // window quads by registry slot
+    OcclusionBuffer occlusion; // as of the last WMScheduleUpdates
+    WindowRenderer renderer;
+    bool instanced;
+    SceneTarget scene;        // the 3d pass, when scaled is set
+    bool scaled;
+    Model plane;              // unit quad for drawing windows without instancing
+    Vector3 billboard_target; // camera position windows last turned to
+    bool billboard_stale;     // some window moved since
+    WindowHandle selected;
+    Matrix original_transform;
+    Vector2 original_mouse_position;
+    bool show_controls;
+    bool show_profile;
+    bool redraw;              // something on screen changed since the last WMDraw
+    size_t texture_bytes;     // all window textures, as of the last WMScheduleUpdates
+
+    // Called with every frame that made it into a window's texture, while
+    // the frame is still valid
+    void (*on_upload)(void *data, int index, const CaptureFrame *frame);
+    void *on_upload_data;
+
+    Ray ray;
+    RayCollision collision;
+} WMState;
+
+WMState *WMInit(const WMOptions *options);
+void WMShutdown(WMState *wm);
+
+// One frame of the interactive window manager: input, then everything below
+void WMUpdate(WMState *wm);
+// Everything between BeginDrawing and EndDrawing
+void WMDraw(WMState *wm);
+
+// Whether the frame after WMUpdate needs drawing. Always true unless
+// options.on_demand is set.
+bool WMNeedsDraw(WMState *wm);
+// Instead of drawing: poll input, sleeping until there is some, the capture
+// workers publish a frame or a window opens, closes or resizes
+void WMWait(WMState *wm);
+
+// The parts of WMUpdate that don't depend on input, for driving the window
+// manager some other way
+void WMSyncWindows(WMState *wm);
+void WMBillboardWindows(WMState *wm);
+void WMScheduleUpdates(WMState *wm);
+
+WindowResources *GetWindowResources(WMState *wm, int i);
+
+#endif // WM_H